@@ -0,0 +1,2355 @@
+#include "benchmark_app.h"
+#include "le_log.h"
+#include "le_jobs.h"
+#include "le_jobs_task.h"
+#include "le_ecs.h"
+
+#ifdef BENCHMARK_WITH_LE_PATH
+#	include "le_path.h"
+#	include "glm/glm.hpp"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <limits>
+
+#ifndef _WIN32
+#	include <sys/resource.h> // for getrusage
+#endif
+
+static constexpr uint32_t MAX_BENCHMARK_WORKERS = 64; // must not be larger than le_jobs' MAX_WORKER_THREAD_COUNT
+
+typedef void ( *benchmark_fn )( struct benchmark_app_o* self );
+
+// One measurement, as written to the results file - see benchmark_app_write_results.
+struct benchmark_result_t {
+	char const* benchmark; // name of benchmark, e.g. "jobs_scaling"
+	std::string metric;    // name of measurement within benchmark
+	uint32_t    workers;   // number of worker threads, 0 if not applicable
+	double      value;     //
+	char const* unit;      // e.g. "ms", "us", "1/s", "bool" - "bool" results are correctness checks, 0 if check failed
+};
+
+struct benchmark_app_o {
+	uint32_t                        num_workers_max   = 1;
+	size_t                          current_benchmark = 0;
+	le_log_channel_o*               logger;
+	std::vector<benchmark_result_t> results;
+	bool                            failed = false; // whether any correctness check failed
+};
+
+typedef benchmark_app_o app_o;
+
+using clock_type = std::chrono::steady_clock;
+
+// ----------------------------------------------------------------------
+
+static double elapsed_ms( clock_type::time_point const& start, clock_type::time_point const& end ) {
+	return std::chrono::duration<double, std::milli>( end - start ).count();
+}
+
+// ----------------------------------------------------------------------
+// Returns cpu time used by this process (all threads), in milliseconds.
+static double process_cpu_time_ms() {
+#ifndef _WIN32
+	rusage usage{};
+	getrusage( RUSAGE_SELF, &usage );
+	return ( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) * 1000.0 +
+	       ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) / 1000.0;
+#else
+	return 1000.0 * double( std::clock() ) / CLOCKS_PER_SEC;
+#endif
+}
+
+// ----------------------------------------------------------------------
+// Record a measurement, so that it ends up in the results file. Failed
+// correctness checks fail the benchmark app - see benchmark_app_update.
+static void report( benchmark_app_o* self, char const* benchmark, std::string const& metric, double value, char const* unit, uint32_t workers = 0 ) {
+	self->results.push_back( { benchmark, metric, workers, value, unit } );
+
+	if ( 0 == strcmp( unit, "bool" ) && value == 0 ) {
+		self->failed = true;
+		LeLog( self->logger ).warn( "%s: check '%s' failed (workers: %d)", benchmark, metric.c_str(), workers );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Write all measurements as JSON, so that results may be compared between
+// commits. Names and units are plain identifiers, and need no escaping.
+static void benchmark_app_write_results( benchmark_app_o* self ) {
+
+	auto logger = LeLog( self->logger );
+
+	char const* path = getenv( "LE_BENCHMARK_JSON" );
+
+	if ( nullptr == path ) {
+		path = "benchmark_results.json";
+	}
+
+	FILE* file = fopen( path, "w" );
+
+	if ( nullptr == file ) {
+		logger.error( "Could not open file '%s' for writing results", path );
+		return;
+	}
+
+	fprintf( file, "{\n" );
+	fprintf( file, "  \"num_workers_max\": %u,\n", self->num_workers_max );
+#ifdef NDEBUG
+	fprintf( file, "  \"build\": \"release\",\n" );
+#else
+	fprintf( file, "  \"build\": \"debug\",\n" );
+#endif
+	fprintf( file, "  \"results\": [\n" );
+
+	for ( size_t i = 0; i != self->results.size(); ++i ) {
+		auto const& r = self->results[ i ];
+		fprintf( file, "    { \"benchmark\": \"%s\", \"metric\": \"%s\", \"workers\": %u, \"value\": %.9g, \"unit\": \"%s\" }%s\n",
+		         r.benchmark, r.metric.c_str(), r.workers, r.value, r.unit,
+		         ( i + 1 == self->results.size() ) ? "" : "," );
+	}
+
+	fprintf( file, "  ]\n" );
+	fprintf( file, "}\n" );
+	fclose( file );
+
+	logger.info( "Wrote %zu results to '%s'", self->results.size(), path );
+}
+
+// ----------------------------------------------------------------------
+
+static void app_initialize(){};
+
+// ----------------------------------------------------------------------
+
+static void app_terminate(){};
+
+// ----------------------------------------------------------------------
+
+static benchmark_app_o* benchmark_app_create() {
+	auto app = new ( benchmark_app_o );
+
+	app->logger          = le_log_api_i->get_channel( "benchmark" );
+	app->num_workers_max = std::clamp<uint32_t>( std::thread::hardware_concurrency(), 1, MAX_BENCHMARK_WORKERS );
+
+	// Allow to override the maximum number of worker threads via environment,
+	// so that we may test over- or under-subscribed configurations.
+	if ( char const* env_workers = getenv( "LE_BENCHMARK_MAX_WORKERS" ) ) {
+		app->num_workers_max = std::clamp<uint32_t>( uint32_t( atoi( env_workers ) ), 1, MAX_BENCHMARK_WORKERS );
+	}
+
+	return app;
+}
+
+// ----------------------------------------------------------------------
+// Jobs scaling benchmark
+//
+// The main thread issues a number of root jobs, each of which fans out
+// into leaf jobs from within the job system, and then waits for them.
+// This exercises per-worker job submission, as well as stealing.
+//
+// We run this for 1..N worker threads, and report throughput, and
+// speedup relative to a single worker.
+
+struct scaling_leaf_params_t {
+	uint64_t result;
+};
+
+struct scaling_root_params_t {
+	scaling_leaf_params_t* leaves;
+	uint32_t               leaf_count;
+};
+
+static void scaling_leaf_job( void* param ) {
+	auto p = static_cast<scaling_leaf_params_t*>( param );
+	// a small amount of busy work, so that jobs are not entirely free
+	uint64_t x = uint64_t( p ) | 1;
+	for ( int i = 0; i != 256; ++i ) {
+		x = x * 6364136223846793005ull + 1442695040888963407ull;
+	}
+	p->result = x;
+}
+
+static void scaling_root_job( void* param ) {
+	auto p = static_cast<scaling_root_params_t*>( param );
+
+	std::vector<le_jobs::job_t> jobs( p->leaf_count );
+
+	for ( uint32_t i = 0; i != p->leaf_count; ++i ) {
+		jobs[ i ] = { scaling_leaf_job, &p->leaves[ i ] };
+	}
+
+	le_jobs::counter_t* counter;
+	le_jobs::run_jobs( jobs.data(), p->leaf_count, &counter );
+	le_jobs::wait_for_counter_and_free( counter, 0 );
+}
+
+static void benchmark_jobs_scaling( benchmark_app_o* self ) {
+
+	constexpr uint32_t ROOT_COUNT = 64;
+	constexpr uint32_t LEAF_COUNT = 256;
+	constexpr uint32_t ROUNDS     = 50;
+
+	auto logger = LeLog( self->logger );
+
+	std::vector<scaling_leaf_params_t> leaves( ROOT_COUNT * LEAF_COUNT );
+	std::vector<scaling_root_params_t> roots( ROOT_COUNT );
+	std::vector<le_jobs::job_t>        root_jobs( ROOT_COUNT );
+
+	for ( uint32_t i = 0; i != ROOT_COUNT; ++i ) {
+		roots[ i ]     = { leaves.data() + i * LEAF_COUNT, LEAF_COUNT };
+		root_jobs[ i ] = { scaling_root_job, &roots[ i ] };
+	}
+
+	auto run_round = [ & ]() {
+		le_jobs::counter_t* counter;
+		le_jobs::run_jobs( root_jobs.data(), ROOT_COUNT, &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+	};
+
+	logger.info( "jobs_scaling: %d rounds of %d root jobs x %d leaf jobs", ROUNDS, ROOT_COUNT, LEAF_COUNT );
+
+	double time_single_worker_ms = 0;
+
+	for ( uint32_t num_workers = 1; num_workers <= self->num_workers_max; ++num_workers ) {
+
+		le_jobs::initialize( num_workers );
+
+		run_round(); // warm-up
+
+		auto t_start = clock_type::now();
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			run_round();
+		}
+		auto t_end = clock_type::now();
+
+		le_jobs::allocation_stats_t alloc_stats{};
+		le_jobs::get_allocation_stats( &alloc_stats );
+
+		le_jobs::terminate();
+
+		double time_ms = elapsed_ms( t_start, t_end );
+
+		if ( num_workers == 1 ) {
+			time_single_worker_ms = time_ms;
+		}
+
+		double jobs_per_second = double( ROUNDS ) * ROOT_COUNT * ( LEAF_COUNT + 1 ) / ( time_ms / 1000.0 );
+
+		logger.info( "jobs_scaling: workers: %2d, time: %10.3f ms, jobs/s: %12.0f, speedup: %6.2fx, heap allocations (jobs/counters): %llu/%llu",
+		             num_workers, time_ms, jobs_per_second, time_single_worker_ms / time_ms,
+		             ( unsigned long long )alloc_stats.job_heap_allocations, ( unsigned long long )alloc_stats.counter_heap_allocations );
+
+		report( self, "jobs_scaling", "time", time_ms, "ms", num_workers );
+		report( self, "jobs_scaling", "jobs_per_second", jobs_per_second, "1/s", num_workers );
+		report( self, "jobs_scaling", "heap_allocations", double( alloc_stats.job_heap_allocations + alloc_stats.counter_heap_allocations ), "count", num_workers );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Jobs idle & wake-up benchmark
+//
+// Measures how much cpu time idle worker threads burn while there is no
+// work, and how long it takes for a job to start running once it was
+// issued to a job system where all workers are idle.
+
+struct wakeup_params_t {
+	clock_type::time_point time_started;
+};
+
+static void wakeup_job( void* param ) {
+	static_cast<wakeup_params_t*>( param )->time_started = clock_type::now();
+}
+
+static void benchmark_jobs_idle_and_wakeup( benchmark_app_o* self ) {
+
+	constexpr uint32_t IDLE_TIME_MS   = 500;
+	constexpr uint32_t WAKEUP_SAMPLES = 200;
+
+	auto logger = LeLog( self->logger );
+
+	le_jobs::initialize( self->num_workers_max );
+
+	// -- Idle cpu use: give workers time to settle, then measure cpu time
+	// used by the process while the main thread sleeps.
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+
+	double cpu_start_ms = process_cpu_time_ms();
+	auto   t_start      = clock_type::now();
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( IDLE_TIME_MS ) );
+
+	double cpu_end_ms = process_cpu_time_ms();
+	auto   t_end      = clock_type::now();
+
+	double idle_cpu_ms   = cpu_end_ms - cpu_start_ms;
+	double idle_wall_ms  = elapsed_ms( t_start, t_end );
+	double idle_cpu_load = 100.0 * idle_cpu_ms / idle_wall_ms; // in percent of one core
+
+	logger.info( "jobs_idle: workers: %2d, cpu time while idle: %8.3f ms over %8.3f ms wall time (%6.2f%% of one core)",
+	             self->num_workers_max, idle_cpu_ms, idle_wall_ms, idle_cpu_load );
+
+	report( self, "jobs_idle", "cpu_load", idle_cpu_load, "percent", self->num_workers_max );
+
+	// -- Wake-up latency: time from issuing a job to job starting to execute,
+	// with all workers idle.
+
+	std::vector<double> latencies_us;
+	latencies_us.reserve( WAKEUP_SAMPLES );
+
+	for ( uint32_t i = 0; i != WAKEUP_SAMPLES; ++i ) {
+
+		// Give workers enough time to stop spinning and go idle.
+		std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+
+		wakeup_params_t     params{};
+		le_jobs::job_t      job{ wakeup_job, &params };
+		le_jobs::counter_t* counter;
+
+		auto t_issued = clock_type::now();
+		le_jobs::run_jobs( &job, 1, &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+
+		latencies_us.push_back( std::chrono::duration<double, std::micro>( params.time_started - t_issued ).count() );
+	}
+
+	le_jobs::terminate();
+
+	std::sort( latencies_us.begin(), latencies_us.end() );
+
+	logger.info( "jobs_wakeup: workers: %2d, wake-up latency: median: %8.3f us, p90: %8.3f us, p99: %8.3f us, max: %8.3f us",
+	             self->num_workers_max,
+	             latencies_us[ WAKEUP_SAMPLES / 2 ],
+	             latencies_us[ WAKEUP_SAMPLES * 90 / 100 ],
+	             latencies_us[ WAKEUP_SAMPLES * 99 / 100 ],
+	             latencies_us.back() );
+
+	report( self, "jobs_wakeup", "latency_median", latencies_us[ WAKEUP_SAMPLES / 2 ], "us", self->num_workers_max );
+	report( self, "jobs_wakeup", "latency_p99", latencies_us[ WAKEUP_SAMPLES * 99 / 100 ], "us", self->num_workers_max );
+}
+
+// ----------------------------------------------------------------------
+// Fan-out / fan-in latency benchmark
+//
+// The main thread issues a batch of small jobs, and waits for all of them
+// to complete - this is the time it takes to fan work out to workers, and
+// to collect results again, for batches of different sizes. Workers are
+// busy with the previous batch until just before, so they don't need to be
+// woken up.
+
+static void benchmark_jobs_fan_out( benchmark_app_o* self ) {
+
+	constexpr uint32_t BATCH_SIZES[] = { 1, 16, 256 };
+	constexpr uint32_t SAMPLES       = 1000;
+
+	auto logger = LeLog( self->logger );
+
+	std::vector<scaling_leaf_params_t> leaves( BATCH_SIZES[ 2 ] );
+	std::vector<le_jobs::job_t>        jobs( BATCH_SIZES[ 2 ] );
+
+	for ( size_t i = 0; i != jobs.size(); ++i ) {
+		jobs[ i ] = { scaling_leaf_job, &leaves[ i ] };
+	}
+
+	le_jobs::initialize( self->num_workers_max );
+
+	for ( uint32_t batch_size : BATCH_SIZES ) {
+
+		std::vector<double> latencies_us;
+		latencies_us.reserve( SAMPLES );
+
+		for ( uint32_t i = 0; i != SAMPLES; ++i ) {
+			auto                t_issued = clock_type::now();
+			le_jobs::counter_t* counter;
+			le_jobs::run_jobs( jobs.data(), batch_size, &counter );
+			le_jobs::wait_for_counter_and_free( counter, 0 );
+			latencies_us.push_back( std::chrono::duration<double, std::micro>( clock_type::now() - t_issued ).count() );
+		}
+
+		std::sort( latencies_us.begin(), latencies_us.end() );
+
+		logger.info( "jobs_fan_out: workers: %2d, batch of %3d jobs: fan-out/fan-in latency: median: %8.3f us, p99: %8.3f us",
+		             self->num_workers_max, batch_size, latencies_us[ SAMPLES / 2 ], latencies_us[ SAMPLES * 99 / 100 ] );
+
+		report( self, "jobs_fan_out", "latency_median_batch_" + std::to_string( batch_size ), latencies_us[ SAMPLES / 2 ], "us", self->num_workers_max );
+		report( self, "jobs_fan_out", "latency_p99_batch_" + std::to_string( batch_size ), latencies_us[ SAMPLES * 99 / 100 ], "us", self->num_workers_max );
+	}
+
+	le_jobs::terminate();
+}
+
+// ----------------------------------------------------------------------
+// parallel_for / parallel_reduce benchmark
+//
+// Large ranges should scale with the number of workers, while small
+// ranges (at most one grain) should cost no more than a direct call.
+
+static void benchmark_jobs_parallel_for( benchmark_app_o* self ) {
+
+	constexpr uint32_t ELEMENT_COUNT    = 1 << 22;
+	constexpr uint32_t GRAIN_SIZE       = 1 << 12;
+	constexpr uint32_t ROUNDS           = 20;
+	constexpr uint32_t SMALL_RANGE      = 64;
+	constexpr uint32_t SMALL_ITERATIONS = 100000;
+
+	auto logger = LeLog( self->logger );
+
+	std::vector<uint32_t> values( ELEMENT_COUNT );
+	uint64_t              expected_sum = 0;
+
+	for ( uint32_t i = 0; i != ELEMENT_COUNT; ++i ) {
+		values[ i ] = i * 2654435761u;
+		expected_sum += values[ i ];
+	}
+
+	std::vector<float> data( ELEMENT_COUNT );
+
+	auto update_data = [ & ]( uint32_t begin, uint32_t end ) {
+		for ( uint32_t i = begin; i != end; ++i ) {
+			data[ i ] = data[ i ] * 0.5f + float( values[ i ] & 0xff );
+		}
+	};
+
+	auto sum_values = [ & ]( uint32_t begin, uint32_t end, uint64_t& accumulator ) {
+		for ( uint32_t i = begin; i != end; ++i ) {
+			accumulator += values[ i ];
+		}
+	};
+
+	auto join_sums = []( uint64_t& accumulator, uint64_t const& other ) {
+		accumulator += other;
+	};
+
+	double for_single_worker_ms    = 0;
+	double reduce_single_worker_ms = 0;
+
+	for ( uint32_t num_workers = 1; num_workers <= self->num_workers_max; ++num_workers ) {
+
+		le_jobs::initialize( num_workers );
+
+		auto t_start = clock_type::now();
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			le_jobs::parallel_for( 0, ELEMENT_COUNT, GRAIN_SIZE, update_data );
+		}
+		auto t_for = clock_type::now();
+
+		bool sums_match = true;
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			uint64_t sum = le_jobs::parallel_reduce( 0, ELEMENT_COUNT, GRAIN_SIZE, uint64_t( 0 ), sum_values, join_sums );
+			sums_match &= ( sum == expected_sum );
+		}
+		auto t_reduce = clock_type::now();
+
+		le_jobs::allocation_stats_t alloc_stats{};
+		le_jobs::get_allocation_stats( &alloc_stats );
+
+		le_jobs::terminate();
+
+		double for_ms    = elapsed_ms( t_start, t_for );
+		double reduce_ms = elapsed_ms( t_for, t_reduce );
+
+		if ( num_workers == 1 ) {
+			for_single_worker_ms    = for_ms;
+			reduce_single_worker_ms = reduce_ms;
+		}
+
+		logger.info( "jobs_parallel_for: workers: %2d, parallel_for: %8.3f ms (%5.2fx), parallel_reduce: %8.3f ms (%5.2fx), range heap allocations: %llu, result %s",
+		             num_workers,
+		             for_ms / ROUNDS, for_single_worker_ms / for_ms,
+		             reduce_ms / ROUNDS, reduce_single_worker_ms / reduce_ms,
+		             ( unsigned long long )alloc_stats.range_heap_allocations,
+		             sums_match ? "correct" : "WRONG" );
+
+		report( self, "jobs_parallel_for", "parallel_for", for_ms / ROUNDS, "ms", num_workers );
+		report( self, "jobs_parallel_for", "parallel_reduce", reduce_ms / ROUNDS, "ms", num_workers );
+		report( self, "jobs_parallel_for", "range_heap_allocations", double( alloc_stats.range_heap_allocations ), "count", num_workers );
+		report( self, "jobs_parallel_for", "correct", sums_match, "bool", num_workers );
+	}
+
+	// -- Small ranges must not be any slower than calling the function directly.
+
+	le_jobs::initialize( self->num_workers_max );
+
+	auto t_start = clock_type::now();
+	for ( uint32_t i = 0; i != SMALL_ITERATIONS; ++i ) {
+		update_data( 0, SMALL_RANGE );
+	}
+	auto t_direct = clock_type::now();
+	for ( uint32_t i = 0; i != SMALL_ITERATIONS; ++i ) {
+		le_jobs::parallel_for( 0, SMALL_RANGE, GRAIN_SIZE, update_data );
+	}
+	auto t_parallel = clock_type::now();
+
+	le_jobs::terminate();
+
+	logger.info( "jobs_parallel_for: small range (%d elements): direct call: %8.3f ns, parallel_for: %8.3f ns",
+	             SMALL_RANGE,
+	             1e6 * elapsed_ms( t_start, t_direct ) / SMALL_ITERATIONS,
+	             1e6 * elapsed_ms( t_direct, t_parallel ) / SMALL_ITERATIONS );
+
+	report( self, "jobs_parallel_for", "small_range_direct", 1e6 * elapsed_ms( t_start, t_direct ) / SMALL_ITERATIONS, "ns", self->num_workers_max );
+	report( self, "jobs_parallel_for", "small_range_parallel_for", 1e6 * elapsed_ms( t_direct, t_parallel ) / SMALL_ITERATIONS, "ns", self->num_workers_max );
+}
+
+// ----------------------------------------------------------------------
+// Wait chain benchmark
+//
+// Each job in a chain issues one child job, and waits for it - so that
+// while the innermost job runs, all other jobs of the chain are fibers
+// waiting on counters. Since waiting fibers get woken up by the counter
+// they wait on, the cost per level should not depend on chain depth.
+//
+// We start out with a small fiber pool: deep chains need more fibers,
+// and the pool must grow on demand.
+
+static void wait_chain_job( void* param ) {
+	uintptr_t depth = reinterpret_cast<uintptr_t>( param );
+
+	if ( depth == 0 ) {
+		return;
+	}
+
+	le_jobs::job_t      child{ wait_chain_job, reinterpret_cast<void*>( depth - 1 ) };
+	le_jobs::counter_t* counter;
+	le_jobs::run_jobs( &child, 1, &counter );
+	le_jobs::wait_for_counter_and_free( counter, 0 );
+}
+
+static void benchmark_jobs_wait_chain( benchmark_app_o* self ) {
+
+	constexpr uint32_t DEPTHS[] = { 8, 96, 512 };
+	constexpr uint32_t ROUNDS   = 2000;
+
+	auto logger = LeLog( self->logger );
+
+	le_jobs::settings_t settings{};
+	settings.fiber_pool_size = 16;
+
+	le_jobs::initialize( self->num_workers_max, &settings );
+
+	for ( uint32_t depth : DEPTHS ) {
+
+		le_jobs::job_t root{ wait_chain_job, reinterpret_cast<void*>( uintptr_t( depth ) ) };
+
+		auto t_start = clock_type::now();
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			le_jobs::counter_t* counter;
+			le_jobs::run_jobs( &root, 1, &counter );
+			le_jobs::wait_for_counter_and_free( counter, 0 );
+		}
+		auto t_end = clock_type::now();
+
+		le_jobs::allocation_stats_t alloc_stats{};
+		le_jobs::get_allocation_stats( &alloc_stats );
+
+		double time_per_level_us = 1000.0 * elapsed_ms( t_start, t_end ) / ( double( ROUNDS ) * ( depth + 1 ) );
+
+		logger.info( "jobs_wait_chain: workers: %2d, depth: %3d, time per level: %8.3f us, fibers in pool: %d",
+		             self->num_workers_max, depth, time_per_level_us, alloc_stats.fiber_count );
+
+		report( self, "jobs_wait_chain", "time_per_level_depth_" + std::to_string( depth ), time_per_level_us, "us", self->num_workers_max );
+	}
+
+	le_jobs::terminate();
+}
+
+// ----------------------------------------------------------------------
+// Yield ping-pong benchmark
+//
+// Two jobs take turns: each waits for its turn by yielding, and then hands
+// the turn over to the other job. This measures the cost of switching
+// between fibers on the same thread: we use a single worker, and the main
+// thread polls for the result instead of waiting - which would make it
+// help out with running jobs.
+
+struct ping_pong_params_t {
+	std::atomic<uint32_t> turn{ 0 };
+	std::atomic<bool>     done{ false };
+	uint32_t              exchanges;
+	double                time_ms;
+};
+
+static void ping_pong_job( void* param ) {
+	auto     p      = static_cast<ping_pong_params_t*>( param );
+	uint32_t parity = p->turn.fetch_add( 1, std::memory_order_relaxed ) & 1; // first job to start gets 0, second one 1
+
+	while ( p->turn.load( std::memory_order_relaxed ) < 2 ) {
+		le_jobs::yield(); // wait for both jobs to have started
+	}
+
+	for ( uint32_t i = 0; i != p->exchanges; ++i ) {
+		while ( ( p->turn.load( std::memory_order_acquire ) & 1 ) != parity ) {
+			le_jobs::yield();
+		}
+		p->turn.fetch_add( 1, std::memory_order_release );
+	}
+}
+
+static void ping_pong_root_job( void* param ) {
+	auto p = static_cast<ping_pong_params_t*>( param );
+
+	le_jobs::job_t      jobs[ 2 ] = { { ping_pong_job, p }, { ping_pong_job, p } };
+	le_jobs::counter_t* counter;
+
+	auto t_start = clock_type::now();
+	le_jobs::run_jobs( jobs, 2, &counter );
+	le_jobs::wait_for_counter_and_free( counter, 0 );
+	p->time_ms = elapsed_ms( t_start, clock_type::now() );
+
+	p->done.store( true, std::memory_order_release );
+}
+
+static void benchmark_jobs_yield( benchmark_app_o* self ) {
+
+	constexpr uint32_t EXCHANGES = 20000;
+
+	auto logger = LeLog( self->logger );
+
+	le_jobs::initialize( 1 );
+
+	ping_pong_params_t params;
+	params.exchanges = EXCHANGES;
+
+	le_jobs::job_t      root{ ping_pong_root_job, &params };
+	le_jobs::counter_t* counter;
+
+	le_jobs::run_jobs( &root, 1, &counter );
+
+	while ( !params.done.load( std::memory_order_acquire ) ) {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+
+	le_jobs::wait_for_counter_and_free( counter, 0 );
+	le_jobs::terminate();
+
+	double time_ms = params.time_ms;
+
+	bool correct = params.turn.load() == 2 + 2 * EXCHANGES;
+
+	logger.info( "jobs_yield: workers: %2d, ping-pong via yield: %8.3f us per exchange, result %s",
+	             1, 1000.0 * time_ms / ( 2 * EXCHANGES ), correct ? "correct" : "WRONG" );
+
+	report( self, "jobs_yield", "time_per_exchange", 1000.0 * time_ms / ( 2 * EXCHANGES ), "us", 1 );
+	report( self, "jobs_yield", "correct", correct, "bool", 1 );
+}
+
+// ----------------------------------------------------------------------
+// Scratch memory benchmark
+//
+// Jobs which need a temporary buffer, once allocated from the heap via
+// new/delete, and once via le_jobs::scratch_alloc. In steady state, the
+// scratch version should not touch the heap at all. Each job also keeps
+// a fiber-local value across a yield, and checks that it still sees its
+// own value afterwards.
+
+struct scratch_job_params_t {
+	uint32_t use_scratch;
+	uint32_t fiber_local_slot;
+	uint64_t result;
+	bool     fiber_local_ok;
+};
+
+static constexpr uint32_t SCRATCH_BUFFER_COUNT = 4;    // number of temporary buffers per job
+static constexpr uint32_t SCRATCH_BUFFER_SIZE  = 1024; // number of uint32_t per temporary buffer
+
+static void scratch_job( void* param ) {
+	auto p = static_cast<scratch_job_params_t*>( param );
+
+	le_jobs::set_fiber_local( p->fiber_local_slot, p );
+
+	uint64_t sum = 0;
+
+	for ( uint32_t b = 0; b != SCRATCH_BUFFER_COUNT; ++b ) {
+		uint32_t* buffer = p->use_scratch ? le_jobs::scratch_alloc_array<uint32_t>( SCRATCH_BUFFER_SIZE ) : new uint32_t[ SCRATCH_BUFFER_SIZE ];
+		for ( uint32_t i = 0; i != SCRATCH_BUFFER_SIZE; ++i ) {
+			buffer[ i ] = i * b;
+		}
+		for ( uint32_t i = 0; i != SCRATCH_BUFFER_SIZE; i += 64 ) {
+			sum += buffer[ i ];
+		}
+		if ( !p->use_scratch ) {
+			delete[] buffer;
+		}
+	}
+
+	le_jobs::yield();
+
+	p->result         = sum;
+	p->fiber_local_ok = le_jobs::get_fiber_local( p->fiber_local_slot ) == p;
+}
+
+static void benchmark_jobs_scratch( benchmark_app_o* self ) {
+
+	constexpr uint32_t JOB_COUNT = 4096;
+	constexpr uint32_t ROUNDS    = 20;
+
+	auto logger = LeLog( self->logger );
+
+	uint32_t slot = le_jobs::create_fiber_local_slot();
+
+	std::vector<scratch_job_params_t> params( JOB_COUNT );
+	std::vector<le_jobs::job_t>       jobs( JOB_COUNT );
+
+	for ( uint32_t i = 0; i != JOB_COUNT; ++i ) {
+		jobs[ i ] = { scratch_job, &params[ i ] };
+	}
+
+	le_jobs::initialize( self->num_workers_max );
+
+	double   time_ms[ 2 ]       = {};
+	bool     correct            = true;
+	uint64_t steady_heap_allocs = 0;
+	uint64_t expected_sum       = 0;
+
+	for ( uint32_t b = 0; b != SCRATCH_BUFFER_COUNT; ++b ) {
+		for ( uint32_t i = 0; i != SCRATCH_BUFFER_SIZE; i += 64 ) {
+			expected_sum += i * b;
+		}
+	}
+
+	for ( uint32_t use_scratch = 0; use_scratch != 2; ++use_scratch ) {
+
+		for ( auto& p : params ) {
+			p = { use_scratch, slot, 0, false };
+		}
+
+		auto run_round = [ & ]() {
+			le_jobs::counter_t* counter;
+			le_jobs::run_jobs( jobs.data(), JOB_COUNT, &counter );
+			le_jobs::wait_for_counter_and_free( counter, 0 );
+		};
+
+		run_round(); // warm-up: fibers allocate their first scratch block
+
+		le_jobs::allocation_stats_t stats_before{};
+		le_jobs::get_allocation_stats( &stats_before );
+
+		auto t_start = clock_type::now();
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			run_round();
+		}
+		time_ms[ use_scratch ] = elapsed_ms( t_start, clock_type::now() );
+
+		le_jobs::allocation_stats_t stats_after{};
+		le_jobs::get_allocation_stats( &stats_after );
+
+		if ( use_scratch ) {
+			steady_heap_allocs = stats_after.scratch_heap_allocations - stats_before.scratch_heap_allocations;
+		}
+
+		for ( auto const& p : params ) {
+			correct = correct && p.fiber_local_ok && p.result == expected_sum;
+		}
+	}
+
+	le_jobs::terminate();
+
+	logger.info( "jobs_scratch: workers: %2d, %d jobs x %d temporary buffers: new/delete: %8.3f ms, scratch_alloc: %8.3f ms (%5.2fx), scratch heap allocations in steady state: %llu, result %s",
+	             self->num_workers_max, JOB_COUNT, SCRATCH_BUFFER_COUNT,
+	             time_ms[ 0 ] / ROUNDS, time_ms[ 1 ] / ROUNDS, time_ms[ 0 ] / time_ms[ 1 ],
+	             ( unsigned long long )steady_heap_allocs, correct ? "correct" : "WRONG" );
+
+	report( self, "jobs_scratch", "new_delete", time_ms[ 0 ] / ROUNDS, "ms", self->num_workers_max );
+	report( self, "jobs_scratch", "scratch_alloc", time_ms[ 1 ] / ROUNDS, "ms", self->num_workers_max );
+	report( self, "jobs_scratch", "scratch_heap_allocations", double( steady_heap_allocs ), "count", self->num_workers_max );
+	report( self, "jobs_scratch", "correct", correct, "bool", self->num_workers_max );
+}
+
+// ----------------------------------------------------------------------
+// Jobs instrumentation benchmark
+//
+// Runs the scaling workload once without, and once with job tracing, and
+// checks that the scheduler counters account for every job. With tracing,
+// we also write a Chrome trace, and check that it holds job events. The
+// trace file is removed afterwards, unless given via LE_BENCHMARK_TRACE.
+
+static void benchmark_jobs_instrumentation( benchmark_app_o* self ) {
+
+	constexpr uint32_t ROOT_COUNT     = 64;
+	constexpr uint32_t LEAF_COUNT     = 256;
+	constexpr uint32_t ROUNDS         = 20;
+	constexpr uint32_t TRACE_CAPACITY = 1 << 14;
+
+	auto logger = LeLog( self->logger );
+
+	std::vector<scaling_leaf_params_t> leaves( ROOT_COUNT * LEAF_COUNT );
+	std::vector<scaling_root_params_t> roots( ROOT_COUNT );
+	std::vector<le_jobs::job_t>        root_jobs( ROOT_COUNT );
+
+	for ( uint32_t i = 0; i != ROOT_COUNT; ++i ) {
+		roots[ i ]     = { leaves.data() + i * LEAF_COUNT, LEAF_COUNT };
+		root_jobs[ i ] = { scaling_root_job, &roots[ i ] };
+	}
+
+	char const* trace_path = getenv( "LE_BENCHMARK_TRACE" );
+	bool const  keep_trace = ( nullptr != trace_path );
+
+	if ( nullptr == trace_path ) {
+		trace_path = "benchmark_trace.json";
+	}
+
+	double time_ms[ 2 ] = {};
+	bool   correct      = true;
+
+	for ( uint32_t is_tracing = 0; is_tracing != 2; ++is_tracing ) {
+
+		le_jobs::settings_t settings{};
+		settings.trace_capacity = is_tracing ? TRACE_CAPACITY : 0;
+
+		le_jobs::initialize( self->num_workers_max, &settings );
+
+		auto t_start = clock_type::now();
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			le_jobs::counter_t* counter;
+			le_jobs::run_jobs( root_jobs.data(), ROOT_COUNT, &counter );
+			le_jobs::wait_for_counter_and_free( counter, 0 );
+		}
+		time_ms[ is_tracing ] = elapsed_ms( t_start, clock_type::now() );
+
+		std::vector<le_jobs::worker_stats_t> stats( le_jobs::get_worker_stats( nullptr, 0 ) );
+		le_jobs::get_worker_stats( stats.data(), uint32_t( stats.size() ) );
+
+		le_jobs::worker_stats_t total{};
+
+		for ( auto const& w : stats ) {
+			total.jobs_executed += w.jobs_executed;
+			total.busy_ns += w.busy_ns;
+			total.idle_ns += w.idle_ns;
+			total.steals += w.steals;
+			total.yields += w.yields;
+			total.waits += w.waits;
+			total.fiber_pool_exhausted += w.fiber_pool_exhausted;
+			total.queue_depth_max = std::max( total.queue_depth_max, w.queue_depth_max );
+		}
+
+		correct = correct && ( total.jobs_executed == uint64_t( ROUNDS ) * ROOT_COUNT * ( LEAF_COUNT + 1 ) );
+
+		size_t trace_events = 0;
+
+		if ( is_tracing ) {
+			correct = correct && le_jobs::write_chrome_trace( trace_path );
+
+			// Count complete events in the trace - each worker keeps at most TRACE_CAPACITY events.
+			std::string trace;
+			if ( FILE* file = fopen( trace_path, "rb" ) ) {
+				char   buffer[ 4096 ];
+				size_t num_read;
+				while ( ( num_read = fread( buffer, 1, sizeof( buffer ), file ) ) ) {
+					trace.append( buffer, num_read );
+				}
+				fclose( file );
+			}
+			for ( size_t pos = trace.find( "\"ph\":\"X\"" ); pos != std::string::npos; pos = trace.find( "\"ph\":\"X\"", pos + 1 ) ) {
+				++trace_events;
+			}
+
+			correct = correct && trace_events > 0 && trace_events <= stats.size() * TRACE_CAPACITY;
+
+			if ( !keep_trace ) {
+				remove( trace_path );
+			}
+		} else {
+			correct = correct && !le_jobs::write_chrome_trace( trace_path ); // must fail without tracing
+		}
+
+		le_jobs::terminate();
+
+		logger.info( "jobs_instrumentation: workers: %2d, tracing: %s, time: %8.3f ms, jobs: %llu, busy: %6.2f%%, steals: %llu, waits: %llu, yields: %llu, fiber pool exhausted: %llu, max queue depth: %u, trace events: %zu",
+		             self->num_workers_max, is_tracing ? "on " : "off", time_ms[ is_tracing ],
+		             ( unsigned long long )total.jobs_executed,
+		             100.0 * double( total.busy_ns ) / double( std::max<uint64_t>( 1, total.busy_ns + total.idle_ns ) ),
+		             ( unsigned long long )total.steals, ( unsigned long long )total.waits, ( unsigned long long )total.yields,
+		             ( unsigned long long )total.fiber_pool_exhausted, total.queue_depth_max, trace_events );
+	}
+
+	logger.info( "jobs_instrumentation: workers: %2d, tracing overhead: %6.2f%%, result %s",
+	             self->num_workers_max, 100.0 * ( time_ms[ 1 ] / time_ms[ 0 ] - 1.0 ), correct ? "correct" : "WRONG" );
+
+	report( self, "jobs_instrumentation", "time_tracing_off", time_ms[ 0 ], "ms", self->num_workers_max );
+	report( self, "jobs_instrumentation", "time_tracing_on", time_ms[ 1 ], "ms", self->num_workers_max );
+	report( self, "jobs_instrumentation", "correct", correct, "bool", self->num_workers_max );
+}
+
+// ----------------------------------------------------------------------
+// Jobs priority benchmark
+//
+// Floods the background lane with long-running jobs, and then measures
+// how long it takes for high priority jobs to start running while the
+// flood is being processed. For comparison, we also measure how long a
+// job issued into the background lane right behind the flood has to wait.
+//
+// Background jobs must still make progress while high priority jobs are
+// being issued, and high priority jobs must start sooner than the
+// background job. The flood is sized per worker, so that it should
+// outlast probing.
+
+struct priority_flood_params_t {
+	std::atomic<uint32_t> completed{ 0 };
+};
+
+static void priority_flood_job( void* param ) {
+	auto p       = static_cast<priority_flood_params_t*>( param );
+	auto t_start = clock_type::now();
+	while ( clock_type::now() - t_start < std::chrono::microseconds( 100 ) ) {
+		// busy work
+	}
+	p->completed.fetch_add( 1, std::memory_order_relaxed );
+}
+
+static void benchmark_jobs_priority( benchmark_app_o* self ) {
+
+	constexpr uint32_t FLOOD_PER_WORKER = 750; // 75 ms worth of flood jobs per worker - three times as long as probing takes
+	constexpr uint32_t PROBE_SAMPLES    = 50;
+	constexpr uint32_t PROBE_INTERVAL   = 500; // microseconds
+
+	auto logger = LeLog( self->logger );
+
+	uint32_t const flood_count = FLOOD_PER_WORKER * self->num_workers_max;
+
+	le_jobs::initialize( self->num_workers_max );
+
+	priority_flood_params_t     flood_params;
+	std::vector<le_jobs::job_t> flood_jobs( flood_count, le_jobs::job_t{ priority_flood_job, &flood_params } );
+	le_jobs::counter_t*         flood_counter;
+
+	le_jobs::run_jobs_with_priority( flood_jobs.data(), flood_count, &flood_counter, le_jobs::Priority::eBackground );
+
+	// Issue the background probe right away, so that it queues up behind the
+	// flood, no matter how quickly workers get through the flood.
+	wakeup_params_t     background_params{};
+	le_jobs::job_t      background_job{ wakeup_job, &background_params };
+	le_jobs::counter_t* background_counter;
+
+	auto t_background_issued = clock_type::now();
+	le_jobs::run_jobs_with_priority( &background_job, 1, &background_counter, le_jobs::Priority::eBackground );
+
+	std::vector<double> latencies_us;
+	latencies_us.reserve( PROBE_SAMPLES );
+
+	for ( uint32_t i = 0; i != PROBE_SAMPLES; ++i ) {
+		std::this_thread::sleep_for( std::chrono::microseconds( PROBE_INTERVAL ) );
+
+		wakeup_params_t     params{};
+		le_jobs::job_t      job{ wakeup_job, &params };
+		le_jobs::counter_t* counter;
+
+		auto t_issued = clock_type::now();
+		le_jobs::run_jobs_with_priority( &job, 1, &counter, le_jobs::Priority::eHigh );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+
+		latencies_us.push_back( std::chrono::duration<double, std::micro>( params.time_started - t_issued ).count() );
+	}
+
+	uint32_t flood_completed_while_probing = flood_params.completed.load( std::memory_order_relaxed );
+
+	le_jobs::wait_for_counter_and_free( background_counter, 0 );
+	le_jobs::wait_for_counter_and_free( flood_counter, 0 );
+
+	double background_latency_us = std::chrono::duration<double, std::micro>( background_params.time_started - t_background_issued ).count();
+	le_jobs::terminate();
+
+	std::sort( latencies_us.begin(), latencies_us.end() );
+
+	// High priority jobs must overtake the flood, but must not starve it.
+	bool const correct = latencies_us[ PROBE_SAMPLES / 2 ] < background_latency_us &&
+	                     flood_completed_while_probing > 0;
+
+	logger.info( "jobs_priority: workers: %2d, latency under background load: high priority: median: %8.3f us, max: %8.3f us, background priority: %8.3f us",
+	             self->num_workers_max,
+	             latencies_us[ PROBE_SAMPLES / 2 ],
+	             latencies_us.back(),
+	             background_latency_us );
+	logger.info( "jobs_priority: background jobs completed while high priority jobs were issued: %d of %d, result %s",
+	             flood_completed_while_probing, flood_count, correct ? "correct" : "WRONG" );
+
+	report( self, "jobs_priority", "high_priority_latency_median", latencies_us[ PROBE_SAMPLES / 2 ], "us", self->num_workers_max );
+	report( self, "jobs_priority", "background_latency", background_latency_us, "us", self->num_workers_max );
+	report( self, "jobs_priority", "background_completed", flood_completed_while_probing, "count", self->num_workers_max );
+	report( self, "jobs_priority", "correct", correct, "bool", self->num_workers_max );
+}
+
+// ----------------------------------------------------------------------
+// Continuations benchmark
+//
+// Issues a small graph of jobs every frame:
+//
+//   A ( 4 jobs ) -> B ( 4 jobs ) -> C ( 1 job ) -+-> E ( 1 job )
+//   D ( 4 jobs ) --------------------------------+
+//
+// once expressed via run_jobs_after, where no fiber needs to wait, and
+// once via a root job which issues each stage, and then waits for it.
+//
+// Each job takes a sequence number when it starts, and another when it
+// finishes, so that we can check that no stage started before all of
+// the stages it depends on had finished.
+
+struct graph_job_params_t {
+	scaling_leaf_params_t  leaf;
+	std::atomic<uint32_t>* sequence; // shared by all jobs of a frame
+	uint32_t               started;  // sequence number when job started
+	uint32_t               finished; // sequence number when job finished
+};
+
+// Index of the first job of each stage into graph_job_params_t[ GRAPH_JOB_COUNT ]
+enum : uint32_t {
+	GRAPH_STAGE_A   = 0,
+	GRAPH_STAGE_B   = 4,
+	GRAPH_STAGE_C   = 8,
+	GRAPH_STAGE_D   = 9,
+	GRAPH_STAGE_E   = 13,
+	GRAPH_JOB_COUNT = 14,
+};
+
+static void graph_job( void* param ) {
+	auto p      = static_cast<graph_job_params_t*>( param );
+	p->started  = p->sequence->fetch_add( 1 );
+	scaling_leaf_job( &p->leaf );
+	p->finished = p->sequence->fetch_add( 1 );
+}
+
+// Returns whether all jobs of a frame ran in dependency order.
+static bool graph_is_ordered( graph_job_params_t const* params ) {
+
+	auto max_finished = [ params ]( uint32_t first, uint32_t count ) {
+		uint32_t result = 0;
+		for ( uint32_t i = first; i != first + count; ++i ) {
+			result = std::max( result, params[ i ].finished );
+		}
+		return result;
+	};
+
+	auto min_started = [ params ]( uint32_t first, uint32_t count ) {
+		uint32_t result = ~uint32_t( 0 );
+		for ( uint32_t i = first; i != first + count; ++i ) {
+			result = std::min( result, params[ i ].started );
+		}
+		return result;
+	};
+
+	return min_started( GRAPH_STAGE_B, 4 ) > max_finished( GRAPH_STAGE_A, 4 ) &&
+	       min_started( GRAPH_STAGE_C, 1 ) > max_finished( GRAPH_STAGE_B, 4 ) &&
+	       min_started( GRAPH_STAGE_E, 1 ) > max_finished( GRAPH_STAGE_C, 1 ) && // E depends on both C ...
+	       min_started( GRAPH_STAGE_E, 1 ) > max_finished( GRAPH_STAGE_D, 4 );   // ... and D
+}
+
+static void graph_make_jobs( le_jobs::job_t* jobs, graph_job_params_t* params, uint32_t first, uint32_t count ) {
+	for ( uint32_t i = 0; i != count; ++i ) {
+		jobs[ i ] = { graph_job, &params[ first + i ] };
+	}
+}
+
+static void graph_root_job( void* param ) {
+	auto params = static_cast<graph_job_params_t*>( param );
+
+	le_jobs::job_t      jobs[ 4 ];
+	le_jobs::counter_t* counter_a;
+	le_jobs::counter_t* counter_d;
+	le_jobs::counter_t* counter;
+
+	graph_make_jobs( jobs, params, GRAPH_STAGE_A, 4 );
+	le_jobs::run_jobs( jobs, 4, &counter_a );
+
+	graph_make_jobs( jobs, params, GRAPH_STAGE_D, 4 );
+	le_jobs::run_jobs( jobs, 4, &counter_d );
+
+	le_jobs::wait_for_counter_and_free( counter_a, 0 );
+
+	graph_make_jobs( jobs, params, GRAPH_STAGE_B, 4 );
+	le_jobs::run_jobs( jobs, 4, &counter );
+	le_jobs::wait_for_counter_and_free( counter, 0 );
+
+	graph_make_jobs( jobs, params, GRAPH_STAGE_C, 1 );
+	le_jobs::run_jobs( jobs, 1, &counter );
+	le_jobs::wait_for_counter_and_free( counter, 0 );
+	le_jobs::wait_for_counter_and_free( counter_d, 0 );
+
+	graph_make_jobs( jobs, params, GRAPH_STAGE_E, 1 );
+	le_jobs::run_jobs( jobs, 1, &counter );
+	le_jobs::wait_for_counter_and_free( counter, 0 );
+}
+
+static void benchmark_jobs_continuations( benchmark_app_o* self ) {
+
+	constexpr uint32_t FRAMES = 5000;
+
+	auto logger   = LeLog( self->logger );
+	auto priority = le_jobs::Priority::eNormal;
+
+	std::atomic<uint32_t> sequence{ 0 };
+	graph_job_params_t    params[ GRAPH_JOB_COUNT ];
+	bool                  correct[ 2 ] = { true, true }; // continuations, waiting fibers
+	uint32_t              d_last       = 0;              // frames in which D, rather than C, was the last dependency of E to finish
+
+	for ( auto& p : params ) {
+		p = { {}, &sequence, 0, 0 };
+	}
+
+	le_jobs::initialize( self->num_workers_max );
+
+	auto t_start = clock_type::now();
+
+	for ( uint32_t f = 0; f != FRAMES; ++f ) {
+		le_jobs::job_t      jobs[ 4 ];
+		le_jobs::counter_t* counter_a;
+		le_jobs::counter_t* counter_b;
+		le_jobs::counter_t* counter_c;
+		le_jobs::counter_t* counter_d;
+		le_jobs::counter_t* counter_e;
+
+		sequence = 0;
+
+		graph_make_jobs( jobs, params, GRAPH_STAGE_A, 4 );
+		le_jobs::run_jobs( jobs, 4, &counter_a );
+		graph_make_jobs( jobs, params, GRAPH_STAGE_B, 4 );
+		le_jobs::run_jobs_after( &counter_a, 1, jobs, 4, &counter_b, priority );
+		graph_make_jobs( jobs, params, GRAPH_STAGE_C, 1 );
+		le_jobs::run_jobs_after( &counter_b, 1, jobs, 1, &counter_c, priority );
+		graph_make_jobs( jobs, params, GRAPH_STAGE_D, 4 );
+		le_jobs::run_jobs( jobs, 4, &counter_d );
+
+		le_jobs::counter_t* dependencies_e[] = { counter_c, counter_d };
+		graph_make_jobs( jobs, params, GRAPH_STAGE_E, 1 );
+		le_jobs::run_jobs_after( dependencies_e, 2, jobs, 1, &counter_e, priority );
+
+		le_jobs::wait_for_counter_and_free( counter_e, 0 );
+
+		correct[ 0 ] = correct[ 0 ] && graph_is_ordered( params );
+
+		uint32_t d_finished = 0;
+		for ( uint32_t i = GRAPH_STAGE_D; i != GRAPH_STAGE_D + 4; ++i ) {
+			d_finished = std::max( d_finished, params[ i ].finished );
+		}
+		d_last += ( d_finished > params[ GRAPH_STAGE_C ].finished );
+	}
+
+	auto t_continuations = clock_type::now();
+
+	for ( uint32_t f = 0; f != FRAMES; ++f ) {
+		le_jobs::job_t      root{ graph_root_job, params };
+		le_jobs::counter_t* counter;
+
+		sequence = 0;
+
+		le_jobs::run_jobs( &root, 1, &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+
+		correct[ 1 ] = correct[ 1 ] && graph_is_ordered( params );
+	}
+
+	auto t_waiting = clock_type::now();
+
+	le_jobs::allocation_stats_t alloc_stats{};
+	le_jobs::get_allocation_stats( &alloc_stats );
+
+	le_jobs::terminate();
+
+	logger.info( "jobs_continuations: workers: %2d, time per frame: continuations: %8.3f us, waiting fibers: %8.3f us, heap allocations (jobs/counters/continuations): %llu/%llu/%llu, D finished after C in %u of %u frames, order %s",
+	             self->num_workers_max,
+	             1000.0 * elapsed_ms( t_start, t_continuations ) / FRAMES,
+	             1000.0 * elapsed_ms( t_continuations, t_waiting ) / FRAMES,
+	             ( unsigned long long )alloc_stats.job_heap_allocations,
+	             ( unsigned long long )alloc_stats.counter_heap_allocations,
+	             ( unsigned long long )alloc_stats.continuation_heap_allocations,
+	             d_last, FRAMES,
+	             correct[ 0 ] && correct[ 1 ] ? "correct" : "WRONG" );
+
+	report( self, "jobs_continuations", "run_jobs_after", 1000.0 * elapsed_ms( t_start, t_continuations ) / FRAMES, "us", self->num_workers_max );
+	report( self, "jobs_continuations", "waiting_fibers", 1000.0 * elapsed_ms( t_continuations, t_waiting ) / FRAMES, "us", self->num_workers_max );
+	report( self, "jobs_continuations", "continuation_heap_allocations", double( alloc_stats.continuation_heap_allocations ), "count", self->num_workers_max );
+	report( self, "jobs_continuations", "correct", correct[ 0 ] && correct[ 1 ], "bool", self->num_workers_max );
+}
+
+// ----------------------------------------------------------------------
+// Tasks benchmark
+//
+// Many "asset loads" are in flight at once, and each load takes a number
+// of steps - each step issues a small job, and waits for it. Compares
+// loads as jobs which wait on fibers with loads as stackless tasks which
+// co_await. Tasks don't need fibers, so the fiber pool must not grow, and
+// task frames should all come from the frame pools.
+
+struct load_params_t {
+	scaling_leaf_params_t leaf;
+	uint64_t              sum;
+};
+
+static constexpr uint32_t LOAD_STEPS = 16;
+
+static void load_fiber_job( void* param ) {
+	auto p = static_cast<load_params_t*>( param );
+	for ( uint32_t s = 0; s != LOAD_STEPS; ++s ) {
+		le_jobs::job_t      job{ scaling_leaf_job, &p->leaf };
+		le_jobs::counter_t* counter;
+		le_jobs::run_jobs( &job, 1, &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+		p->sum += p->leaf.result;
+	}
+}
+
+static le_jobs::task<uint64_t> load_step_task( scaling_leaf_params_t* leaf ) {
+	le_jobs::job_t      job{ scaling_leaf_job, leaf };
+	le_jobs::counter_t* counter;
+	le_jobs::run_jobs( &job, 1, &counter );
+	co_await counter;
+	co_return leaf->result;
+}
+
+static le_jobs::task<> load_task( load_params_t* p ) {
+	for ( uint32_t s = 0; s != LOAD_STEPS; ++s ) {
+		p->sum += co_await load_step_task( &p->leaf );
+	}
+}
+
+static void benchmark_jobs_tasks( benchmark_app_o* self ) {
+
+	constexpr uint32_t ROUNDS = 20;
+	constexpr uint32_t LOADS  = 512;
+
+	auto logger = LeLog( self->logger );
+
+	std::vector<load_params_t>       loads( LOADS );
+	std::vector<le_jobs::counter_t*> counters( LOADS );
+	std::vector<le_jobs::job_t>      jobs( LOADS );
+
+	double   time_ms[ 2 ]           = {};
+	uint64_t sum[ 2 ]               = {};
+	uint32_t fiber_count[ 2 ]       = {};
+	uint64_t frame_heap_allocations = 0;
+
+	for ( int use_tasks = 0; use_tasks != 2; ++use_tasks ) {
+
+		for ( auto& l : loads ) {
+			l.sum = 0;
+		}
+
+		le_jobs::initialize( self->num_workers_max );
+
+		auto t_start = clock_type::now();
+
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			if ( use_tasks ) {
+				for ( uint32_t i = 0; i != LOADS; ++i ) {
+					le_jobs::run_task( load_task( &loads[ i ] ), &counters[ i ] );
+				}
+				for ( auto c : counters ) {
+					le_jobs::wait_for_counter_and_free( c, 0 );
+				}
+			} else {
+				for ( uint32_t i = 0; i != LOADS; ++i ) {
+					jobs[ i ] = { load_fiber_job, &loads[ i ] };
+				}
+				le_jobs::counter_t* counter;
+				le_jobs::run_jobs( jobs.data(), LOADS, &counter );
+				le_jobs::wait_for_counter_and_free( counter, 0 );
+			}
+		}
+
+		time_ms[ use_tasks ] = elapsed_ms( t_start, clock_type::now() );
+
+		le_jobs::allocation_stats_t alloc_stats{};
+		le_jobs::get_allocation_stats( &alloc_stats );
+		fiber_count[ use_tasks ] = alloc_stats.fiber_count;
+		if ( use_tasks ) {
+			frame_heap_allocations = alloc_stats.frame_heap_allocations;
+		}
+
+		le_jobs::terminate();
+
+		for ( auto const& l : loads ) {
+			sum[ use_tasks ] += l.sum;
+		}
+	}
+
+	double const steps   = double( ROUNDS ) * LOADS * LOAD_STEPS;
+	bool const   correct = sum[ 0 ] == sum[ 1 ] && 0 == frame_heap_allocations && fiber_count[ 1 ] <= fiber_count[ 0 ];
+
+	logger.info( "jobs_tasks: workers: %2d, time per step: fibers: %8.3f us, tasks: %8.3f us, fibers in pool: %u/%u, frame heap allocations: %llu, %s",
+	             self->num_workers_max,
+	             1000.0 * time_ms[ 0 ] / steps,
+	             1000.0 * time_ms[ 1 ] / steps,
+	             fiber_count[ 0 ], fiber_count[ 1 ],
+	             ( unsigned long long )frame_heap_allocations,
+	             correct ? "correct" : "WRONG" );
+
+	report( self, "jobs_tasks", "fibers", 1000.0 * time_ms[ 0 ] / steps, "us", self->num_workers_max );
+	report( self, "jobs_tasks", "tasks", 1000.0 * time_ms[ 1 ] / steps, "us", self->num_workers_max );
+	report( self, "jobs_tasks", "fibers_in_pool_fibers", double( fiber_count[ 0 ] ), "count", self->num_workers_max );
+	report( self, "jobs_tasks", "fibers_in_pool_tasks", double( fiber_count[ 1 ] ), "count", self->num_workers_max );
+	report( self, "jobs_tasks", "correct", correct, "bool", self->num_workers_max );
+}
+
+// ----------------------------------------------------------------------
+// ECS systems benchmark
+//
+// Updates a world with three systems - integrate and age don't conflict,
+// so they may run concurrently, while bounce must wait for integrate.
+// Compares executing systems one by one with execute_systems for 1..N
+// workers, and checks that both arrive at the same result.
+
+LE_ECS_COMPONENT( BenchPosition );
+float x, y, z;
+LE_ECS_COMPONENT_CLOSE();
+
+LE_ECS_COMPONENT( BenchVelocity );
+float x, y, z;
+LE_ECS_COMPONENT_CLOSE();
+
+LE_ECS_COMPONENT( BenchAge );
+float seconds;
+LE_ECS_COMPONENT_CLOSE();
+
+struct ecs_bench_world_t {
+	LeEcs                 ecs;
+	LeEcsSystemId         systems[ 3 ];
+	std::vector<EntityId> entities;
+
+	ecs_bench_world_t() = default;
+
+	explicit ecs_bench_world_t( le_ecs_o* ecs_ )
+	    : ecs( ecs_ ) {
+	}
+};
+
+static void ecs_bench_world_add_systems( ecs_bench_world_t& world );
+
+static void ecs_bench_world_setup( ecs_bench_world_t& world, uint32_t entity_count ) {
+
+	for ( uint32_t i = 0; i != entity_count; ++i ) {
+		auto builder = world.ecs.entity();
+		builder.add_component( BenchPosition{ float( i % 100 ), float( i % 37 ), 0.f } );
+		builder.add_component( BenchVelocity{ 1.f, float( i % 7 ) - 3.f, 0.5f } );
+		if ( i % 2 ) {
+			builder.add_component( BenchAge{ 0.f } );
+		}
+		world.entities.push_back( builder.build() );
+	}
+
+	ecs_bench_world_add_systems( world );
+}
+
+static void ecs_bench_world_add_systems( ecs_bench_world_t& world ) {
+
+	// integrate: position += velocity * dt
+
+	world.systems[ 0 ] = world.ecs.system().add_read_components<BenchVelocity>().add_write_components<BenchPosition>().build();
+	world.ecs.system_set_method( world.systems[ 0 ], []( LE_ECS_READ_WRITE_PARAMS, void* user_data ) {
+		auto vel = LE_ECS_GET_READ_PARAM( 0, BenchVelocity );
+		auto pos = LE_ECS_GET_WRITE_PARAM( 0, BenchPosition );
+		float dt = *static_cast<float const*>( user_data );
+		pos->x += vel->x * dt;
+		pos->y += vel->y * dt;
+		pos->z += vel->z * dt;
+	} );
+
+	// age: age += dt
+
+	world.systems[ 1 ] = world.ecs.system().add_write_components<BenchAge>().build();
+	world.ecs.system_set_method( world.systems[ 1 ], []( LE_ECS_WRITE_ONLY_PARAMS, void* user_data ) {
+		auto age = LE_ECS_GET_WRITE_PARAM( 0, BenchAge );
+		age->seconds += *static_cast<float const*>( user_data );
+	} );
+
+	// bounce: reverse velocity once position leaves bounds
+
+	world.systems[ 2 ] = world.ecs.system().add_read_components<BenchPosition>().add_write_components<BenchVelocity>().build();
+	world.ecs.system_set_method( world.systems[ 2 ], []( LE_ECS_READ_WRITE_PARAMS, void* ) {
+		auto pos = LE_ECS_GET_READ_PARAM( 0, BenchPosition );
+		auto vel = LE_ECS_GET_WRITE_PARAM( 0, BenchVelocity );
+		if ( pos->x < 0 || pos->x > 100 ) {
+			vel->x = -vel->x;
+		}
+		if ( pos->y < 0 || pos->y > 100 ) {
+			vel->y = -vel->y;
+		}
+	} );
+}
+
+static double ecs_bench_world_checksum( ecs_bench_world_t& world ) {
+	double sum = 0;
+	auto   sys = world.ecs.system().add_read_components<BenchPosition>().build();
+	world.ecs.system_set_method( sys, []( LE_ECS_READ_ONLY_PARAMS, void* user_data ) {
+		auto pos = LE_ECS_GET_READ_PARAM( 0, BenchPosition );
+		*static_cast<double*>( user_data ) += pos->x + pos->y + pos->z;
+	} );
+	world.ecs.update_system( sys, &sum );
+	return sum;
+}
+
+static void benchmark_ecs_systems( benchmark_app_o* self ) {
+
+	constexpr uint32_t ENTITY_COUNT = 200000;
+	constexpr uint32_t FRAMES       = 20;
+	float const        dt           = 1.f / 60.f;
+
+	auto logger = LeLog( self->logger );
+
+	// -- Execute systems one by one, on the main thread
+
+	double sequential_checksum = 0;
+	double sequential_ms       = 0;
+	{
+		ecs_bench_world_t world;
+		ecs_bench_world_setup( world, ENTITY_COUNT );
+
+		auto t_start = clock_type::now();
+		for ( uint32_t f = 0; f != FRAMES; ++f ) {
+			for ( auto const& system : world.systems ) {
+				world.ecs.update_system( system, const_cast<float*>( &dt ) );
+			}
+		}
+		sequential_ms       = elapsed_ms( t_start, clock_type::now() );
+		sequential_checksum = ecs_bench_world_checksum( world );
+	}
+
+	logger.info( "ecs_systems: %d entities, sequential: %8.3f ms per frame", ENTITY_COUNT, sequential_ms / FRAMES );
+
+	report( self, "ecs_systems", "sequential", sequential_ms / FRAMES, "ms" );
+
+	// -- Same, but with batch methods for integrate and age
+
+	{
+		ecs_bench_world_t world;
+		ecs_bench_world_setup( world, ENTITY_COUNT );
+
+		world.ecs.system_set_batch_method( world.systems[ 0 ], []( LE_ECS_BATCH_READ_WRITE_PARAMS, void* user_data ) {
+			auto  vel = LE_ECS_GET_READ_SPAN( 0, BenchVelocity );
+			auto  pos = LE_ECS_GET_WRITE_SPAN( 0, BenchPosition );
+			float dt  = *static_cast<float const*>( user_data );
+			for ( uint32_t i = 0; i != count; ++i ) {
+				pos[ i ].x += vel[ i ].x * dt;
+				pos[ i ].y += vel[ i ].y * dt;
+				pos[ i ].z += vel[ i ].z * dt;
+			}
+		} );
+
+		world.ecs.system_set_batch_method( world.systems[ 1 ], []( LE_ECS_BATCH_WRITE_ONLY_PARAMS, void* user_data ) {
+			auto  age = LE_ECS_GET_WRITE_SPAN( 0, BenchAge );
+			float dt  = *static_cast<float const*>( user_data );
+			for ( auto& a : age ) {
+				a.seconds += dt;
+			}
+		} );
+
+		auto t_start = clock_type::now();
+		for ( uint32_t f = 0; f != FRAMES; ++f ) {
+			for ( auto const& system : world.systems ) {
+				world.ecs.update_system( system, const_cast<float*>( &dt ) );
+			}
+		}
+		double batch_ms = elapsed_ms( t_start, clock_type::now() );
+
+		bool correct = ecs_bench_world_checksum( world ) == sequential_checksum;
+
+		logger.info( "ecs_systems: %d entities, sequential, with batch methods: %8.3f ms per frame (%5.2fx), result %s",
+		             ENTITY_COUNT, batch_ms / FRAMES, sequential_ms / batch_ms, correct ? "correct" : "WRONG" );
+
+		report( self, "ecs_systems", "sequential_batch", batch_ms / FRAMES, "ms" );
+		report( self, "ecs_systems", "sequential_batch_correct", correct, "bool" );
+	}
+
+	// -- Execute systems via the scheduler
+
+	for ( uint32_t num_workers = 1; num_workers <= self->num_workers_max; ++num_workers ) {
+
+		ecs_bench_world_t world;
+		ecs_bench_world_setup( world, ENTITY_COUNT );
+
+		le_jobs::initialize( num_workers );
+
+		auto t_start = clock_type::now();
+		for ( uint32_t f = 0; f != FRAMES; ++f ) {
+			world.ecs.update_systems( world.systems, 3, const_cast<float*>( &dt ) );
+		}
+		double parallel_ms = elapsed_ms( t_start, clock_type::now() );
+
+		le_jobs::terminate();
+
+		bool correct = ecs_bench_world_checksum( world ) == sequential_checksum;
+
+		logger.info( "ecs_systems: workers: %2d, execute_systems: %8.3f ms per frame (%5.2fx), result %s",
+		             num_workers, parallel_ms / FRAMES, sequential_ms / parallel_ms, correct ? "correct" : "WRONG" );
+
+		report( self, "ecs_systems", "execute_systems", parallel_ms / FRAMES, "ms", num_workers );
+		report( self, "ecs_systems", "execute_systems_correct", correct, "bool", num_workers );
+	}
+}
+
+// ----------------------------------------------------------------------
+// ECS iteration benchmark
+//
+// A world of 1M entities, all of which have position and velocity. Flag
+// components mark half, a tenth, and a hundredth of all entities, spread
+// over entities in no particular order, which splits entities over eight
+// archetypes. One system per sparsity integrates positions of entities
+// which it matches: since systems only visit matching archetypes, time
+// per matched entity should not grow as matches get sparser.
+
+LE_ECS_FLAG_COMPONENT( BenchSparseHalf );
+LE_ECS_FLAG_COMPONENT( BenchSparseTenth );
+LE_ECS_FLAG_COMPONENT( BenchSparseHundredth );
+
+struct ecs_iteration_params_t {
+	float    dt;
+	uint64_t matched; // number of entities visited
+};
+
+static void benchmark_ecs_iteration( benchmark_app_o* self ) {
+
+	constexpr uint32_t ENTITY_COUNT = 1000000;
+	constexpr uint32_t ROUNDS       = 10;
+
+	auto logger = LeLog( self->logger );
+
+	LeEcs    ecs;
+	uint32_t expected[ 4 ] = { ENTITY_COUNT, 0, 0, 0 }; // number of entities per sparsity
+
+	for ( uint32_t i = 0; i != ENTITY_COUNT; ++i ) {
+		uint32_t h       = i * 2654435761u;
+		auto     builder = ecs.entity();
+		builder.add_component( BenchPosition{ float( i % 100 ), 0.f, 0.f } );
+		builder.add_component( BenchVelocity{ 1.f, 0.5f, 0.f } );
+		if ( ( h >> 8 ) % 2 == 0 ) {
+			builder.add_component( BenchSparseHalf{} );
+			expected[ 1 ]++;
+		}
+		if ( ( h >> 12 ) % 10 == 0 ) {
+			builder.add_component( BenchSparseTenth{} );
+			expected[ 2 ]++;
+		}
+		if ( ( h >> 16 ) % 100 == 0 ) {
+			builder.add_component( BenchSparseHundredth{} );
+			expected[ 3 ]++;
+		}
+	}
+
+	auto integrate = []( LE_ECS_BATCH_READ_WRITE_PARAMS, void* user_data ) {
+		auto params = static_cast<ecs_iteration_params_t*>( user_data );
+		auto vel    = LE_ECS_GET_READ_SPAN( 0, BenchVelocity );
+		auto pos    = LE_ECS_GET_WRITE_SPAN( 0, BenchPosition );
+		for ( uint32_t i = 0; i != count; ++i ) {
+			pos[ i ].x += vel[ i ].x * params->dt;
+			pos[ i ].y += vel[ i ].y * params->dt;
+			pos[ i ].z += vel[ i ].z * params->dt;
+		}
+		params->matched += count;
+	};
+
+	LeEcsSystemId systems[ 4 ] = {
+	    ecs.system().add_read_components<BenchVelocity>().add_write_components<BenchPosition>().build(),
+	    ecs.system().add_read_components<BenchVelocity, BenchSparseHalf>().add_write_components<BenchPosition>().build(),
+	    ecs.system().add_read_components<BenchVelocity, BenchSparseTenth>().add_write_components<BenchPosition>().build(),
+	    ecs.system().add_read_components<BenchVelocity, BenchSparseHundredth>().add_write_components<BenchPosition>().build(),
+	};
+
+	char const* sparsity_names[ 4 ] = { "100_percent", "50_percent", "10_percent", "1_percent" };
+
+	for ( uint32_t s = 0; s != 4; ++s ) {
+
+		ecs.system_set_batch_method( systems[ s ], integrate );
+
+		ecs_iteration_params_t params{ 1.f / 60.f, 0 };
+
+		auto t_start = clock_type::now();
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			ecs.update_system( systems[ s ], &params );
+		}
+		double time_ms = elapsed_ms( t_start, clock_type::now() ) / ROUNDS;
+
+		bool correct = params.matched == uint64_t( expected[ s ] ) * ROUNDS;
+
+		logger.info( "ecs_iteration: %d entities, system matching %7d entities: %8.3f ms per pass, %6.3f ns per matched entity, result %s",
+		             ENTITY_COUNT, expected[ s ], time_ms, 1e6 * time_ms / std::max<uint32_t>( expected[ s ], 1 ),
+		             correct ? "correct" : "WRONG" );
+
+		report( self, "ecs_iteration", std::string( "time_" ) + sparsity_names[ s ], time_ms, "ms" );
+		report( self, "ecs_iteration", std::string( "time_per_entity_" ) + sparsity_names[ s ], 1e6 * time_ms / std::max<uint32_t>( expected[ s ], 1 ), "ns" );
+		report( self, "ecs_iteration", std::string( "correct_" ) + sparsity_names[ s ], correct, "bool" );
+	}
+}
+
+// ----------------------------------------------------------------------
+// ECS command buffer benchmark
+//
+// Every frame, a system running on all workers retires a fraction of all
+// entities, and spawns a replacement for each - much like projectiles in
+// a game. Changes are recorded into per-worker command buffers, and then
+// applied in one go via flush_commands. Compare with collecting entity ids
+// and applying changes one by one on the main thread.
+
+LE_ECS_COMPONENT( BenchLifetime );
+uint32_t frames_left;
+LE_ECS_COMPONENT_CLOSE();
+
+LE_ECS_FLAG_COMPONENT( BenchSpawned );
+
+struct ecs_churn_params_t {
+	LeEcs*                 ecs;
+	std::vector<EntityId>* expired; // only used when applying changes directly
+};
+
+static void benchmark_ecs_commands( benchmark_app_o* self ) {
+
+	constexpr uint32_t ENTITY_COUNT = 100000;
+	constexpr uint32_t FRAMES       = 20;
+
+	auto logger = LeLog( self->logger );
+
+	double elapsed[ 2 ] = {};
+	bool   correct[ 2 ] = {};
+
+	le_jobs::initialize( self->num_workers_max );
+
+	for ( int use_commands = 0; use_commands != 2; ++use_commands ) {
+
+		LeEcs ecs;
+
+		for ( uint32_t i = 0; i != ENTITY_COUNT; ++i ) {
+			ecs.entity()
+			    .add_component( BenchPosition{ float( i ), 0, 0 } )
+			    .add_component( BenchLifetime{ 1 + i % 8 } )
+			    .build();
+		}
+
+		std::vector<EntityId> expired;
+		ecs_churn_params_t    params{ &ecs, &expired };
+
+		auto age_system = ecs.system().add_write_components<BenchLifetime>().build();
+
+		if ( use_commands ) {
+			ecs.system_set_method( age_system, []( LE_ECS_WRITE_ONLY_PARAMS, void* user_data ) {
+				auto params   = static_cast<ecs_churn_params_t*>( user_data );
+				auto lifetime = LE_ECS_GET_WRITE_PARAM( 0, BenchLifetime );
+				if ( --lifetime->frames_left == 0 ) {
+					auto commands = params->ecs->commands();
+					commands.remove_entity( entity );
+					EntityId spawned = commands.create_entity();
+					commands.add_component( spawned, BenchPosition{ 0, 0, 0 } );
+					commands.add_component( spawned, BenchLifetime{ 8 } );
+					commands.add_component( spawned, BenchSpawned{} );
+				}
+			} );
+		} else {
+			// Can't use execute_systems here, as expired is not thread-safe.
+			ecs.system_set_method( age_system, []( LE_ECS_WRITE_ONLY_PARAMS, void* user_data ) {
+				auto params   = static_cast<ecs_churn_params_t*>( user_data );
+				auto lifetime = LE_ECS_GET_WRITE_PARAM( 0, BenchLifetime );
+				if ( --lifetime->frames_left == 0 ) {
+					params->expired->push_back( entity );
+				}
+			} );
+		}
+
+		auto t_start = clock_type::now();
+
+		for ( uint32_t f = 0; f != FRAMES; ++f ) {
+			if ( use_commands ) {
+				ecs.update_systems( &age_system, 1, &params );
+				ecs.flush_commands();
+			} else {
+				ecs.update_system( age_system, &params );
+				for ( auto e : expired ) {
+					ecs.remove_entity( e );
+					ecs.entity()
+					    .add_component( BenchPosition{ 0, 0, 0 } )
+					    .add_component( BenchLifetime{ 8 } )
+					    .add_component( BenchSpawned{} )
+					    .build();
+				}
+				expired.clear();
+			}
+		}
+
+		elapsed[ use_commands ] = elapsed_ms( t_start, clock_type::now() );
+
+		// Check that we still have the same number of entities, and that all
+		// entities are alive - every entity has been replaced at least once.
+
+		uint32_t counts[ 2 ] = {};
+		auto     count_system = ecs.system().add_read_components<BenchLifetime, BenchSpawned>().build();
+		ecs.system_set_method( count_system, []( LE_ECS_READ_ONLY_PARAMS, void* user_data ) {
+			auto lifetime = LE_ECS_GET_READ_PARAM( 0, BenchLifetime );
+			auto counts   = static_cast<uint32_t*>( user_data );
+			counts[ 0 ]++;
+			counts[ 1 ] += ( lifetime->frames_left != 0 );
+		} );
+		ecs.update_system( count_system, counts );
+
+		correct[ use_commands ] = ( counts[ 0 ] == ENTITY_COUNT && counts[ 1 ] == ENTITY_COUNT );
+	}
+
+	le_jobs::terminate();
+
+	logger.info( "ecs_commands: %d entities, changes applied directly: %8.3f ms per frame, via command buffers: %8.3f ms per frame (%5.2fx), result %s",
+	             ENTITY_COUNT, elapsed[ 0 ] / FRAMES, elapsed[ 1 ] / FRAMES, elapsed[ 0 ] / elapsed[ 1 ],
+	             correct[ 0 ] && correct[ 1 ] ? "correct" : "WRONG" );
+
+	report( self, "ecs_commands", "applied_directly", elapsed[ 0 ] / FRAMES, "ms", self->num_workers_max );
+	report( self, "ecs_commands", "command_buffers", elapsed[ 1 ] / FRAMES, "ms", self->num_workers_max );
+	report( self, "ecs_commands", "correct", correct[ 0 ] && correct[ 1 ], "bool", self->num_workers_max );
+}
+
+// ----------------------------------------------------------------------
+// ECS snapshot benchmark
+//
+// Writes a world to a snapshot file, and creates a second world by mapping
+// that file. Compares with building the same world entity by entity. Both
+// worlds then run the same frames, and lose the same entities - which
+// frees chunks adopted from the snapshot - and must arrive at the same result.
+
+static void benchmark_ecs_snapshot( benchmark_app_o* self ) {
+
+	constexpr uint32_t ENTITY_COUNT = 200000;
+	constexpr uint32_t FRAMES       = 5;
+	float const        dt           = 1.f / 60.f;
+	char const*        path         = "benchmark_ecs_snapshot.bin";
+
+	auto logger = LeLog( self->logger );
+
+	ecs_bench_world_t world;
+
+	auto t_start = clock_type::now();
+	ecs_bench_world_setup( world, ENTITY_COUNT );
+	double setup_ms = elapsed_ms( t_start, clock_type::now() );
+
+	for ( uint32_t f = 0; f != FRAMES; ++f ) {
+		for ( auto const& system : world.systems ) {
+			world.ecs.update_system( system, const_cast<float*>( &dt ) );
+		}
+	}
+
+	FILE* file = fopen( path, "wb" );
+
+	if ( nullptr == file ) {
+		logger.error( "ecs_snapshot: could not open file '%s' for writing", path );
+		return;
+	}
+
+	t_start = clock_type::now();
+#ifdef _WIN32
+	bool written = world.ecs.snapshot_write( _fileno( file ) );
+#else
+	bool written = world.ecs.snapshot_write( fileno( file ) );
+#endif
+	double write_ms = elapsed_ms( t_start, clock_type::now() );
+
+	fseek( file, 0, SEEK_END );
+	long file_size = ftell( file );
+	fclose( file );
+
+	t_start            = clock_type::now();
+	le_ecs_o* snapshot = written ? le_ecs::le_ecs_i.snapshot_map( path ) : nullptr;
+	double    map_ms   = elapsed_ms( t_start, clock_type::now() );
+
+	if ( nullptr == snapshot ) {
+		logger.error( "ecs_snapshot: could not %s snapshot '%s'", written ? "map" : "write", path );
+		remove( path );
+		return;
+	}
+
+	ecs_bench_world_t loaded( snapshot );
+	loaded.entities = world.entities; // entity ids are part of the snapshot
+	ecs_bench_world_add_systems( loaded );
+
+	bool correct = ecs_bench_world_checksum( loaded ) == ecs_bench_world_checksum( world );
+
+	for ( auto w : { &world, &loaded } ) {
+		for ( uint32_t f = 0; f != FRAMES; ++f ) {
+			for ( auto const& system : w->systems ) {
+				w->ecs.update_system( system, const_cast<float*>( &dt ) );
+			}
+		}
+		for ( size_t i = 0; i < w->entities.size(); i += 2 ) {
+			w->ecs.remove_entity( w->entities[ i ] );
+		}
+		for ( uint32_t i = 0; i != 1000; ++i ) {
+			w->ecs.entity().add_component( BenchPosition{ float( i ), 0.f, 0.f } );
+		}
+	}
+
+	correct = correct && ecs_bench_world_checksum( loaded ) == ecs_bench_world_checksum( world );
+
+	remove( path );
+
+	logger.info( "ecs_snapshot: %d entities, %.1f MB, build entity by entity: %8.3f ms, snapshot_write: %8.3f ms, snapshot_map: %8.3f ms (%5.0fx), result %s",
+	             ENTITY_COUNT, double( file_size ) / ( 1024 * 1024 ), setup_ms, write_ms, map_ms, setup_ms / map_ms,
+	             correct ? "correct" : "WRONG" );
+
+	report( self, "ecs_snapshot", "build", setup_ms, "ms" );
+	report( self, "ecs_snapshot", "snapshot_write", write_ms, "ms" );
+	report( self, "ecs_snapshot", "snapshot_map", map_ms, "ms" );
+	report( self, "ecs_snapshot", "correct", correct, "bool" );
+}
+
+// ----------------------------------------------------------------------
+
+#ifdef BENCHMARK_WITH_LE_PATH
+
+// ----------------------------------------------------------------------
+// Path flattening benchmark
+//
+// Flattens a path of many random curves - half of them cubic, half of them
+// quadratic - once via flatten, and once via flatten_uniform, which
+// evaluates curves in batches using SIMD. Reports throughput in curves per
+// second, vertices per curve, and the largest distance of any point on any
+// curve to its polyline, which for flatten_uniform must stay within
+// tolerance.
+
+struct path_curve_t {
+	glm::vec2 p0; // start point
+	glm::vec2 c1; // control point - the only control point for quadratic curves
+	glm::vec2 c2; // control point, unused for quadratic curves
+	glm::vec2 p1; // end point
+	bool      is_quadratic;
+};
+
+// Point on curve at t, quadratic curves are elevated to cubic curves.
+static glm::vec2 path_curve_at( path_curve_t const& c, float t ) {
+	glm::vec2 c1 = c.c1;
+	glm::vec2 c2 = c.c2;
+	if ( c.is_quadratic ) {
+		c1 = c.p0 + 2 / 3.f * ( c.c1 - c.p0 );
+		c2 = c.p1 + 2 / 3.f * ( c.c1 - c.p1 );
+	}
+	float const u = 1 - t;
+	return u * u * u * c.p0 + 3 * u * u * t * c1 + 3 * u * t * t * c2 + t * t * t * c.p1;
+}
+
+static float distance_to_line_segment( glm::vec2 const& p, glm::vec2 const& a, glm::vec2 const& b ) {
+	glm::vec2 const ab   = b - a;
+	float const     l_sq = glm::dot( ab, ab );
+	float const     t    = l_sq > 0 ? std::clamp( glm::dot( p - a, ab ) / l_sq, 0.f, 1.f ) : 0.f;
+	return glm::distance( p, a + t * ab );
+}
+
+// Random curves within a 500 x 500 square - from a fixed seed, so that every
+// run sees the same curves. Each contour is a run of connected curves.
+static void path_curves_generate( std::vector<path_curve_t>& curves, uint32_t num_contours, uint32_t curves_per_contour ) {
+
+	uint64_t state  = 1;
+	auto     random = [ & ]() -> float {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return 500.f * float( state >> 40 ) / float( 1 << 24 );
+	};
+
+	curves.reserve( num_contours * curves_per_contour );
+
+	for ( uint32_t i = 0; i != num_contours; ++i ) {
+		glm::vec2 p0{ random(), random() };
+		for ( uint32_t j = 0; j != curves_per_contour; ++j ) {
+			path_curve_t c{ p0, { random(), random() }, { random(), random() }, { random(), random() }, bool( j & 1 ) };
+			curves.push_back( c );
+			p0 = c.p1;
+		}
+	}
+}
+
+// Add curves to path, one contour per `curves_per_contour` curves. Contours
+// whose index is a multiple of `moved_stride` get moved by `offset`.
+static void path_add_curves( le::Path& path, std::vector<path_curve_t> const& curves, uint32_t curves_per_contour, uint32_t moved_stride = 0, glm::vec2 const& offset = glm::vec2( 0.f ) ) {
+
+	for ( size_t i = 0; i != curves.size(); ++i ) {
+
+		bool const      is_moved = moved_stride && ( i / curves_per_contour ) % moved_stride == 0;
+		glm::vec2 const d        = is_moved ? offset : glm::vec2( 0.f );
+
+		path_curve_t const& c = curves[ i ];
+
+		if ( i % curves_per_contour == 0 ) {
+			path.moveTo( c.p0 + d );
+		}
+		if ( c.is_quadratic ) {
+			path.quadBezierTo( c.p1 + d, c.c1 + d );
+		} else {
+			path.cubicBezierTo( c.p1 + d, c.c1 + d, c.c2 + d );
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void benchmark_path_flatten( benchmark_app_o* self ) {
+
+	constexpr uint32_t CONTOURS           = 20000;
+	constexpr uint32_t CURVES_PER_CONTOUR = 8;
+	constexpr uint32_t ROUNDS             = 5;
+	constexpr uint32_t CHECKED_CONTOURS   = 256; // contours for which we check accuracy
+	constexpr uint32_t CHECKED_SAMPLES    = 64;  // samples per curve for accuracy check
+	constexpr float    TOLERANCE          = 0.25f;
+
+	auto logger = LeLog( self->logger );
+
+	std::vector<path_curve_t> curves;
+	path_curves_generate( curves, CONTOURS, CURVES_PER_CONTOUR );
+
+	double                 curves_per_s[ 2 ]       = {};
+	double                 vertices_per_curve[ 2 ] = {};
+	float                  max_error[ 2 ]          = {};
+	std::vector<glm::vec2> vertices;
+
+	for ( int use_uniform = 0; use_uniform != 2; ++use_uniform ) {
+
+		double flatten_ms = 0;
+
+		// Each round flattens a new path: flattening the same path again would
+		// find all polylines up to date, and return right away.
+
+		for ( uint32_t r = 0; r != ROUNDS; ++r ) {
+			le::Path path;
+			path_add_curves( path, curves, CURVES_PER_CONTOUR );
+
+			auto t_start = clock_type::now();
+			if ( use_uniform ) {
+				path.flattenUniform( TOLERANCE );
+			} else {
+				path.flatten( TOLERANCE );
+			}
+			flatten_ms += elapsed_ms( t_start, clock_type::now() );
+		}
+
+		curves_per_s[ use_uniform ] = 1000.0 * double( ROUNDS ) * curves.size() / flatten_ms;
+
+		le::Path path;
+		path_add_curves( path, curves, CURVES_PER_CONTOUR );
+
+		if ( use_uniform ) {
+			path.flattenUniform( TOLERANCE );
+		} else {
+			path.flatten( TOLERANCE );
+		}
+
+		size_t num_vertices = 0;
+
+		for ( size_t i = 0; i != CONTOURS; ++i ) {
+
+			size_t count = 0;
+			path.getVerticesForPolyline( i, nullptr, &count );
+			num_vertices += count;
+
+			if ( i >= CHECKED_CONTOURS ) {
+				continue;
+			}
+
+			vertices.resize( count );
+			path.getVerticesForPolyline( i, vertices.data(), &count );
+
+			// Distance from points on each curve of this contour to the nearest line segment of the polyline.
+
+			for ( uint32_t j = 0; j != CURVES_PER_CONTOUR; ++j ) {
+				for ( uint32_t k = 0; k <= CHECKED_SAMPLES; ++k ) {
+					glm::vec2 const p    = path_curve_at( curves[ i * CURVES_PER_CONTOUR + j ], float( k ) / CHECKED_SAMPLES );
+					float           best = std::numeric_limits<float>::max();
+					for ( size_t v = 1; v < count; ++v ) {
+						best = std::min( best, distance_to_line_segment( p, vertices[ v - 1 ], vertices[ v ] ) );
+					}
+					max_error[ use_uniform ] = std::max( max_error[ use_uniform ], best );
+				}
+			}
+		}
+
+		vertices_per_curve[ use_uniform ] = double( num_vertices ) / curves.size();
+	}
+
+	// Allow for a little float rounding on top of tolerance. Only flatten_uniform
+	// must stay within tolerance - flatten may exceed it next to cusps.
+	bool const correct = max_error[ 1 ] <= TOLERANCE * 1.01f;
+
+	// SIMD width which le_path was compiled with - flatten_uniform results are only
+	// comparable between builds with the same lane count.
+	uint32_t const lane_count = le_path::le_path_i.get_flatten_uniform_lane_count();
+
+	logger.info( "path_flatten: flatten: %6.3f M curves/s, %5.2f vertices/curve, max error: %8.4f; flatten_uniform (%u lanes): %6.3f M curves/s, %5.2f vertices/curve, max error: %6.4f (tolerance: %4.2f), %s",
+	             curves_per_s[ 0 ] / 1e6, vertices_per_curve[ 0 ], max_error[ 0 ],
+	             lane_count, curves_per_s[ 1 ] / 1e6, vertices_per_curve[ 1 ], max_error[ 1 ],
+	             TOLERANCE, correct ? "correct" : "WRONG" );
+
+	if ( max_error[ 0 ] > TOLERANCE * 1.01f ) {
+		logger.warn( "path_flatten: flatten exceeds tolerance by up to %5.1fx - its throughput is not directly comparable with flatten_uniform",
+		             max_error[ 0 ] / TOLERANCE );
+	}
+
+	report( self, "path_flatten", "flatten", curves_per_s[ 0 ], "1/s" );
+	report( self, "path_flatten", "flatten_uniform", curves_per_s[ 1 ], "1/s" );
+	report( self, "path_flatten", "flatten_vertices_per_curve", vertices_per_curve[ 0 ], "count" );
+	report( self, "path_flatten", "flatten_uniform_vertices_per_curve", vertices_per_curve[ 1 ], "count" );
+	report( self, "path_flatten", "flatten_max_error", max_error[ 0 ], "px" );
+	report( self, "path_flatten", "flatten_uniform_max_error", max_error[ 1 ], "px" );
+	report( self, "path_flatten", "flatten_uniform_lane_count", lane_count, "count" );
+	report( self, "path_flatten", "correct", correct, "bool" );
+}
+
+// ----------------------------------------------------------------------
+// Path re-flatten benchmark
+//
+// An animated path: every frame, the path is cleared, and rebuilt - but only
+// one in a hundred contours has moved since the last frame. Flatten only needs
+// to regenerate polylines for contours which have changed. Compared with
+// flattening a new path every frame, and checks that both arrive at the same
+// vertices.
+
+static void benchmark_path_reflatten( benchmark_app_o* self ) {
+
+	constexpr uint32_t CONTOURS           = 20000;
+	constexpr uint32_t CURVES_PER_CONTOUR = 8;
+	constexpr uint32_t MOVED_STRIDE       = 100; // one in MOVED_STRIDE contours moves every frame
+	constexpr uint32_t FRAMES             = 10;
+	constexpr float    TOLERANCE          = 0.25f;
+
+	auto logger = LeLog( self->logger );
+
+	std::vector<path_curve_t> curves;
+	path_curves_generate( curves, CONTOURS, CURVES_PER_CONTOUR );
+
+	le::Path animated;
+
+	path_add_curves( animated, curves, CURVES_PER_CONTOUR );
+	animated.flatten( TOLERANCE );
+
+	double                 ms[ 2 ] = {}; // [0]: re-flatten animated path, [1]: flatten new path
+	bool                   correct = true;
+	std::vector<glm::vec2> vertices[ 2 ];
+
+	for ( uint32_t frame = 1; frame <= FRAMES; ++frame ) {
+
+		glm::vec2 const offset{ float( frame ), 0.f };
+
+		animated.clear();
+		path_add_curves( animated, curves, CURVES_PER_CONTOUR, MOVED_STRIDE, offset );
+
+		auto t_start = clock_type::now();
+		animated.flatten( TOLERANCE );
+		ms[ 0 ] += elapsed_ms( t_start, clock_type::now() );
+
+		le::Path fresh;
+		path_add_curves( fresh, curves, CURVES_PER_CONTOUR, MOVED_STRIDE, offset );
+
+		t_start = clock_type::now();
+		fresh.flatten( TOLERANCE );
+		ms[ 1 ] += elapsed_ms( t_start, clock_type::now() );
+
+		correct &= animated.getNumPolylines() == fresh.getNumPolylines();
+
+		for ( size_t i = 0; correct && i != fresh.getNumPolylines(); ++i ) {
+			le::Path* paths[ 2 ] = { &animated, &fresh };
+			size_t    counts[ 2 ] = {};
+			for ( int p = 0; p != 2; ++p ) {
+				paths[ p ]->getVerticesForPolyline( i, nullptr, &counts[ p ] );
+				vertices[ p ].resize( counts[ p ] );
+				paths[ p ]->getVerticesForPolyline( i, vertices[ p ].data(), &counts[ p ] );
+			}
+			correct = counts[ 0 ] == counts[ 1 ] &&
+			          0 == memcmp( vertices[ 0 ].data(), vertices[ 1 ].data(), counts[ 0 ] * sizeof( glm::vec2 ) );
+		}
+	}
+
+	ms[ 0 ] /= FRAMES;
+	ms[ 1 ] /= FRAMES;
+
+	logger.info( "path_reflatten: %u contours, %u moved per frame - re-flatten: %8.3f ms/frame, flatten new path: %8.3f ms/frame, speedup: %5.1fx, %s",
+	             CONTOURS, CONTOURS / MOVED_STRIDE, ms[ 0 ], ms[ 1 ], ms[ 1 ] / ms[ 0 ], correct ? "correct" : "WRONG" );
+
+	report( self, "path_reflatten", "reflatten", ms[ 0 ], "ms" );
+	report( self, "path_reflatten", "flatten_new_path", ms[ 1 ], "ms" );
+	report( self, "path_reflatten", "correct", correct, "bool" );
+}
+
+// ----------------------------------------------------------------------
+//
+// Many small paths, as in glyphs or icons: each path gets built from a few
+// closed contours, which hobby smooths into curves, then flattened, cloned,
+// and destroyed. Commands and polylines of a path live in a few flat arrays,
+// which keeps the number of allocations per path small. Checks that clones
+// hold the same polylines as the paths they were cloned from.
+
+static void benchmark_path_small_paths( benchmark_app_o* self ) {
+
+	constexpr uint32_t PATHS              = 20000;
+	constexpr uint32_t CONTOURS_PER_PATH  = 3;
+	constexpr uint32_t POINTS_PER_CONTOUR = 6;
+	constexpr uint32_t ROUNDS             = 5;
+	constexpr float    TOLERANCE          = 0.25f;
+
+	auto logger = LeLog( self->logger );
+
+	auto const& path_i = le_path::le_path_i;
+
+	uint64_t state  = 1;
+	auto     random = [ & ]() -> float {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return 100.f * float( state >> 40 ) / float( 1 << 24 );
+	};
+
+	std::vector<glm::vec2> points( CONTOURS_PER_PATH * POINTS_PER_CONTOUR );
+
+	for ( auto& p : points ) {
+		p = { random(), random() };
+	}
+
+	std::vector<le_path_o*> paths( PATHS );
+	std::vector<le_path_o*> clones( PATHS );
+
+	double ms[ 4 ] = {}; // [0]: build and hobby, [1]: flatten, [2]: clone, [3]: destroy
+	bool   correct = true;
+
+	std::vector<glm::vec2> vertices[ 2 ];
+
+	for ( uint32_t round = 0; round != ROUNDS; ++round ) {
+
+		auto t_start = clock_type::now();
+
+		for ( auto& path : paths ) {
+			path = path_i.create();
+			for ( uint32_t c = 0; c != CONTOURS_PER_PATH; ++c ) {
+				glm::vec2 const* p = points.data() + c * POINTS_PER_CONTOUR;
+				path_i.move_to( path, p );
+				for ( uint32_t i = 1; i != POINTS_PER_CONTOUR; ++i ) {
+					path_i.line_to( path, p + i );
+				}
+				path_i.close( path );
+				path_i.hobby( path );
+			}
+		}
+
+		auto t_build = clock_type::now();
+
+		for ( auto path : paths ) {
+			path_i.flatten( path, TOLERANCE );
+		}
+
+		auto t_flatten = clock_type::now();
+
+		for ( size_t i = 0; i != PATHS; ++i ) {
+			clones[ i ] = path_i.clone( paths[ i ] );
+		}
+
+		auto t_clone = clock_type::now();
+
+		// Check a sample of clones, outside of timed sections.
+		for ( size_t i = round; correct && i < PATHS; i += 97 ) {
+			le_path_o* checked[ 2 ] = { paths[ i ], clones[ i ] };
+			correct = path_i.get_num_polylines( checked[ 0 ] ) == path_i.get_num_polylines( checked[ 1 ] );
+			for ( size_t j = 0; correct && j != path_i.get_num_polylines( checked[ 0 ] ); ++j ) {
+				size_t counts[ 2 ] = {};
+				for ( int p = 0; p != 2; ++p ) {
+					path_i.get_vertices_for_polyline( checked[ p ], j, nullptr, &counts[ p ] );
+					vertices[ p ].resize( counts[ p ] );
+					path_i.get_vertices_for_polyline( checked[ p ], j, vertices[ p ].data(), &counts[ p ] );
+				}
+				correct = counts[ 0 ] == counts[ 1 ] && counts[ 0 ] != 0 &&
+				          0 == memcmp( vertices[ 0 ].data(), vertices[ 1 ].data(), counts[ 0 ] * sizeof( glm::vec2 ) );
+			}
+		}
+
+		auto t_destroy = clock_type::now();
+
+		for ( size_t i = 0; i != PATHS; ++i ) {
+			path_i.destroy( paths[ i ] );
+			path_i.destroy( clones[ i ] );
+		}
+
+		auto t_end = clock_type::now();
+
+		ms[ 0 ] += elapsed_ms( t_start, t_build );
+		ms[ 1 ] += elapsed_ms( t_build, t_flatten );
+		ms[ 2 ] += elapsed_ms( t_flatten, t_clone );
+		ms[ 3 ] += elapsed_ms( t_destroy, t_end );
+	}
+
+	double ns_per_path[ 4 ];
+
+	for ( int i = 0; i != 4; ++i ) {
+		ns_per_path[ i ] = ms[ i ] * 1e6 / ( double( PATHS ) * ROUNDS );
+	}
+
+	logger.info( "path_small_paths: %u paths of %u contours - build: %7.1f ns/path, flatten: %7.1f ns/path, clone: %7.1f ns/path, destroy: %7.1f ns/path, %s",
+	             PATHS, CONTOURS_PER_PATH, ns_per_path[ 0 ], ns_per_path[ 1 ], ns_per_path[ 2 ], ns_per_path[ 3 ], correct ? "correct" : "WRONG" );
+
+	report( self, "path_small_paths", "build", ns_per_path[ 0 ], "ns" );
+	report( self, "path_small_paths", "flatten", ns_per_path[ 1 ], "ns" );
+	report( self, "path_small_paths", "clone", ns_per_path[ 2 ], "ns" );
+	report( self, "path_small_paths", "destroy", ns_per_path[ 3 ], "ns" );
+	report( self, "path_small_paths", "correct", correct, "bool" );
+}
+
+// ----------------------------------------------------------------------
+//
+// Particles animated along a long polyline: samples positions and tangents at
+// many normalized positions at once, once in random order, and once sorted,
+// in which case lookups may continue from the previous sample's segment.
+// Checks a subset of samples against walking the polyline's vertices.
+
+static void benchmark_path_sample( benchmark_app_o* self ) {
+
+	constexpr uint32_t CURVES          = 2000;
+	constexpr uint32_t SAMPLES         = 1 << 20;
+	constexpr uint32_t CHECKED_SAMPLES = 1000;
+	constexpr uint32_t ROUNDS          = 3;
+	constexpr float    TOLERANCE       = 0.25f;
+
+	auto logger = LeLog( self->logger );
+
+	std::vector<path_curve_t> curves;
+	path_curves_generate( curves, 1, CURVES );
+
+	le::Path path;
+	path_add_curves( path, curves, CURVES );
+	path.flatten( TOLERANCE );
+
+	size_t num_vertices = 0;
+	path.getVerticesForPolyline( 0, nullptr, &num_vertices );
+	std::vector<glm::vec2> polyline( num_vertices );
+	path.getVerticesForPolyline( 0, polyline.data(), &num_vertices );
+
+	uint64_t state  = 1;
+	auto     random = [ & ]() -> float {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return float( state >> 40 ) / float( 1 << 24 );
+	};
+
+	std::vector<float> positions[ 2 ]; // [0]: random order, [1]: sorted
+	positions[ 0 ].resize( SAMPLES );
+
+	for ( auto& t : positions[ 0 ] ) {
+		t = random();
+	}
+
+	positions[ 1 ] = positions[ 0 ];
+	std::sort( positions[ 1 ].begin(), positions[ 1 ].end() );
+
+	std::vector<glm::vec2> vertices( SAMPLES );
+	std::vector<glm::vec2> tangents( SAMPLES );
+
+	double samples_per_s[ 2 ] = {};
+	bool   correct            = true;
+
+	for ( int order = 0; order != 2; ++order ) {
+
+		double best_ms = 0;
+
+		for ( uint32_t round = 0; round != ROUNDS; ++round ) {
+			auto t_start = clock_type::now();
+			path.samplePolylineAtPositions( 0, positions[ order ].data(), SAMPLES, vertices.data(), tangents.data() );
+			double ms = elapsed_ms( t_start, clock_type::now() );
+			best_ms   = ( round == 0 ) ? ms : std::min( best_ms, ms );
+		}
+
+		samples_per_s[ order ] = SAMPLES / ( best_ms / 1000.0 );
+
+		// Every sample must lie on the segment between the vertices whose
+		// distances along the polyline enclose the sample's distance.
+		float total_distance = 0;
+		for ( size_t i = 1; i < polyline.size(); ++i ) {
+			total_distance += glm::distance( polyline[ i - 1 ], polyline[ i ] );
+		}
+
+		// Distances along the polyline are floats, which only hold about seven
+		// significant digits: allow for errors relative to the polyline's length.
+		float const max_error = total_distance * 1e-6f;
+
+		for ( uint32_t i = 0; correct && i < SAMPLES; i += SAMPLES / CHECKED_SAMPLES ) {
+			float     d        = positions[ order ][ i ] * total_distance;
+			float     walked   = 0;
+			glm::vec2 expected = polyline.back();
+			for ( size_t j = 1; j < polyline.size(); ++j ) {
+				float segment = glm::distance( polyline[ j - 1 ], polyline[ j ] );
+				if ( walked + segment >= d ) {
+					expected = polyline[ j - 1 ] + ( ( d - walked ) / segment ) * ( polyline[ j ] - polyline[ j - 1 ] );
+					break;
+				}
+				walked += segment;
+			}
+			correct = glm::distance( expected, vertices[ i ] ) <= max_error;
+		}
+	}
+
+	logger.info( "path_sample: %zu vertices - random order: %7.2f M samples/s, sorted: %7.2f M samples/s, %s",
+	             polyline.size(), samples_per_s[ 0 ] / 1e6, samples_per_s[ 1 ] / 1e6, correct ? "correct" : "WRONG" );
+
+	report( self, "path_sample", "random_order", samples_per_s[ 0 ], "1/s" );
+	report( self, "path_sample", "sorted", samples_per_s[ 1 ], "1/s" );
+	report( self, "path_sample", "correct", correct, "bool" );
+}
+
+#endif // BENCHMARK_WITH_LE_PATH
+
+// ----------------------------------------------------------------------
+
+static benchmark_fn benchmarks[] = {
+    benchmark_jobs_scaling,
+    benchmark_jobs_idle_and_wakeup,
+    benchmark_jobs_fan_out,
+    benchmark_jobs_parallel_for,
+    benchmark_jobs_wait_chain,
+    benchmark_jobs_yield,
+    benchmark_jobs_scratch,
+    benchmark_jobs_instrumentation,
+    benchmark_jobs_priority,
+    benchmark_jobs_continuations,
+    benchmark_jobs_tasks,
+    benchmark_ecs_systems,
+    benchmark_ecs_iteration,
+    benchmark_ecs_commands,
+    benchmark_ecs_snapshot,
+#ifdef BENCHMARK_WITH_LE_PATH
+    benchmark_path_flatten,
+    benchmark_path_reflatten,
+    benchmark_path_small_paths,
+    benchmark_path_sample,
+#endif
+};
+
+// ----------------------------------------------------------------------
+
+static bool benchmark_app_update( benchmark_app_o* self ) {
+
+	if ( self->current_benchmark >= sizeof( benchmarks ) / sizeof( benchmarks[ 0 ] ) ) {
+		benchmark_app_write_results( self );
+		if ( self->failed ) {
+			// Only log this as an error once all benchmarks have run and results
+			// have been written, since debug builds raise a breakpoint on errors.
+			LeLog( self->logger ).error( "Some benchmarks arrived at wrong results - see warnings above." );
+		}
+		return false; // all benchmarks done - quit app
+	}
+
+	benchmarks[ self->current_benchmark++ ]( self );
+
+	return true; // keep app alive
+}
+
+// ----------------------------------------------------------------------
+
+static bool benchmark_app_has_failed( benchmark_app_o* self ) {
+	return self->failed;
+}
+
+// ----------------------------------------------------------------------
+
+static void benchmark_app_destroy( benchmark_app_o* self ) {
+	delete ( self );
+}
+
+// ----------------------------------------------------------------------
+
+LE_MODULE_REGISTER_IMPL( benchmark_app, api ) {
+
+	auto  benchmark_app_api_i = static_cast<benchmark_app_api*>( api );
+	auto& benchmark_app_i     = benchmark_app_api_i->benchmark_app_i;
+
+	benchmark_app_i.initialize = app_initialize;
+	benchmark_app_i.terminate  = app_terminate;
+
+	benchmark_app_i.create  = benchmark_app_create;
+	benchmark_app_i.destroy = benchmark_app_destroy;
+	benchmark_app_i.update  = benchmark_app_update;
+
+	benchmark_app_i.has_failed = benchmark_app_has_failed;
+}
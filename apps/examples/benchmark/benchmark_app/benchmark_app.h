@@ -0,0 +1,67 @@
+#ifndef GUARD_benchmark_app_H
+#define GUARD_benchmark_app_H
+#endif
+
+#include "le_core.h"
+
+// Headless app: runs a fixed set of benchmarks once, then quits.
+
+struct benchmark_app_o;
+
+// clang-format off
+struct benchmark_app_api {
+
+	struct benchmark_app_interface_t {
+		benchmark_app_o * ( *create               )();
+		void         ( *destroy                  )( benchmark_app_o *self );
+		bool         ( *update                   )( benchmark_app_o *self );
+		bool         ( *has_failed               )( benchmark_app_o *self ); // whether any correctness check failed
+		void         ( *initialize               )(); // static methods
+		void         ( *terminate                )(); // static methods
+	};
+
+	benchmark_app_interface_t benchmark_app_i;
+};
+// clang-format on
+
+LE_MODULE( benchmark_app );
+LE_MODULE_LOAD_DEFAULT( benchmark_app );
+
+#ifdef __cplusplus
+
+namespace benchmark_app {
+static const auto& api             = benchmark_app_api_i;
+static const auto& benchmark_app_i = api -> benchmark_app_i;
+} // namespace benchmark_app
+
+class BenchmarkApp : NoCopy, NoMove {
+
+	benchmark_app_o* self;
+
+  public:
+	BenchmarkApp()
+	    : self( benchmark_app::benchmark_app_i.create() ) {
+	}
+
+	bool update() {
+		return benchmark_app::benchmark_app_i.update( self );
+	}
+
+	bool hasFailed() {
+		return benchmark_app::benchmark_app_i.has_failed( self );
+	}
+
+	~BenchmarkApp() {
+		benchmark_app::benchmark_app_i.destroy( self );
+	}
+
+	static void initialize() {
+		benchmark_app::benchmark_app_i.initialize();
+	}
+
+	static void terminate() {
+		benchmark_app::benchmark_app_i.terminate();
+	}
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include "benchmark_app/benchmark_app.h"
+
+// ----------------------------------------------------------------------
+
+int main( int argc, char const* argv[] ) {
+
+	BenchmarkApp::initialize();
+
+	bool failed = false;
+
+	{
+		// We instantiate BenchmarkApp in its own scope - so that
+		// it will be destroyed before BenchmarkApp::terminate
+		// is called.
+
+		BenchmarkApp BenchmarkApp{};
+
+		for ( ;; ) {
+
+#ifdef PLUGINS_DYNAMIC
+			le_core_poll_for_module_reloads();
+#endif
+			auto result = BenchmarkApp.update();
+
+			if ( !result ) {
+				break;
+			}
+		}
+
+		failed = BenchmarkApp.hasFailed();
+	}
+
+	// Must only be called once last BenchmarkApp is destroyed
+	BenchmarkApp::terminate();
+
+	return failed ? 1 : 0; // so that scripts may tell when any benchmark arrived at a wrong result
+}
@@ -3,6 +3,7 @@
 
 #include "le_log.h"
 #include "le_console.h"
+#include "le_jobs.h"
 
 #include <algorithm>
 #include <cstdio>
@@ -1272,6 +1273,58 @@ static void cb_exit_command( Command const* cmd, std::string const& str, std::ve
 static void cb_cls_command( Command const* cmd, std::string const& str, std::vector<char const*> const& tokens, le_console_o::connection_t* connection ) {
 	tty_clear_screen( connection );
 }
+
+// Print scheduler counters for each worker of the job system.
+static void cb_jobs_stats_command( Command const* cmd, std::string const& str, std::vector<char const*> const& tokens, le_console_o::connection_t* connection ) {
+
+	std::vector<le_jobs::worker_stats_t> stats( le_jobs::get_worker_stats( nullptr, 0 ) );
+
+	if ( stats.empty() ) {
+		connection->channel_out.post( "Job system is not running.\n\r" );
+		return;
+	}
+
+	le_jobs::get_worker_stats( stats.data(), uint32_t( stats.size() ) );
+
+	le_jobs::allocation_stats_t alloc_stats{};
+	le_jobs::get_allocation_stats( &alloc_stats );
+
+	char line[ 256 ];
+
+	std::ostringstream msg;
+	msg << "worker       jobs   busy ms   idle ms    steals    yields     waits  no fiber  max depth\n\r";
+
+	for ( size_t i = 0; i != stats.size(); ++i ) {
+		auto const& w = stats[ i ];
+		snprintf( line, sizeof( line ), "%-6s %10llu %9.1f %9.1f %9llu %9llu %9llu %9llu %10u\n\r",
+		          ( i + 1 == stats.size() ) ? "helper" : std::to_string( i ).c_str(),
+		          ( unsigned long long )w.jobs_executed, double( w.busy_ns ) / 1e6, double( w.idle_ns ) / 1e6,
+		          ( unsigned long long )w.steals, ( unsigned long long )w.yields, ( unsigned long long )w.waits,
+		          ( unsigned long long )w.fiber_pool_exhausted, w.queue_depth_max );
+		msg << line;
+	}
+
+	snprintf( line, sizeof( line ), "fibers: %u, max global queue depth: %u\n\r", alloc_stats.fiber_count, alloc_stats.job_queue_depth_max );
+	msg << line;
+
+	connection->channel_out.post( msg.str() );
+}
+
+// Write most recent job events as Chrome trace to the given path, or to "le_jobs_trace.json".
+static void cb_jobs_trace_command( Command const* cmd, std::string const& str, std::vector<char const*> const& tokens, le_console_o::connection_t* connection ) {
+
+	char const* path = ( tokens.size() == 3 ) ? tokens[ 2 ] : "le_jobs_trace.json";
+
+	std::ostringstream msg;
+
+	if ( le_jobs::write_chrome_trace( path ) ) {
+		msg << "Wrote job trace to '" << path << "'\n\r";
+	} else {
+		msg << "Could not write job trace to '" << path << "' - tracing must be enabled via le_jobs settings_t::trace_capacity.\n\r";
+	}
+
+	connection->channel_out.post( msg.str() );
+}
 // ------------------------------------------------------------------------------------------
 
 static void le_console_setup_commands( le_console_o* self ) {
@@ -1329,6 +1382,9 @@ static void le_console_setup_commands( le_console_o* self ) {
 	    ->addSubCommand( Command::New( "tty", cb_init_tty_command ) )
 	    ->addSubCommand( Command::New( "cls", cb_cls_command ) )
 	    ->addSubCommand( Command::New( "log", cb_log_command ) )
+	    ->addSubCommand( Command::New( "jobs", cb_jobs_stats_command )
+	                         ->addSubCommand( Command::New( "stats", cb_jobs_stats_command ) )
+	                         ->addSubCommand( Command::New( "trace", cb_jobs_trace_command ) ) )
 	    ->addSubCommand( Command::New( "exit", cb_exit_command ) );
 
 	self->cmd->updateAutocompleteCache();
@@ -1,23 +1,65 @@
 #include "le_ecs.h"
 #include "le_core.h"
 #include "le_hash_util.h"
+#include "le_jobs.h"
 
 #include <array>
 #include <vector>
-#include <bitset>
+#include <unordered_map>
+#include <new>
+#include <string.h>
 #include "assert.h"
 #include <algorithm>
+#include <atomic>
+#include <thread>
+
+#ifdef _WIN32
+#	define NOMINMAX     // we do this so that Windows.h does not define min and max macros
+#	include <windows.h> // for MapViewOfFile
+#	include <io.h>      // for _write
+#else
+#	include <sys/mman.h> // for mmap
+#	include <sys/stat.h> // for fstat
+#	include <fcntl.h>    // for open
+#	include <unistd.h>   // for write
+#	include <errno.h>    // for EINTR
+#endif
 
 /* Note
  *
- * Because we don't use sparse storage for our component data, we must iterate
- * over all entities previous to the entity which we want to access (seek).
+ * Component data is stored by archetype: all entities which have the exact
+ * same set of components (the same ComponentFilter) share an archetype.
  *
- * Generally, this is not all too bad, as systems will iterate over entities in sequence.
+ * An archetype stores its entities in fixed-size chunks. Each chunk holds
+ * one column per (non-flag) component type, which means that the components
+ * of all entities within a chunk are tightly packed, structure-of-arrays
+ * style. Rows are kept dense - removing an entity from an archetype moves
+ * the archetype's last entity into the gap.
  *
- * But removing entities becomes rather costly, as each entity removal operation means
- * a seek for each component data type affected, plus one or more vector erase operations.
+ * Each entity remembers its archetype, and its row within that archetype,
+ * which means that accessing an entity's component is O(1) once the entity
+ * has been found. Systems only visit archetypes which match all the
+ * components which they require, and iterate over these linearly.
  *
+ * Each system caches which archetypes it matches, together with where to
+ * find its parameters within chunks of these archetypes. Since archetypes
+ * are never removed, and since an archetype's rows are always kept dense,
+ * a system only ever needs to test archetypes which have been added since
+ * it last ran - steady-state execution only touches matching data.
+ *
+ * Adding or removing a component moves an entity from one archetype to
+ * another, which copies the entity's component data.
+ *
+ * Snapshots store chunks as they are in memory. An ecs created from a
+ * snapshot maps the snapshot file copy-on-write, and its archetypes adopt
+ * chunks which live inside the mapping - see snapshot_map.
+ *
+ * EntityIds are generational handles: the lower 32 bits hold the index of
+ * a slot in le_ecs_o::entity_slots, the upper 32 bits the generation of that
+ * slot when the entity was created. A slot's generation changes whenever its
+ * entity is removed, which is how we detect stale handles. The slot points
+ * into le_ecs_o::entities, a dense array from which we swap-remove, so that
+ * creating, removing, and looking up entities are all O(1).
  *
  * CAVEAT:
  *
@@ -27,24 +69,156 @@
  *
  * this is a common limitation of ECS and a strategy around this is to record any changes
  * which you may want to apply from iniside the system, and apply these changes from the
- * main (controlling) thread. This works similar to a command buffer.
+ * main (controlling) thread. Use le_ecs_commands_o for this: each le_jobs worker records
+ * into its own command buffer, and flush_commands applies all recorded changes. Threads
+ * from outside of le_jobs share one command buffer - only one of them may record at a time.
  *
  */
 
-struct ComponentStorage {
-	std::vector<uint8_t> storage; // raw data
-};
-
-static constexpr size_t MAX_COMPONENT_TYPES = 128;
+static constexpr size_t   MAX_SYSTEM_PARAMETERS = 64;        // maximum number of read (and of write) components per system
+static constexpr size_t   CHUNK_SIZE            = 16 * 1024; // target size in bytes for a chunk of component data
+static constexpr size_t   COLUMN_ALIGNMENT      = 64;        // start of each column within a chunk is aligned to cache line
+static constexpr uint32_t ROWS_PER_JOB          = 2048;      // execute_systems: minimum number of entities per job, unless a system matches fewer
 
 using system_fn       = le_ecs_api::system_fn;
-using ComponentType   = le_ecs_api::ComponentType;        //
-using ComponentFilter = std::bitset<MAX_COMPONENT_TYPES>; // each bit corresponds to a component type and an index in le_ecs_o::components
-// if bit is set this means that entity has-a component of this type
+using system_batch_fn = le_ecs_api::system_batch_fn;
+using ComponentType   = le_ecs_api::ComponentType; //
+
+// Set of component types: each bit corresponds to a component type and an index in
+// le_ecs_o::component_types - if bit is set this means that entity has-a component of
+// this type. The set grows as needed, but the first 128 component types are stored
+// inline, so that for most worlds, filters never allocate.
+class ComponentFilter {
+	static constexpr size_t INLINE_WORDS = 2;
+
+	uint64_t              inline_words[ INLINE_WORDS ]{};
+	std::vector<uint64_t> extra_words; // words following inline_words - never ends with a zero word
+
+	uint64_t word( size_t w ) const {
+		if ( w < INLINE_WORDS ) {
+			return inline_words[ w ];
+		}
+		return ( w - INLINE_WORDS < extra_words.size() ) ? extra_words[ w - INLINE_WORDS ] : 0;
+	}
+
+	size_t word_count() const {
+		return INLINE_WORDS + extra_words.size();
+	}
+
+	uint64_t& word_ref( size_t w ) {
+		if ( w < INLINE_WORDS ) {
+			return inline_words[ w ];
+		}
+		if ( w - INLINE_WORDS >= extra_words.size() ) {
+			extra_words.resize( w - INLINE_WORDS + 1, 0 );
+		}
+		return extra_words[ w - INLINE_WORDS ];
+	}
+
+  public:
+	bool test( size_t i ) const {
+		return ( word( i / 64 ) >> ( i % 64 ) ) & 1;
+	}
+
+	void set( size_t i ) {
+		word_ref( i / 64 ) |= uint64_t( 1 ) << ( i % 64 );
+	}
+
+	void reset( size_t i ) {
+		if ( i / 64 < word_count() ) {
+			word_ref( i / 64 ) &= ~( uint64_t( 1 ) << ( i % 64 ) );
+		}
+		while ( !extra_words.empty() && extra_words.back() == 0 ) {
+			extra_words.pop_back();
+		}
+	}
+
+	// true if all component types in other are also in this filter
+	bool contains( ComponentFilter const& other ) const {
+		for ( size_t w = 0; w != other.word_count(); ++w ) {
+			if ( ( word( w ) & other.word( w ) ) != other.word( w ) ) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// true if any component type is in both this filter and other
+	bool intersects( ComponentFilter const& other ) const {
+		size_t const count = std::min( word_count(), other.word_count() );
+		for ( size_t w = 0; w != count; ++w ) {
+			if ( word( w ) & other.word( w ) ) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	ComponentFilter operator|( ComponentFilter const& other ) const {
+		ComponentFilter result = ( word_count() >= other.word_count() ) ? *this : other;
+		for ( size_t w = 0; w != result.word_count(); ++w ) {
+			result.word_ref( w ) = word( w ) | other.word( w );
+		}
+		return result;
+	}
+
+	bool operator==( ComponentFilter const& other ) const {
+		return inline_words[ 0 ] == other.inline_words[ 0 ] &&
+		       inline_words[ 1 ] == other.inline_words[ 1 ] &&
+		       extra_words == other.extra_words;
+	}
+
+	uint64_t hash() const {
+		uint64_t result = FNV1A_VAL_64_CONST;
+		for ( size_t w = 0; w != word_count(); ++w ) {
+			result = ( result ^ word( w ) ) * FNV1A_PRIME_64_CONST;
+		}
+		return result;
+	}
+};
+
+struct ComponentFilterHash {
+	size_t operator()( ComponentFilter const& filter ) const {
+		return size_t( filter.hash() );
+	}
+};
 
 struct Entity {
-	uint64_t        id; // unique id
-	ComponentFilter filter;
+	uint64_t id;        // EntityId for this entity: generation << 32 | slot index
+	uint32_t archetype; // index into le_ecs_o::archetypes
+	uint32_t row;       // row within archetype
+};
+
+struct EntitySlot {
+	uint32_t generation;  // generation of current (or next, if slot is free) entity using this slot, never 0
+	uint32_t dense_index; // index into le_ecs_o::entities if slot is in use, index of next free slot if slot is free
+};
+
+static constexpr uint32_t NO_FREE_SLOT = ~uint32_t( 0 );
+
+struct Chunk {
+	uint8_t* data; // one column per archetype component, each column holds rows_per_chunk elements
+};
+
+struct Archetype {
+	ComponentFilter       filter;                 // component types shared by all entities of this archetype
+	std::vector<size_t>   component_type_indices; // one entry per column: index into le_ecs_o::component_types, ascending, flag components have no column
+	std::vector<uint32_t> column_offsets;         // one entry per column: byte offset of column from start of chunk
+	std::vector<uint32_t> column_strides;         // one entry per column: number of bytes per element
+	uint32_t              rows_per_chunk;         //
+	uint32_t              chunk_size;             // number of bytes allocated per chunk
+	std::vector<Chunk>    chunks;                 // all chunks but the last one are full
+	std::vector<EntityId> entity_ids;             // entity id for each row, row i lives in chunk (i / rows_per_chunk)
+};
+
+// An archetype which matches a system, and where to find the system's
+// parameters within chunks of this archetype.
+struct SystemMatch {
+	uint32_t              archetype;     // index into le_ecs_o::archetypes
+	std::vector<uint32_t> read_offsets;  // per read parameter: byte offset of column from start of chunk
+	std::vector<uint32_t> read_strides;  // per read parameter: number of bytes per element, 0 for flag components
+	std::vector<uint32_t> write_offsets; // per write parameter: byte offset of column from start of chunk
+	std::vector<uint32_t> write_strides; // per write parameter: number of bytes per element, 0 for flag components
 };
 
 struct System {
@@ -54,50 +228,124 @@ struct System {
 	std::vector<size_t> read_component_indices;  // indices into component storage/component type
 	std::vector<size_t> write_component_indices; // indices into component storage/component type
 
-	system_fn fn; // we must cast params back to struct of entities' components
+	std::vector<SystemMatch> matches;           // cached: archetypes which provide all components required by this system
+	uint32_t                 archetypes_tested; // archetypes with index < archetypes_tested have been tested for matches
+
+	system_fn       fn;       // we must cast params back to struct of entities' components
+	system_batch_fn batch_fn; // alternative to fn: called once per run of entities, params point to arrays of components
+};
+
+// Deferred structural changes - see le_ecs_commands_o.
+
+enum class CommandType : uint32_t {
+	eEntityCreate,
+	eEntityRemove,
+	eEntityAddComponent,
+	eEntityRemoveComponent,
+};
+
+struct Command {
+	CommandType   type;
+	uint32_t      data_offset;    // eEntityAddComponent: offset of component data in le_ecs_commands_o::data
+	EntityId      entity;         // entity id, or pending entity id if entity is created by the same command buffer
+	ComponentType component_type; // eEntityAddComponent, eEntityRemoveComponent
+};
+
+static constexpr size_t   COMMAND_DATA_ALIGNMENT = 16;
+static constexpr size_t   MAX_COMMAND_BUFFERS    = 64 + 2; // one per le_jobs worker (max. 64), one for le_jobs' helper, one for any thread outside le_jobs
+static constexpr uint64_t PENDING_GENERATION     = 0;      // pending entity ids have generation 0, which no live entity ever has
+static constexpr uint32_t PENDING_SERIAL_BITS    = 24;     // pending entity ids: command buffer index << PENDING_SERIAL_BITS | serial number within command buffer
+static constexpr uint32_t PENDING_SERIAL_MASK    = ( 1u << PENDING_SERIAL_BITS ) - 1;
+
+static_assert( MAX_COMMAND_BUFFERS <= ( 1u << ( 32 - PENDING_SERIAL_BITS ) ), "command buffer index must fit into pending entity id" );
+
+struct le_ecs_commands_o {
+	std::vector<Command> commands;
+	std::vector<uint8_t> data;                 // component data for eEntityAddComponent commands
+	uint32_t             num_pending_entities; // number of eEntityCreate commands
+	uint32_t             index;                // index into le_ecs_o::command_buffers, encoded into pending entity ids
 };
 
 struct le_ecs_o {
-	uint64_t                      next_entity_id = 0; // next available entity index (internal)
-	std::vector<ComponentType>    component_types;    // index corresponds to ComponentFilter[index]
-	std::vector<ComponentStorage> component_storage;  // one store per component type
-	std::vector<Entity>           entities;           // each entity may be different, index corresponds to entity ID, sorted by entity.id
-	std::vector<System>           systems;
+	std::vector<ComponentType>                          component_types;                // index corresponds to ComponentFilter[index]
+	std::unordered_map<uint64_t, size_t>                component_type_lookup;          // component type index for type hash
+	std::vector<Archetype>                              archetypes;                     // archetypes[0] is the archetype for entities without components, archetypes are never removed
+	std::unordered_map<ComponentFilter, uint32_t, ComponentFilterHash> archetype_lookup; // archetype index for filter
+	std::vector<EntitySlot>                             entity_slots;                   // sparse: indexed by slot index of EntityId
+	uint32_t                                            free_slot_head = NO_FREE_SLOT; // first free slot in entity_slots, slots form a linked list via dense_index
+	std::vector<Entity>                                 entities;                       // dense: all live entities, in no particular order
+	std::vector<System>                                 systems;                        //
+	std::array<le_ecs_commands_o*, MAX_COMMAND_BUFFERS> command_buffers{};              // one per thread, created on first use, see commands_get
+	std::vector<uint32_t>                               slot_pending;                   // flush_commands scratch: index into pending per entity slot, or NO_PENDING
+	uint8_t*                                            snapshot_mapping      = nullptr; // snapshot file, if ecs was created via snapshot_map - chunks inside this range are not ours to free
+	size_t                                              snapshot_mapping_size = 0;       //
+#ifndef NDEBUG
+	std::atomic<std::thread::id>                        external_recorder{};            // debug only: the thread from outside of le_jobs which may record into command_buffers[0] until flush_commands
+#endif
 };
 
 // ----------------------------------------------------------------------
 
+static uint32_t le_ecs_produce_archetype( le_ecs_o* self, ComponentFilter const& filter );
+
 static le_ecs_o* le_ecs_create() {
 	auto self = new le_ecs_o();
+	le_ecs_produce_archetype( self, ComponentFilter() ); // archetype for entities without any components
 	return self;
 }
 
+// ----------------------------------------------------------------------
+// free chunk memory - unless chunk was adopted from a snapshot mapping
+static void chunk_free( le_ecs_o const* self, Chunk const& chunk ) {
+	if ( chunk.data >= self->snapshot_mapping &&
+	     chunk.data < self->snapshot_mapping + self->snapshot_mapping_size ) {
+		return;
+	}
+	::operator delete( chunk.data, std::align_val_t( COLUMN_ALIGNMENT ) );
+}
+
 // ----------------------------------------------------------------------
 
 static void le_ecs_destroy( le_ecs_o* self ) {
+	for ( auto& commands : self->command_buffers ) {
+		delete commands;
+	}
+	for ( auto& archetype : self->archetypes ) {
+		for ( auto& chunk : archetype.chunks ) {
+			chunk_free( self, chunk );
+		}
+	}
+	if ( self->snapshot_mapping ) {
+#ifdef _WIN32
+		UnmapViewOfFile( self->snapshot_mapping );
+#else
+		munmap( self->snapshot_mapping, self->snapshot_mapping_size );
+#endif
+	}
 	delete self;
 }
 
 // ----------------------------------------------------------------------
 
+// return index into self->entities for entity id, or self->entities.size()
+// if entity id is stale, or invalid.
 static inline size_t get_index_from_entity_id( le_ecs_o const* self, EntityId id ) {
-	Entity search_entity;
-	search_entity.id = reinterpret_cast<size_t>( id );
-
-	auto found_element = std::lower_bound(
-	    self->entities.begin(), self->entities.end(), search_entity,
-	    []( Entity const& lhs, Entity const& rhs )
-	        -> bool { return lhs.id < rhs.id; } );
+	uint64_t const handle     = reinterpret_cast<uint64_t>( id );
+	uint32_t const slot_index = uint32_t( handle );
+	uint32_t const generation = uint32_t( handle >> 32 );
 
-	// index is pointer diff found_element - start
+	if ( slot_index >= self->entity_slots.size() ||
+	     self->entity_slots[ slot_index ].generation != generation ) {
+		return self->entities.size(); // entity was removed, or never existed
+	}
 
-	return ( found_element - self->entities.begin() );
+	return self->entity_slots[ slot_index ].dense_index;
 }
 
 // ----------------------------------------------------------------------
 
-static inline EntityId entity_get_entity_id( Entity const& e ) {
-	return reinterpret_cast<EntityId>( e.id );
+static inline EntityId entity_get_entity_id( uint64_t id ) {
+	return reinterpret_cast<EntityId>( id );
 }
 
 // ----------------------------------------------------------------------
@@ -110,51 +358,204 @@ static LeEcsSystemId get_system_id_from_index( size_t idx ) {
 	return reinterpret_cast<LeEcsSystemId>( idx );
 }
 
+// return index of component type, or component_types.size() if component type is not known.
 size_t le_ecs_find_component_type_index( le_ecs_o const* self, ComponentType const& component_type ) {
-	// Find component storage index
-	size_t     storage_index       = 0;
-	auto const component_types_end = self->component_types.data() + self->component_types.size();
-	for ( auto s_type = self->component_types.data(); s_type != component_types_end; storage_index++, s_type++ ) {
-		if ( s_type->type_hash == component_type.type_hash ) {
-			break;
-		}
+	auto it = self->component_type_lookup.find( component_type.type_hash );
+	return ( it != self->component_type_lookup.end() ) ? it->second : self->component_types.size();
+}
+
+// ----------------------------------------------------------------------
+
+static size_t le_ecs_produce_component_type_index( le_ecs_o* self, ComponentType const& component_type ) {
+
+	size_t storage_index = le_ecs_find_component_type_index( self, component_type );
+
+	if ( storage_index == self->component_types.size() ) {
+		// Component type is not yet known, we must add it
+		self->component_types.push_back( component_type );
+		self->component_type_lookup[ component_type.type_hash ] = storage_index;
 	}
 	return storage_index;
 }
 
 // ----------------------------------------------------------------------
-// Iterate over all entities, accumulating offset for component at storage_index
-inline uint32_t seek_offset( std::vector<Entity> const& entities, size_t e_idx, size_t storage_index, uint32_t stride ) {
+// return index of archetype for a given filter - create archetype if it
+// does not yet exist.
+static uint32_t le_ecs_produce_archetype( le_ecs_o* self, ComponentFilter const& filter ) {
+
+	auto it = self->archetype_lookup.find( filter );
+
+	if ( it != self->archetype_lookup.end() ) {
+		return it->second;
+	}
+
+	// ----------| Invariant: archetype does not yet exist, we must create it
+
+	Archetype archetype{};
+	archetype.filter = filter;
+
+	uint32_t row_size = 0; // number of bytes for all columns of one row
+
+	for ( size_t i = 0; i != self->component_types.size(); ++i ) {
+		if ( filter.test( i ) && self->component_types[ i ].num_bytes != 0 ) {
+			archetype.component_type_indices.push_back( i );
+			archetype.column_strides.push_back( self->component_types[ i ].num_bytes );
+			row_size += self->component_types[ i ].num_bytes;
+		}
+	}
+
+	// Find out how many rows fit into a chunk, leaving space for aligning
+	// the start of each column.
+
+	size_t const column_count = archetype.column_strides.size();
+	size_t const padding      = column_count * COLUMN_ALIGNMENT;
+
+	if ( row_size == 0 ) {
+		archetype.rows_per_chunk = CHUNK_SIZE;
+	} else if ( row_size + padding >= CHUNK_SIZE ) {
+		archetype.rows_per_chunk = 1; // components too large for our target chunk size
+	} else {
+		archetype.rows_per_chunk = uint32_t( ( CHUNK_SIZE - padding ) / row_size );
+	}
 
 	uint32_t offset = 0;
 
-	for ( size_t i = 0; i != e_idx; ++i ) {
-		if ( entities[ i ].filter.test( storage_index ) ) {
-			offset += stride;
+	for ( auto const& stride : archetype.column_strides ) {
+		archetype.column_offsets.push_back( offset );
+		offset += stride * archetype.rows_per_chunk;
+		offset = uint32_t( ( offset + COLUMN_ALIGNMENT - 1 ) & ~( COLUMN_ALIGNMENT - 1 ) );
+	}
+
+	archetype.chunk_size = offset;
+
+	uint32_t archetype_index = uint32_t( self->archetypes.size() );
+
+	self->archetypes.emplace_back( std::move( archetype ) );
+	self->archetype_lookup[ filter ] = archetype_index;
+
+	return archetype_index;
+}
+
+// ----------------------------------------------------------------------
+// return index of column for component type in archetype, or -1 if
+// archetype has no column for component type.
+static inline int32_t archetype_find_column( Archetype const& archetype, size_t component_type_index ) {
+	for ( size_t i = 0; i != archetype.component_type_indices.size(); ++i ) {
+		if ( archetype.component_type_indices[ i ] == component_type_index ) {
+			return int32_t( i );
 		}
 	}
+	return -1;
+}
 
-	return offset;
+// ----------------------------------------------------------------------
+
+static inline uint8_t* archetype_get_element( Archetype const& archetype, uint32_t row, size_t column ) {
+	Chunk const& chunk = archetype.chunks[ row / archetype.rows_per_chunk ];
+	return chunk.data +
+	       archetype.column_offsets[ column ] +
+	       size_t( archetype.column_strides[ column ] ) * ( row % archetype.rows_per_chunk );
 }
 
 // ----------------------------------------------------------------------
+// add a zero-initialised row for entity to archetype, return index of new row
+static uint32_t archetype_add_row( Archetype& archetype, EntityId entity_id ) {
 
-static size_t le_ecs_produce_component_type_index( le_ecs_o* self, ComponentType const& component_type ) {
+	uint32_t row = uint32_t( archetype.entity_ids.size() );
 
-	size_t storage_index = le_ecs_find_component_type_index( self, component_type );
+	if ( row == archetype.chunks.size() * archetype.rows_per_chunk ) {
+		// all chunks are full, we must add a chunk.
+		Chunk chunk{};
+		if ( archetype.chunk_size ) {
+			chunk.data = static_cast<uint8_t*>( ::operator new( archetype.chunk_size, std::align_val_t( COLUMN_ALIGNMENT ) ) );
+		}
+		archetype.chunks.push_back( chunk );
+	}
 
-	if ( storage_index == self->component_types.size() ) {
+	archetype.entity_ids.push_back( entity_id );
 
-		// Component storage for this component type does not yet exist, we must add it
+	for ( size_t c = 0; c != archetype.column_strides.size(); ++c ) {
+		memset( archetype_get_element( archetype, row, c ), 0, archetype.column_strides[ c ] );
+	}
 
-		self->component_types.push_back( component_type );
-		self->component_storage.push_back( {} );
+	return row;
+}
 
-		if ( component_type.num_bytes > 0 ) {
-			self->component_storage.back().storage.reserve( 4096 ); // reserve 1 page of memory, just in case.
+// ----------------------------------------------------------------------
+// remove row from archetype - this moves the last row of the archetype into
+// the gap, and we must update the entity which was moved.
+static void archetype_remove_row( le_ecs_o* self, uint32_t archetype_index, uint32_t row ) {
+
+	Archetype& archetype = self->archetypes[ archetype_index ];
+
+	uint32_t last_row = uint32_t( archetype.entity_ids.size() - 1 );
+
+	if ( row != last_row ) {
+		for ( size_t c = 0; c != archetype.column_strides.size(); ++c ) {
+			memcpy( archetype_get_element( archetype, row, c ),
+			        archetype_get_element( archetype, last_row, c ),
+			        archetype.column_strides[ c ] );
 		}
+
+		EntityId moved_entity_id          = archetype.entity_ids[ last_row ];
+		archetype.entity_ids[ row ]       = moved_entity_id;
+		size_t moved_e_idx                = get_index_from_entity_id( self, moved_entity_id );
+		self->entities[ moved_e_idx ].row = row;
 	}
-	return storage_index;
+
+	archetype.entity_ids.pop_back();
+
+	// Free chunks which have become unused - but keep one spare chunk, so that
+	// an entity which goes back and forth at a chunk boundary doesn't make us
+	// allocate and free every time.
+
+	size_t const chunks_needed = ( archetype.entity_ids.size() + archetype.rows_per_chunk - 1 ) / archetype.rows_per_chunk;
+
+	while ( archetype.chunks.size() > chunks_needed + 1 ) {
+		chunk_free( self, archetype.chunks.back() );
+		archetype.chunks.pop_back();
+	}
+}
+
+// ----------------------------------------------------------------------
+// move entity to the archetype which matches filter, keep any component
+// data which both archetypes have in common.
+static void entity_at_index_set_filter( le_ecs_o* self, size_t e_idx, ComponentFilter const& filter ) {
+
+	uint32_t src_index = self->entities[ e_idx ].archetype;
+	uint32_t dst_index = le_ecs_produce_archetype( self, filter ); // note: may re-allocate archetypes
+
+	if ( src_index == dst_index ) {
+		return;
+	}
+
+	Entity&    entity = self->entities[ e_idx ];
+	Archetype& src    = self->archetypes[ src_index ];
+	Archetype& dst    = self->archetypes[ dst_index ];
+
+	uint32_t src_row = entity.row;
+	uint32_t dst_row = archetype_add_row( dst, entity_get_entity_id( entity.id ) );
+
+	// Copy data for all columns which both archetypes share - columns are
+	// sorted by component type index, so we can walk both lists in step.
+
+	for ( size_t s = 0, d = 0; s != src.component_type_indices.size() && d != dst.component_type_indices.size(); ) {
+		if ( src.component_type_indices[ s ] < dst.component_type_indices[ d ] ) {
+			++s;
+		} else if ( src.component_type_indices[ s ] > dst.component_type_indices[ d ] ) {
+			++d;
+		} else {
+			memcpy( archetype_get_element( dst, dst_row, d ),
+			        archetype_get_element( src, src_row, s ),
+			        dst.column_strides[ d ] );
+			++s, ++d;
+		}
+	}
+
+	entity.archetype = dst_index;
+	entity.row       = dst_row;
+
+	archetype_remove_row( self, src_index, src_row );
 }
 
 // ----------------------------------------------------------------------
@@ -171,55 +572,33 @@ static void* le_ecs_entity_component_at( le_ecs_o* self, EntityId entity_id, Com
 		return nullptr;
 	}
 
-	auto& entity = self->entities.at( e_idx );
-
 	// -- Does component of this type already exist in component storage?
 	size_t component_type_index = le_ecs_produce_component_type_index( self, component_type );
 
-	if ( 0 == component_type.num_bytes ) {
-		// If component type is empty (a flag-only component), then we set the flag and return early.
-		entity.filter[ component_type_index ] = true;
-		return nullptr; // signal that no memory has been allocated.
-	}
-
-	// ----------| Invariant: Component is not flag-only
-
-	bool     needs_search     = true;
-	bool     needs_allocation = true;
-	uint32_t offset           = 0;
+	ComponentFilter const& filter = self->archetypes[ self->entities[ e_idx ].archetype ].filter;
 
-	if ( entity.filter.test( component_type_index ) ) {
-		// A component of this type was already present - we must return
-		// the current memory address for the component, and make sure
-		// not to allocate any more memory.
-		needs_search     = true;
-		needs_allocation = false;
-	} else {
-		entity.filter[ component_type_index ] = true;
-		needs_allocation                      = true;
+	if ( false == filter.test( component_type_index ) ) {
+		// Entity does not have a component of this type yet - we must move
+		// the entity to an archetype which includes this component.
+		ComponentFilter new_filter = filter;
+		new_filter.set( component_type_index );
+		entity_at_index_set_filter( self, e_idx, new_filter );
 	}
 
-	// If our entity is the last entity in the list of entities,
-	// our component memory will also be at the end of the corresponding
-	// component storage. This means in that case we don't have to search.
-
-	if ( e_idx == self->entities.size() - 1 ) {
-		needs_search = false;
+	if ( 0 == component_type.num_bytes ) {
+		// If component type is empty (a flag-only component), no memory is allocated.
+		return nullptr; // signal that no memory has been allocated.
 	}
 
-	auto& component_storage = self->component_storage[ component_type_index ].storage;
+	// ----------| Invariant: Component is not flag-only
 
-	if ( needs_search == false ) {
-		offset = uint32_t( component_storage.size() );
-	} else {
-		offset = seek_offset( self->entities, e_idx, component_type_index, self->component_types[ component_type_index ].num_bytes );
-	}
+	Entity const&    entity    = self->entities[ e_idx ];
+	Archetype const& archetype = self->archetypes[ entity.archetype ];
 
-	if ( needs_allocation ) {
-		component_storage.insert( component_storage.begin() + offset, component_type.num_bytes, 0 ); // zero-initialize data
-	}
+	int32_t column = archetype_find_column( archetype, component_type_index );
+	assert( column >= 0 );
 
-	return &component_storage[ offset ];
+	return archetype_get_element( archetype, entity.row, size_t( column ) );
 }
 
 // ----------------------------------------------------------------------
@@ -233,30 +612,16 @@ static void entity_at_index_remove_component( le_ecs_o* self, size_t e_idx, Comp
 		return;
 	}
 
-	auto& entity = self->entities.at( e_idx );
+	ComponentFilter filter = self->archetypes[ self->entities[ e_idx ].archetype ].filter;
 
-	if ( false == entity.filter[ storage_index ] ) {
+	if ( false == filter.test( storage_index ) ) {
 		return;
 	}
 
-	// ----------| Invariant: entity does not have such a component.
-
-	if ( 0 != component_type.num_bytes ) {
-
-		// -- If component has allocated storage, we must find it, and free it.
-		// We must iterate through all entities up until our current entity.
-		// If any entity has a component of our type, we must add to offset
-		// so that we may skip over it when deleting the data for our component.
-		uint32_t stride = component_type.num_bytes;
+	// ----------| Invariant: entity has such a component.
 
-		uint32_t offset = seek_offset( self->entities, e_idx, storage_index, stride );
-
-		auto& storage = self->component_storage[ storage_index ].storage;
-		storage.erase( storage.begin() + offset, storage.begin() + offset + stride );
-	}
-
-	// -- Remove flag which indicates that component is part of entity
-	entity.filter[ storage_index ] = false;
+	filter.reset( storage_index );
+	entity_at_index_set_filter( self, e_idx, filter );
 }
 
 // ----------------------------------------------------------------------
@@ -274,20 +639,44 @@ static void le_ecs_entity_remove_component( le_ecs_o* self, EntityId entity_id,
 	entity_at_index_remove_component( self, e_idx, component_type );
 }
 
+// ----------------------------------------------------------------------
+// create a new entity with zero-initialised components, as an entity of
+// the given archetype.
+static EntityId entity_create_in_archetype( le_ecs_o* self, uint32_t archetype_index ) {
+
+	// Re-use a free slot if possible, otherwise add a new slot.
+
+	uint32_t slot_index = self->free_slot_head;
+
+	if ( slot_index == NO_FREE_SLOT ) {
+		slot_index = uint32_t( self->entity_slots.size() );
+		self->entity_slots.push_back( { 1, 0 } ); // generation starts at 1, so that no EntityId is ever 0
+	} else {
+		self->free_slot_head = self->entity_slots[ slot_index ].dense_index;
+	}
+
+	EntitySlot& slot = self->entity_slots[ slot_index ];
+	slot.dense_index = uint32_t( self->entities.size() );
+
+	uint64_t this_entity_id = uint64_t( slot.generation ) << 32 | slot_index;
+
+	Entity new_entity{};
+	new_entity.id        = this_entity_id;
+	new_entity.archetype = archetype_index;
+	new_entity.row       = archetype_add_row( self->archetypes[ archetype_index ], entity_get_entity_id( this_entity_id ) );
+	self->entities.emplace_back( new_entity );
+	return entity_get_entity_id( this_entity_id );
+}
+
 // ----------------------------------------------------------------------
 // create a new, empty entity
 static EntityId le_ecs_entity_create( le_ecs_o* self ) {
-	size_t this_entity_id = self->next_entity_id;
-	self->next_entity_id++;
-	Entity new_entity{};
-	new_entity.id = this_entity_id;
-	self->entities.emplace_back( new_entity ); // add a new, empty entity
-	return reinterpret_cast<EntityId>( this_entity_id );
+	return entity_create_in_archetype( self, 0 ); // archetype for entities without components
 }
 
 // ----------------------------------------------------------------------
 // Remove entity from ecs.
-// this first removes any components, then the entity entry.
+// this removes the entity's row from its archetype, then the entity entry.
 static void le_ecs_entity_remove( le_ecs_o* self, EntityId entity_id ) {
 	// Find if entity exists
 	size_t e_idx = get_index_from_entity_id( self, entity_id );
@@ -297,33 +686,45 @@ static void le_ecs_entity_remove( le_ecs_o* self, EntityId entity_id ) {
 		return;
 	}
 
-	auto const& entity = self->entities.at( e_idx );
+	Entity const& entity = self->entities[ e_idx ];
 
-	// -- iterate to correct position at all components which use this entity
+	archetype_remove_row( self, entity.archetype, entity.row );
 
-	for ( uint32_t i = 0; i != MAX_COMPONENT_TYPES; ++i ) {
-		if ( entity.filter[ i ] ) {
-			entity_at_index_remove_component( self, e_idx, self->component_types[ i ] );
-		}
-		if ( entity.filter.none() ) {
-			break;
-		}
-	}
+	// Invalidate any handles to this entity by bumping the slot's
+	// generation, then put the slot on the free list.
+
+	uint32_t const slot_index = uint32_t( entity.id );
+	EntitySlot&    slot       = self->entity_slots[ slot_index ];
+
+	slot.generation  = ( slot.generation == ~uint32_t( 0 ) ) ? 1 : slot.generation + 1;
+	slot.dense_index = self->free_slot_head;
+
+	self->free_slot_head = slot_index;
+
+	// Swap-remove entity from dense array of entities - if we moved another
+	// entity into the gap, we must point its slot to its new position.
+
+	if ( e_idx != self->entities.size() - 1 ) {
+		self->entities[ e_idx ] = self->entities.back();
 
-	assert( entity.filter.none() && "entity must have no components left" );
+		self->entity_slots[ uint32_t( self->entities[ e_idx ].id ) ].dense_index = uint32_t( e_idx );
+	}
 
-	self->entities.erase( self->entities.begin() + uint32_t( e_idx ) );
+	self->entities.pop_back();
 }
 
 // ----------------------------------------------------------------------
 
 static LeEcsSystemId le_ecs_system_create( le_ecs_o* self ) {
 	self->systems.push_back( {
-	    0,
-	    0,
 	    {},
 	    {},
 	    {},
+	    {},
+	    {},
+	    0,
+	    {},
+	    {},
 	} );
 	return get_system_id_from_index( self->systems.size() - 1 );
 }
@@ -340,7 +741,24 @@ static void le_ecs_system_set_method( le_ecs_o* self, LeEcsSystemId system_id, s
 
 	auto& system = self->systems[ system_index ];
 
-	system.fn = fn;
+	system.fn       = fn;
+	system.batch_fn = nullptr;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_ecs_system_set_batch_method( le_ecs_o* self, LeEcsSystemId system_id, system_batch_fn fn ) {
+
+	size_t system_index = get_index_from_sytem_id( system_id );
+
+	assert( system_index < self->systems.size() );
+
+	// --------| invariant: system with this index exists.
+
+	auto& system = self->systems[ system_index ];
+
+	system.fn       = nullptr;
+	system.batch_fn = fn;
 }
 
 // ----------------------------------------------------------------------
@@ -366,9 +784,15 @@ static bool le_ecs_system_add_read_component( le_ecs_o* self, LeEcsSystemId syst
 
 	// we mark the the component to be used.
 
-	system.readComponents[ storage_index ] = true;
+	assert( system.read_component_indices.size() < MAX_SYSTEM_PARAMETERS );
+
+	system.readComponents.set( storage_index );
 	system.read_component_indices.push_back( storage_index );
 
+	// Cached matches are no longer valid - system requirements have changed.
+	system.matches.clear();
+	system.archetypes_tested = 0;
+
 	return true;
 }
 
@@ -395,14 +819,122 @@ static bool le_ecs_system_add_write_component( le_ecs_o* self, LeEcsSystemId sys
 
 	// we mark the the component to be used.
 
-	system.writeComponents[ storage_index ] = true;
+	assert( system.write_component_indices.size() < MAX_SYSTEM_PARAMETERS );
+
+	system.writeComponents.set( storage_index );
 	system.write_component_indices.push_back( storage_index );
 
+	// Cached matches are no longer valid - system requirements have changed.
+	system.matches.clear();
+	system.archetypes_tested = 0;
+
 	return true;
 }
 
 // ----------------------------------------------------------------------
 
+// Test any archetypes which have been added since system last ran, and
+// add the ones which provide all required components to system's matches.
+static void system_update_matches( le_ecs_o const* self, System& system ) {
+
+	if ( system.archetypes_tested == self->archetypes.size() ) {
+		return;
+	}
+
+	auto required_components = ( system.readComponents | system.writeComponents );
+
+	for ( ; system.archetypes_tested != self->archetypes.size(); ++system.archetypes_tested ) {
+
+		Archetype const& archetype = self->archetypes[ system.archetypes_tested ];
+
+		if ( !archetype.filter.contains( required_components ) ) {
+			continue;
+		}
+
+		// Find location of column within chunk for each system parameter.
+		// Flag components have no column - we pass nullptr for these.
+
+		SystemMatch match{};
+		match.archetype = system.archetypes_tested;
+
+		for ( auto const& type_index : system.read_component_indices ) {
+			int32_t column = archetype_find_column( archetype, type_index );
+			match.read_offsets.push_back( column < 0 ? 0 : archetype.column_offsets[ column ] );
+			match.read_strides.push_back( column < 0 ? 0 : archetype.column_strides[ column ] );
+		}
+
+		for ( auto const& type_index : system.write_component_indices ) {
+			int32_t column = archetype_find_column( archetype, type_index );
+			match.write_offsets.push_back( column < 0 ? 0 : archetype.column_offsets[ column ] );
+			match.write_strides.push_back( column < 0 ? 0 : archetype.column_strides[ column ] );
+		}
+
+		system.matches.emplace_back( std::move( match ) );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Call system function for rows [row_begin, row_end) of matching archetype.
+// row_begin must be the first row of a chunk.
+static void system_execute_rows( System const& system, SystemMatch const& match, Archetype const& archetype, uint32_t row_begin, uint32_t row_end, void* user_data ) {
+
+	assert( row_begin % archetype.rows_per_chunk == 0 );
+
+	size_t const read_count  = system.read_component_indices.size();
+	size_t const write_count = system.write_component_indices.size();
+
+	uint32_t const* read_offsets  = match.read_offsets.data();
+	uint32_t const* read_strides  = match.read_strides.data();
+	uint32_t const* write_offsets = match.write_offsets.data();
+	uint32_t const* write_strides = match.write_strides.data();
+
+	std::array<void const*, MAX_SYSTEM_PARAMETERS> read_containers;
+	std::array<void*, MAX_SYSTEM_PARAMETERS>       write_containers;
+
+	EntityId const* entity_id = archetype.entity_ids.data() + row_begin;
+
+	for ( uint32_t chunk_begin = row_begin; chunk_begin < row_end; chunk_begin += archetype.rows_per_chunk ) {
+
+		Chunk const& chunk     = archetype.chunks[ chunk_begin / archetype.rows_per_chunk ];
+		size_t const row_count = std::min<size_t>( row_end - chunk_begin, archetype.rows_per_chunk );
+
+		if ( system.batch_fn ) {
+
+			// Batch systems are called once per chunk, with pointers to the
+			// first element of each column, and the number of rows.
+
+			for ( size_t i = 0; i != read_count; ++i ) {
+				read_containers[ i ] = read_strides[ i ] ? chunk.data + read_offsets[ i ] : nullptr;
+			}
+			for ( size_t i = 0; i != write_count; ++i ) {
+				write_containers[ i ] = write_strides[ i ] ? chunk.data + write_offsets[ i ] : nullptr;
+			}
+
+			system.batch_fn( entity_id, uint32_t( row_count ), read_containers.data(), write_containers.data(), user_data );
+
+			entity_id += row_count;
+			continue;
+		}
+
+		for ( size_t row = 0; row != row_count; ++row, ++entity_id ) {
+
+			// group relevant components into structure which may be used
+
+			for ( size_t i = 0; i != read_count; ++i ) {
+				read_containers[ i ] = read_strides[ i ] ? chunk.data + read_offsets[ i ] + read_strides[ i ] * row : nullptr;
+			}
+			for ( size_t i = 0; i != write_count; ++i ) {
+				write_containers[ i ] = write_strides[ i ] ? chunk.data + write_offsets[ i ] + write_strides[ i ] * row : nullptr;
+			}
+
+			// this is where we call the function
+			system.fn( *entity_id, read_containers.data(), write_containers.data(), user_data );
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+
 static void le_ecs_execute_system( le_ecs_o* self, LeEcsSystemId system_id, void* user_data = nullptr ) {
 
 	// Filter all entities - we only want those which provide all the component types which our system
@@ -413,7 +945,7 @@ static void le_ecs_execute_system( le_ecs_o* self, LeEcsSystemId system_id, void
 
 	auto& system = self->systems.at( get_index_from_sytem_id( system_id ) );
 
-	if ( system.fn == nullptr ) {
+	if ( system.fn == nullptr && system.batch_fn == nullptr ) {
 		// if system does not define callable function there is
 		// we can return early.
 		return;
@@ -421,83 +953,819 @@ static void le_ecs_execute_system( le_ecs_o* self, LeEcsSystemId system_id, void
 
 	// --------| invariant: system provides callable function
 
-	const size_t types_count = self->component_types.size(); // total number of types/component stores inside this ecs.
+	system_update_matches( self, system );
 
-	auto required_components = ( system.readComponents | system.writeComponents );
+	// We only visit archetypes which provide all required components.
+
+	for ( auto const& match : system.matches ) {
+
+		Archetype const& archetype = self->archetypes[ match.archetype ];
+
+		if ( archetype.entity_ids.empty() ) {
+			continue;
+		}
+
+		system_execute_rows( system, match, archetype, 0, uint32_t( archetype.entity_ids.size() ), user_data );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Two systems conflict if either one writes a component which the other
+// one reads or writes - conflicting systems must not run concurrently.
+static inline bool systems_conflict( System const& a, System const& b ) {
+	return a.writeComponents.intersects( b.readComponents | b.writeComponents ) ||
+	       b.writeComponents.intersects( a.readComponents );
+}
+
+// ----------------------------------------------------------------------
+
+struct system_job_param_t {
+	System const*      system;
+	SystemMatch const* match;
+	Archetype const*   archetype;
+	uint32_t           row_begin;
+	uint32_t           row_end;
+	void*              user_data;
+};
+
+static void system_job_fun( void* param ) {
+	auto p = static_cast<system_job_param_t const*>( param );
+	system_execute_rows( *p->system, *p->match, *p->archetype, p->row_begin, p->row_end, p->user_data );
+}
+
+// ----------------------------------------------------------------------
+// Execute a list of systems, using le_jobs. Systems which don't conflict
+// with each other run concurrently, and matching entities of each system
+// are split into ranges which may be processed concurrently.
+//
+// The result is the same as if systems had been executed one after the
+// other, in the order given: a system only ever runs once all systems
+// earlier in the list, which it conflicts with, have completed.
+//
+// Must be called from outside of a system callback; le_jobs must have
+// been initialised.
+static void le_ecs_execute_systems( le_ecs_o* self, LeEcsSystemId const* system_ids, uint32_t num_systems, void* user_data ) {
+
+	if ( num_systems == 0 ) {
+		return;
+	}
+
+	// Assign each system to a phase - a system must run in a later phase
+	// than any earlier system in the list which it conflicts with. All
+	// systems within a phase may run concurrently.
+
+	std::vector<System*>  systems( num_systems );
+	std::vector<uint32_t> phases( num_systems, 0 );
+	uint32_t              num_phases = 0;
+
+	for ( uint32_t i = 0; i != num_systems; ++i ) {
+		systems[ i ] = &self->systems.at( get_index_from_sytem_id( system_ids[ i ] ) );
+		system_update_matches( self, *systems[ i ] );
+		for ( uint32_t j = 0; j != i; ++j ) {
+			if ( phases[ j ] >= phases[ i ] && systems_conflict( *systems[ i ], *systems[ j ] ) ) {
+				phases[ i ] = phases[ j ] + 1;
+			}
+		}
+		num_phases = std::max( num_phases, phases[ i ] + 1 );
+	}
+
+	std::vector<system_job_param_t> job_params;
+	std::vector<le_jobs::job_t>     jobs;
 
-	// Find indices for required components
+	for ( uint32_t phase = 0; phase != num_phases; ++phase ) {
 
-	std::array<size_t, MAX_COMPONENT_TYPES>      component_iterators; // current offset as object counts into component storage at index
-	std::array<void const*, MAX_COMPONENT_TYPES> read_containers;
-	std::array<void*, MAX_COMPONENT_TYPES>       write_containers;
+		job_params.clear();
 
-	component_iterators.fill( 0 );
-	read_containers.fill( nullptr );
-	write_containers.fill( nullptr );
+		for ( uint32_t i = 0; i != num_systems; ++i ) {
 
-	for ( auto& e : self->entities ) {
+			System const& system = *systems[ i ];
 
-		// We must test if all required components are present in current entity.
+			if ( phases[ i ] != phase || ( system.fn == nullptr && system.batch_fn == nullptr ) ) {
+				continue;
+			}
+
+			// Split matching rows of each archetype into ranges of whole
+			// chunks, with at least ROWS_PER_JOB rows per range.
+
+			for ( auto const& match : system.matches ) {
+
+				Archetype const& archetype = self->archetypes[ match.archetype ];
 
-		auto matching_components = ( e.filter & ( required_components ) );
+				if ( archetype.entity_ids.empty() ) {
+					continue;
+				}
+
+				uint32_t const row_count      = uint32_t( archetype.entity_ids.size() );
+				uint32_t const rows_per_range = archetype.rows_per_chunk * std::max<uint32_t>( 1, ROWS_PER_JOB / archetype.rows_per_chunk );
+
+				for ( uint32_t row = 0; row < row_count; row += rows_per_range ) {
+					job_params.push_back( { &system, &match, &archetype, row, std::min( row + rows_per_range, row_count ), user_data } );
+				}
+			}
+		}
 
-		if ( matching_components == 0 ) {
-			// if no needed components are present, we can safely jump over this entity.
+		if ( job_params.empty() ) {
 			continue;
 		}
 
-		if ( matching_components != required_components ) {
+		jobs.clear();
+
+		for ( auto& param : job_params ) {
+			jobs.push_back( { system_job_fun, &param } );
+		}
+
+		le_jobs::counter_t* counter;
+		le_jobs::run_jobs( jobs.data(), uint32_t( jobs.size() ), &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Return command buffer for the calling thread - we use le_jobs' worker id
+// to tell threads apart, so that each worker gets its own command buffer,
+// and may record commands without having to synchronise with anyone.
+//
+// All threads from outside of le_jobs share command buffer 0, which is why
+// only one of them may record commands between flushes.
+static le_ecs_commands_o* le_ecs_commands_get( le_ecs_o* self ) {
+
+	int32_t worker_id = le_jobs::get_current_worker_id();
+	size_t  index     = size_t( worker_id + 1 ); // any thread outside of le_jobs uses index 0
+
+	assert( index < MAX_COMMAND_BUFFERS );
+
+#ifndef NDEBUG
+	if ( index == 0 ) {
+		std::thread::id const this_thread = std::this_thread::get_id();
+		std::thread::id       recorder{};
+		self->external_recorder.compare_exchange_strong( recorder, this_thread );
+		assert( ( recorder == std::thread::id() || recorder == this_thread ) &&
+		        "only one thread from outside of le_jobs may record commands between flushes" );
+	}
+#endif
+
+	auto& commands = self->command_buffers[ index ];
+
+	if ( nullptr == commands ) {
+		commands        = new le_ecs_commands_o();
+		commands->index = uint32_t( index );
+	}
+
+	return commands;
+}
+
+// ----------------------------------------------------------------------
+// Record creating an entity. Returns a pending entity id, which is only
+// valid for recording further commands into the same command buffer.
+// Pending ids carry the index of their command buffer, so that flush_commands
+// can tell - and ignore - pending ids used with any other command buffer.
+static EntityId le_ecs_commands_entity_create( le_ecs_commands_o* self ) {
+	assert( self->num_pending_entities < PENDING_SERIAL_MASK && "too many entities created via one command buffer between flushes" );
+	uint32_t const serial     = ++self->num_pending_entities;
+	EntityId       pending_id = entity_get_entity_id( PENDING_GENERATION << 32 | uint64_t( self->index ) << PENDING_SERIAL_BITS | serial );
+	self->commands.push_back( { CommandType::eEntityCreate, 0, pending_id, {} } );
+	return pending_id;
+}
+
+// ----------------------------------------------------------------------
 
-			// If some but not all are present, we must make sure that the ones which were
-			// present do get iterated over, otherwise successive components of that type
-			// won't match up with their respective entity.
-			//
-			// This is only because we use sparse storage for our components, meaning we
-			// don't leave holes in our component storage, just because an entity doesn't
-			// use a specific type of component.
+static void le_ecs_commands_entity_remove( le_ecs_commands_o* self, EntityId entity ) {
+	self->commands.push_back( { CommandType::eEntityRemove, 0, entity, {} } );
+}
+
+// ----------------------------------------------------------------------
+// Record adding a component - returns memory into which to write component
+// data, or nullptr for flag components. As with entity_component_at, the
+// returned pointer is invalidated by recording any further commands.
+static void* le_ecs_commands_entity_add_component( le_ecs_commands_o* self, EntityId entity, ComponentType const& component_type ) {
 
-			// -- find out which components were present
-			// -- increase component_iterators for these components by 1
+	uint32_t data_offset = uint32_t( self->data.size() );
 
-			for ( size_t i = 0; i != types_count; ++i ) {
-				if ( matching_components[ i ] ) {
-					component_iterators[ i ]++;
+	if ( component_type.num_bytes ) {
+		size_t const size = ( component_type.num_bytes + COMMAND_DATA_ALIGNMENT - 1 ) & ~( COMMAND_DATA_ALIGNMENT - 1 );
+		self->data.resize( data_offset + size, 0 );
+	}
+
+	self->commands.push_back( { CommandType::eEntityAddComponent, data_offset, entity, component_type } );
+
+	return component_type.num_bytes ? self->data.data() + data_offset : nullptr;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_ecs_commands_entity_remove_component( le_ecs_commands_o* self, EntityId entity, ComponentType const& component_type ) {
+	self->commands.push_back( { CommandType::eEntityRemoveComponent, 0, entity, component_type } );
+}
+
+// ----------------------------------------------------------------------
+// Apply all commands recorded into any command buffers of this ecs, then
+// clear command buffers.
+//
+// We first replay all commands to find out the final set of components
+// for each affected entity. This way, each entity moves to its final
+// archetype at most once, no matter how many components were added or
+// removed. We then move entities sorted by their target archetype, so
+// that we append to one archetype after the other. Only then do we copy
+// recorded component data into place.
+//
+// Command buffers are applied in order of worker id - commands within
+// each command buffer are applied in the order in which they were recorded.
+static void le_ecs_flush_commands( le_ecs_o* self ) {
+
+#ifndef NDEBUG
+	self->external_recorder = std::thread::id(); // any thread from outside of le_jobs may record again
+#endif
+
+	struct PendingEntity {
+		EntityId        entity; // entity id, nullptr if entity is to be created
+		ComponentFilter filter; // components which entity must have after flush
+		bool            remove; // whether entity is to be removed
+		uint32_t        target; // target archetype
+		size_t          order;  // tie-breaker for sort: keeps entities in order of first mention
+	};
+
+	struct PendingWrite {
+		uint32_t       pending_index; // index into pending
+		size_t         type_index;    // component type index
+		uint8_t const* data;          // component data to copy
+	};
+
+	std::vector<PendingEntity>             pending;
+	std::vector<PendingWrite>              writes;
+	std::vector<uint32_t>                  pending_created; // pending entity id (per command buffer) -> index into pending
+
+	static constexpr uint32_t NO_PENDING = ~uint32_t( 0 );
+
+	self->slot_pending.resize( self->entity_slots.size(), NO_PENDING );
+
+	for ( auto commands : self->command_buffers ) {
+
+		if ( nullptr == commands || commands->commands.empty() ) {
+			continue;
+		}
+
+		pending_created.assign( commands->num_pending_entities + 1, 0 );
+
+		for ( auto const& cmd : commands->commands ) {
+
+			uint64_t const handle = reinterpret_cast<uint64_t>( cmd.entity );
+
+			// Find - or add - pending record for entity
+
+			uint32_t pending_index = 0;
+
+			if ( cmd.type == CommandType::eEntityCreate ) {
+				pending_index                                               = uint32_t( pending.size() );
+				pending_created[ uint32_t( handle ) & PENDING_SERIAL_MASK ] = pending_index;
+				pending.push_back( { nullptr, {}, false, 0, pending.size() } );
+				continue;
+			} else if ( ( handle >> 32 ) == PENDING_GENERATION ) {
+				uint32_t const serial = uint32_t( handle ) & PENDING_SERIAL_MASK;
+
+				if ( ( uint32_t( handle ) >> PENDING_SERIAL_BITS ) != commands->index ||
+				     serial == 0 || serial > commands->num_pending_entities ) {
+					continue; // pending entity id was recorded into another command buffer - ignore command.
+				}
+
+				pending_index = pending_created[ serial ];
+			} else {
+				size_t e_idx = get_index_from_entity_id( self, cmd.entity );
+
+				if ( e_idx >= self->entities.size() ) {
+					continue; // entity does not exist (anymore) - ignore command.
+				}
+
+				uint32_t& slot_pending = self->slot_pending[ uint32_t( handle ) ];
+
+				if ( slot_pending == NO_PENDING ) {
+					slot_pending = pending_index = uint32_t( pending.size() );
+					pending.push_back( { cmd.entity, self->archetypes[ self->entities[ e_idx ].archetype ].filter, false, 0, pending.size() } );
+				} else {
+					pending_index = slot_pending;
 				}
 			}
+
+			// Apply command to pending record
+
+			PendingEntity& p = pending[ pending_index ];
+
+			switch ( cmd.type ) {
+			case CommandType::eEntityRemove:
+				p.remove = true;
+				break;
+			case CommandType::eEntityAddComponent: {
+				size_t type_index = le_ecs_produce_component_type_index( self, cmd.component_type );
+				p.filter.set( type_index );
+				if ( cmd.component_type.num_bytes ) {
+					writes.push_back( { pending_index, type_index, commands->data.data() + cmd.data_offset } );
+				}
+			} break;
+			case CommandType::eEntityRemoveComponent: {
+				size_t type_index = le_ecs_find_component_type_index( self, cmd.component_type );
+				if ( type_index != self->component_types.size() ) {
+					p.filter.reset( type_index );
+				}
+			} break;
+			case CommandType::eEntityCreate:
+				break;
+			}
+		}
+	}
+
+	// We're done with recording pending entities - reset scratch.
+
+	for ( auto const& p : pending ) {
+		if ( p.entity ) {
+			self->slot_pending[ uint32_t( reinterpret_cast<uint64_t>( p.entity ) ) ] = NO_PENDING;
+		}
+	}
+
+	// -- Remove entities first, so that any rows which they free up may be reused.
+
+	for ( auto& p : pending ) {
+		if ( p.remove && p.entity ) {
+			le_ecs_entity_remove( self, p.entity );
+		}
+	}
+
+	// -- Find target archetypes, and sort entities so that we append to one archetype at a time.
+
+	std::vector<uint32_t> order;
+	order.reserve( pending.size() );
+
+	for ( uint32_t i = 0; i != pending.size(); ++i ) {
+		if ( !pending[ i ].remove ) {
+			pending[ i ].target = le_ecs_produce_archetype( self, pending[ i ].filter );
+			order.push_back( i );
+		}
+	}
+
+	std::sort( order.begin(), order.end(), [ &pending ]( uint32_t lhs, uint32_t rhs ) {
+		return pending[ lhs ].target != pending[ rhs ].target
+		           ? pending[ lhs ].target < pending[ rhs ].target
+		           : pending[ lhs ].order < pending[ rhs ].order;
+	} );
+
+	for ( auto i : order ) {
+		PendingEntity& p = pending[ i ];
+		if ( p.entity ) {
+			entity_at_index_set_filter( self, get_index_from_entity_id( self, p.entity ), p.filter );
+		} else {
+			p.entity = entity_create_in_archetype( self, p.target );
+		}
+	}
+
+	// -- Copy component data into place - later writes overwrite earlier ones.
+
+	for ( auto const& w : writes ) {
+
+		PendingEntity const& p = pending[ w.pending_index ];
+
+		if ( p.remove || !p.filter.test( w.type_index ) ) {
+			continue; // entity was removed, or component was removed again after it was added.
+		}
+
+		Entity const&    entity    = self->entities[ get_index_from_entity_id( self, p.entity ) ];
+		Archetype const& archetype = self->archetypes[ entity.archetype ];
+		int32_t          column    = archetype_find_column( archetype, w.type_index );
+
+		memcpy( archetype_get_element( archetype, entity.row, size_t( column ) ), w.data, archetype.column_strides[ column ] );
+	}
+
+	// -- Reset command buffers
+
+	for ( auto commands : self->command_buffers ) {
+		if ( commands ) {
+			commands->commands.clear();
+			commands->data.clear();
+			commands->num_pending_entities = 0;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Snapshots
+//
+// A snapshot file holds a header, followed by tables for component types,
+// archetypes, entity slots, and entities, followed by per-archetype lists
+// of component types and of entity ids, and the type_id strings of all
+// component types. All of this is copied out of the mapping when a
+// snapshot is loaded.
+//
+// Chunk data follows, starting at SNAPSHOT_DATA_ALIGNMENT: each archetype
+// stores its chunks back-to-back, and since chunk sizes are multiples of
+// COLUMN_ALIGNMENT, chunks within the mapped file are aligned just as if we
+// had allocated them. This is what lets us adopt chunks in-place.
+//
+// Offsets are in bytes from the start of the file. Snapshots are raw copies
+// of memory, and may only be loaded by the same version of le_ecs, on the
+// same platform - the header holds what we need to check for this.
+
+static constexpr char     SNAPSHOT_MAGIC[ 8 ]     = { 'L', 'E', '_', 'E', 'C', 'S', '_', 'S' };
+static constexpr uint32_t SNAPSHOT_VERSION        = 1;
+static constexpr size_t   SNAPSHOT_DATA_ALIGNMENT = 4096; // chunk data starts on its own page
+
+struct SnapshotHeader {
+	char     magic[ 8 ];             // SNAPSHOT_MAGIC
+	uint32_t version;                // SNAPSHOT_VERSION
+	uint32_t header_size;            // sizeof( SnapshotHeader )
+	uint32_t chunk_target_size;      // CHUNK_SIZE when snapshot was written, chunk layout depends on it
+	uint32_t column_alignment;       // COLUMN_ALIGNMENT when snapshot was written, chunk layout depends on it
+	uint32_t num_component_types;    //
+	uint32_t num_archetypes;         //
+	uint32_t num_entity_slots;       //
+	uint32_t num_entities;           //
+	uint32_t free_slot_head;         //
+	uint32_t reserved;               //
+	uint64_t component_types_offset; // SnapshotComponentType per component type
+	uint64_t archetypes_offset;      // SnapshotArchetype per archetype
+	uint64_t entity_slots_offset;    // EntitySlot per entity slot
+	uint64_t entities_offset;        // Entity per entity
+	uint64_t file_size;              // number of bytes in snapshot file
+};
+
+struct SnapshotComponentType {
+	uint64_t type_hash;      //
+	uint64_t type_id_offset; // zero-terminated type_id string, 0 if component type has no type_id
+	uint32_t num_bytes;      //
+	uint32_t reserved;       //
+};
+
+struct SnapshotArchetype {
+	uint64_t filter_offset;     // uint32_t index into component types, per component type in archetype filter
+	uint64_t entity_ids_offset; // EntityId per row
+	uint64_t chunks_offset;     // first chunk, further chunks follow back-to-back
+	uint32_t num_filter_types;  //
+	uint32_t num_rows;          //
+	uint32_t num_chunks;        //
+	uint32_t rows_per_chunk;    // must match archetype layout when loading
+	uint32_t chunk_size;        // must match archetype layout when loading
+	uint32_t reserved;          //
+};
+
+// ----------------------------------------------------------------------
+// pad blob to alignment, then append num_bytes from data (or zeroes, if data
+// is nullptr) - return offset at which bytes were appended.
+static uint64_t snapshot_append( std::vector<uint8_t>& blob, void const* data, size_t num_bytes, size_t alignment = 8 ) {
+	blob.resize( ( blob.size() + alignment - 1 ) & ~( alignment - 1 ), 0 );
+	uint64_t offset = blob.size();
+	blob.resize( blob.size() + num_bytes, 0 );
+	if ( data && num_bytes ) {
+		memcpy( blob.data() + offset, data, num_bytes );
+	}
+	return offset;
+}
+
+// ----------------------------------------------------------------------
+
+static bool snapshot_write_bytes( int fd, void const* data, size_t num_bytes ) {
+	auto bytes = static_cast<char const*>( data );
+	while ( num_bytes ) {
+#ifdef _WIN32
+		int result = _write( fd, bytes, unsigned( std::min<size_t>( num_bytes, 1 << 30 ) ) );
+#else
+		ssize_t result = write( fd, bytes, num_bytes );
+		if ( result < 0 && errno == EINTR ) {
 			continue;
 		}
+#endif
+		if ( result <= 0 ) {
+			return false;
+		}
+		bytes += result;
+		num_bytes -= size_t( result );
+	}
+	return true;
+}
+
+// ----------------------------------------------------------------------
+// Write all entities, and their components, to file descriptor fd.
+// Systems, and any commands which have not been flushed, are not included.
+static bool le_ecs_snapshot_write( le_ecs_o const* self, int fd ) {
+
+	SnapshotHeader header{};
+	memcpy( header.magic, SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) );
+	header.version             = SNAPSHOT_VERSION;
+	header.header_size         = sizeof( SnapshotHeader );
+	header.chunk_target_size   = uint32_t( CHUNK_SIZE );
+	header.column_alignment    = uint32_t( COLUMN_ALIGNMENT );
+	header.num_component_types = uint32_t( self->component_types.size() );
+	header.num_archetypes      = uint32_t( self->archetypes.size() );
+	header.num_entity_slots    = uint32_t( self->entity_slots.size() );
+	header.num_entities        = uint32_t( self->entities.size() );
+	header.free_slot_head      = self->free_slot_head;
+
+	std::vector<SnapshotComponentType> types( self->component_types.size() );
+	std::vector<SnapshotArchetype>     archetypes( self->archetypes.size() );
+
+	// Everything but chunk data goes into blob - we reserve space for
+	// header and tables, and fill these in once we know all offsets.
+
+	std::vector<uint8_t> blob;
+
+	snapshot_append( blob, nullptr, sizeof( SnapshotHeader ) );
+	header.component_types_offset = snapshot_append( blob, nullptr, sizeof( SnapshotComponentType ) * types.size() );
+	header.archetypes_offset      = snapshot_append( blob, nullptr, sizeof( SnapshotArchetype ) * archetypes.size() );
+	header.entity_slots_offset    = snapshot_append( blob, self->entity_slots.data(), sizeof( EntitySlot ) * self->entity_slots.size() );
+	header.entities_offset        = snapshot_append( blob, self->entities.data(), sizeof( Entity ) * self->entities.size() );
+
+	std::vector<uint32_t> filter_types;
+
+	for ( size_t i = 0; i != archetypes.size(); ++i ) {
+		Archetype const&   archetype = self->archetypes[ i ];
+		SnapshotArchetype& record    = archetypes[ i ];
+
+		filter_types.clear();
+		for ( size_t t = 0; t != self->component_types.size(); ++t ) {
+			if ( archetype.filter.test( t ) ) {
+				filter_types.push_back( uint32_t( t ) );
+			}
+		}
+
+		record.num_filter_types  = uint32_t( filter_types.size() );
+		record.num_rows          = uint32_t( archetype.entity_ids.size() );
+		record.num_chunks        = ( record.num_rows + archetype.rows_per_chunk - 1 ) / archetype.rows_per_chunk; // we don't store spare chunks
+		record.rows_per_chunk    = archetype.rows_per_chunk;
+		record.chunk_size        = archetype.chunk_size;
+		record.filter_offset     = snapshot_append( blob, filter_types.data(), sizeof( uint32_t ) * filter_types.size() );
+		record.entity_ids_offset = snapshot_append( blob, archetype.entity_ids.data(), sizeof( EntityId ) * archetype.entity_ids.size() );
+	}
 
-		// ---------| Invariant: all required components are present
+	for ( size_t i = 0; i != types.size(); ++i ) {
+		ComponentType const& type = self->component_types[ i ];
 
-		// group relevant components into structure which may be used
-		size_t read_containter_count  = 0;
-		size_t write_containter_count = 0;
+		types[ i ].type_hash = type.type_hash;
+		types[ i ].num_bytes = type.num_bytes;
 
-		for ( auto& read_component : system.read_component_indices ) {
-			read_containers[ read_containter_count++ ] =
-			    ( self->component_storage[ read_component ].storage.data() +
-			      self->component_types[ read_component ].num_bytes *
-			          component_iterators[ read_component ] );
+		if ( type.type_id ) {
+			types[ i ].type_id_offset = snapshot_append( blob, type.type_id, strlen( type.type_id ) + 1, 1 );
 		}
-		for ( auto& write_component : system.write_component_indices ) {
-			write_containers[ write_containter_count++ ] =
-			    ( self->component_storage[ write_component ].storage.data() +
-			      self->component_types[ write_component ].num_bytes *
-			          component_iterators[ write_component ] );
+	}
+
+	// Chunk data follows blob.
+
+	uint64_t data_offset = snapshot_append( blob, nullptr, 0, SNAPSHOT_DATA_ALIGNMENT );
+
+	for ( auto& record : archetypes ) {
+		record.chunks_offset = data_offset;
+		data_offset += uint64_t( record.num_chunks ) * record.chunk_size;
+	}
+
+	header.file_size = data_offset;
+
+	memcpy( blob.data(), &header, sizeof( SnapshotHeader ) );
+	memcpy( blob.data() + header.component_types_offset, types.data(), sizeof( SnapshotComponentType ) * types.size() );
+	memcpy( blob.data() + header.archetypes_offset, archetypes.data(), sizeof( SnapshotArchetype ) * archetypes.size() );
+
+	if ( !snapshot_write_bytes( fd, blob.data(), blob.size() ) ) {
+		return false;
+	}
+
+	for ( size_t i = 0; i != archetypes.size(); ++i ) {
+		for ( uint32_t c = 0; c != archetypes[ i ].num_chunks && archetypes[ i ].chunk_size; ++c ) {
+			if ( !snapshot_write_bytes( fd, self->archetypes[ i ].chunks[ c ].data, archetypes[ i ].chunk_size ) ) {
+				return false;
+			}
 		}
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+// Populate an empty ecs from the snapshot which it has mapped - archetypes
+// adopt chunks in-place. Return false if snapshot is not valid.
+static bool snapshot_adopt( le_ecs_o* self ) {
+
+	uint8_t* const file      = self->snapshot_mapping;
+	size_t const   file_size = self->snapshot_mapping_size;
+
+	// return true if [offset, offset + num_bytes) lies within file
+	auto in_file = [ file_size ]( uint64_t offset, uint64_t num_bytes ) -> bool {
+		return offset <= file_size && num_bytes <= file_size - offset;
+	};
+
+	SnapshotHeader header;
+
+	if ( !in_file( 0, sizeof( SnapshotHeader ) ) ) {
+		return false;
+	}
+
+	memcpy( &header, file, sizeof( SnapshotHeader ) );
+
+	if ( memcmp( header.magic, SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) ) ||
+	     header.version != SNAPSHOT_VERSION ||
+	     header.header_size != sizeof( SnapshotHeader ) ||
+	     header.chunk_target_size != CHUNK_SIZE ||
+	     header.column_alignment != COLUMN_ALIGNMENT ||
+	     header.file_size != file_size ||
+	     !in_file( header.component_types_offset, uint64_t( header.num_component_types ) * sizeof( SnapshotComponentType ) ) ||
+	     !in_file( header.archetypes_offset, uint64_t( header.num_archetypes ) * sizeof( SnapshotArchetype ) ) ||
+	     !in_file( header.entity_slots_offset, uint64_t( header.num_entity_slots ) * sizeof( EntitySlot ) ) ||
+	     !in_file( header.entities_offset, uint64_t( header.num_entities ) * sizeof( Entity ) ) ) {
+		return false;
+	}
 
-		// this is where we call the function
-		system.fn( entity_get_entity_id( e ), read_containers.data(), write_containers.data(), user_data );
+	// -- Component types: type_id strings point into the mapping.
 
-		// now we must increase component iterators for all elements which were
-		// named in required_components
+	for ( uint32_t i = 0; i != header.num_component_types; ++i ) {
+		SnapshotComponentType record;
+		memcpy( &record, file + header.component_types_offset + i * sizeof( SnapshotComponentType ), sizeof( SnapshotComponentType ) );
 
-		for ( size_t i = 0; i != types_count; ++i ) {
-			if ( matching_components[ i ] ) {
-				component_iterators[ i ]++;
+		ComponentType type{ record.type_hash, nullptr, record.num_bytes };
+
+		if ( record.type_id_offset ) {
+			if ( !in_file( record.type_id_offset, 1 ) ||
+			     nullptr == memchr( file + record.type_id_offset, 0, file_size - record.type_id_offset ) ) {
+				return false;
 			}
+			type.type_id = reinterpret_cast<char const*>( file + record.type_id_offset );
+		}
+
+		if ( le_ecs_produce_component_type_index( self, type ) != i ) {
+			return false; // duplicate component type
 		}
 	}
+
+	// -- Archetypes: we produce archetypes in the same order in which they were
+	// written, so that archetype indices stay the same - archetype 0 must be
+	// the archetype for entities without components, which already exists.
+
+	for ( uint32_t i = 0; i != header.num_archetypes; ++i ) {
+		SnapshotArchetype record;
+		memcpy( &record, file + header.archetypes_offset + i * sizeof( SnapshotArchetype ), sizeof( SnapshotArchetype ) );
+
+		if ( !in_file( record.filter_offset, uint64_t( record.num_filter_types ) * sizeof( uint32_t ) ) ||
+		     !in_file( record.entity_ids_offset, uint64_t( record.num_rows ) * sizeof( EntityId ) ) ||
+		     !in_file( record.chunks_offset, uint64_t( record.num_chunks ) * record.chunk_size ) ||
+		     record.chunks_offset % COLUMN_ALIGNMENT != 0 ) {
+			return false;
+		}
+
+		ComponentFilter filter;
+
+		for ( uint32_t t = 0; t != record.num_filter_types; ++t ) {
+			uint32_t type_index;
+			memcpy( &type_index, file + record.filter_offset + t * sizeof( uint32_t ), sizeof( uint32_t ) );
+			if ( type_index >= header.num_component_types ) {
+				return false;
+			}
+			filter.set( type_index );
+		}
+
+		if ( le_ecs_produce_archetype( self, filter ) != i ) {
+			return false; // duplicate archetype, or archetype 0 is not empty
+		}
+
+		Archetype& archetype = self->archetypes[ i ];
+
+		if ( archetype.rows_per_chunk != record.rows_per_chunk ||
+		     archetype.chunk_size != record.chunk_size ||
+		     record.num_chunks != ( record.num_rows + record.rows_per_chunk - 1 ) / record.rows_per_chunk ) {
+			return false; // chunk layout does not match
+		}
+
+		archetype.entity_ids.resize( record.num_rows );
+		memcpy( archetype.entity_ids.data(), file + record.entity_ids_offset, sizeof( EntityId ) * record.num_rows );
+
+		archetype.chunks.resize( record.num_chunks );
+		for ( uint32_t c = 0; c != record.num_chunks && record.chunk_size; ++c ) {
+			archetype.chunks[ c ].data = file + record.chunks_offset + size_t( c ) * record.chunk_size;
+		}
+	}
+
+	// -- Entities
+
+	self->entity_slots.resize( header.num_entity_slots );
+	memcpy( self->entity_slots.data(), file + header.entity_slots_offset, sizeof( EntitySlot ) * header.num_entity_slots );
+
+	self->entities.resize( header.num_entities );
+	memcpy( self->entities.data(), file + header.entities_offset, sizeof( Entity ) * header.num_entities );
+
+	self->free_slot_head = header.free_slot_head;
+
+	// -- Validate entity tables: lookups index without any further checks, which
+	// is why every index must be in range, and entities, slots, and archetype
+	// rows must all agree with each other.
+
+	static constexpr uint8_t SLOT_UNUSED = 0;
+	static constexpr uint8_t SLOT_IN_USE = 1;
+	static constexpr uint8_t SLOT_FREE   = 2;
+
+	std::vector<uint8_t> slot_state( header.num_entity_slots, SLOT_UNUSED );
+
+	for ( EntitySlot const& slot : self->entity_slots ) {
+		if ( slot.generation == 0 ) {
+			return false;
+		}
+	}
+
+	for ( size_t i = 0; i != self->entities.size(); ++i ) {
+		Entity const&  entity     = self->entities[ i ];
+		uint32_t const slot_index = uint32_t( entity.id );
+
+		if ( slot_index >= header.num_entity_slots ||
+		     slot_state[ slot_index ] != SLOT_UNUSED ||
+		     self->entity_slots[ slot_index ].generation != uint32_t( entity.id >> 32 ) ||
+		     self->entity_slots[ slot_index ].dense_index != i ||
+		     entity.archetype >= header.num_archetypes ||
+		     entity.row >= self->archetypes[ entity.archetype ].entity_ids.size() ||
+		     reinterpret_cast<uint64_t>( self->archetypes[ entity.archetype ].entity_ids[ entity.row ] ) != entity.id ) {
+			return false;
+		}
+
+		slot_state[ slot_index ] = SLOT_IN_USE;
+	}
+
+	// Every archetype row must belong to exactly one entity. Entities all have
+	// distinct ids, and each entity's row holds its id, which means that no two
+	// entities claim the same row - it's enough that rows and entities add up.
+
+	uint64_t num_rows = 0;
+
+	for ( Archetype const& archetype : self->archetypes ) {
+		num_rows += archetype.entity_ids.size();
+	}
+
+	if ( num_rows != header.num_entities ) {
+		return false;
+	}
+
+	// Free slots form a list which must hold exactly those slots which are not
+	// in use - we stop at the first slot visited twice, so that a cycle can't
+	// keep us here.
+
+	uint64_t num_free_slots = 0;
+
+	for ( uint32_t slot_index = self->free_slot_head; slot_index != NO_FREE_SLOT; slot_index = self->entity_slots[ slot_index ].dense_index ) {
+		if ( slot_index >= header.num_entity_slots || slot_state[ slot_index ] != SLOT_UNUSED ) {
+			return false;
+		}
+		slot_state[ slot_index ] = SLOT_FREE;
+		++num_free_slots;
+	}
+
+	if ( num_free_slots + header.num_entities != header.num_entity_slots ) {
+		return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+// Create a new ecs from a snapshot written via snapshot_write. We map the
+// snapshot file copy-on-write: component data is not copied, nor parsed,
+// but used where it lies - pages are only read from disk once touched.
+static le_ecs_o* le_ecs_snapshot_map( char const* path ) {
+
+	uint8_t* mapping      = nullptr;
+	size_t   mapping_size = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE ) {
+		return nullptr;
+	}
+	LARGE_INTEGER file_size;
+	if ( GetFileSizeEx( file, &file_size ) && file_size.QuadPart > 0 ) {
+		HANDLE file_mapping = CreateFileMappingA( file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr );
+		if ( file_mapping ) {
+			mapping      = static_cast<uint8_t*>( MapViewOfFile( file_mapping, FILE_MAP_COPY, 0, 0, 0 ) );
+			mapping_size = size_t( file_size.QuadPart );
+			CloseHandle( file_mapping ); // view keeps file mapping alive
+		}
+	}
+	CloseHandle( file );
+#else
+	int fd = open( path, O_RDONLY );
+	if ( fd < 0 ) {
+		return nullptr;
+	}
+	struct stat file_stat;
+	if ( fstat( fd, &file_stat ) == 0 && file_stat.st_size > 0 ) {
+		void* addr = mmap( nullptr, size_t( file_stat.st_size ), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+		if ( addr != MAP_FAILED ) {
+			mapping      = static_cast<uint8_t*>( addr );
+			mapping_size = size_t( file_stat.st_size );
+		}
+	}
+	close( fd ); // mapping keeps file alive
+#endif
+
+	if ( nullptr == mapping ) {
+		return nullptr;
+	}
+
+	le_ecs_o* self              = le_ecs_create();
+	self->snapshot_mapping      = mapping;
+	self->snapshot_mapping_size = mapping_size;
+
+	if ( !snapshot_adopt( self ) ) {
+		le_ecs_destroy( self ); // also unmaps snapshot
+		return nullptr;
+	}
+
+	return self;
 }
 
 // ----------------------------------------------------------------------
@@ -516,7 +1784,19 @@ LE_MODULE_REGISTER_IMPL( le_ecs, api ) {
 	le_ecs_i.system_create              = le_ecs_system_create;
 	le_ecs_i.system_add_read_component  = le_ecs_system_add_read_component;
 	le_ecs_i.system_set_method          = le_ecs_system_set_method;
+	le_ecs_i.system_set_batch_method    = le_ecs_system_set_batch_method;
 	le_ecs_i.system_add_write_component = le_ecs_system_add_write_component;
 
-	le_ecs_i.execute_system = le_ecs_execute_system;
+	le_ecs_i.execute_system  = le_ecs_execute_system;
+	le_ecs_i.execute_systems = le_ecs_execute_systems;
+
+	le_ecs_i.commands_get                     = le_ecs_commands_get;
+	le_ecs_i.commands_entity_create           = le_ecs_commands_entity_create;
+	le_ecs_i.commands_entity_remove           = le_ecs_commands_entity_remove;
+	le_ecs_i.commands_entity_add_component    = le_ecs_commands_entity_add_component;
+	le_ecs_i.commands_entity_remove_component = le_ecs_commands_entity_remove_component;
+	le_ecs_i.flush_commands                   = le_ecs_flush_commands;
+
+	le_ecs_i.snapshot_write = le_ecs_snapshot_write;
+	le_ecs_i.snapshot_map   = le_ecs_snapshot_map;
 }
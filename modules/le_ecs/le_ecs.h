@@ -2,9 +2,11 @@
 #define GUARD_le_ecs_H
 
 #include "le_core.h"
+#include "le_hash_util.h" // for hash_64_fnv1a_const
 #include "assert.h" // FIXME: we shouldn't include this here.
 
 struct le_ecs_o;
+struct le_ecs_commands_o; // records structural changes, to be applied later via flush_commands
 typedef struct EntityId_T* EntityId;
 typedef struct SystemId_T* LeEcsSystemId;
 
@@ -19,11 +21,18 @@ struct le_ecs_api {
 
 	typedef void ( *system_fn )( EntityId entity, void const **read_params, void **write_params, void* user_data );
 
+	// Batch systems are called once per contiguous run of matching entities: read_params and write_params
+	// point to the first of `count` tightly packed components each, so that the system may loop over them.
+	typedef void ( *system_batch_fn )( EntityId const* entities, uint32_t count, void const **read_params, void **write_params, void* user_data );
+
 	struct le_ecs_interface_t {
 
 		le_ecs_o * ( * create            ) ( );
 		void       ( * destroy           ) ( le_ecs_o* self );
 
+		// EntityIds are generational handles, and never 0. Once an entity has been removed,
+		// any EntityId referring to it is stale: methods which are given a stale EntityId
+		// do nothing, and return nullptr or false where applicable.
 		EntityId   ( * entity_create     ) ( le_ecs_o *self );
 		void       ( * entity_remove     ) ( le_ecs_o *self, EntityId entity);
 		
@@ -36,6 +45,7 @@ struct le_ecs_api {
 		LeEcsSystemId  ( *system_create    )( le_ecs_o *self );
 
 		void (* system_set_method          )( le_ecs_o*self, LeEcsSystemId system_id, system_fn fn);
+		void (* system_set_batch_method    )( le_ecs_o*self, LeEcsSystemId system_id, system_batch_fn fn); // replaces any method set via system_set_method, and vice versa
 		bool (* system_add_write_component )( le_ecs_o *self, LeEcsSystemId system_id, ComponentType const &component_type );
 		bool (* system_add_read_component  )( le_ecs_o *self, LeEcsSystemId system_id, ComponentType const &component_type );
 
@@ -44,6 +54,47 @@ struct le_ecs_api {
 
 		void ( *execute_system             )( le_ecs_o *self, LeEcsSystemId system_id, void* user_data ) ;
 
+		// Executes systems using le_jobs, which must have been initialised. Systems which don't
+		// conflict (neither writes a component which the other one reads or writes) run concurrently,
+		// and large systems are split into ranges of entities which run concurrently. Results are as
+		// if systems had been executed one after another, in the given order. Note that system
+		// callbacks may be called concurrently, and share user_data.
+		void ( *execute_systems            )( le_ecs_o *self, LeEcsSystemId const * system_ids, uint32_t num_systems, void* user_data );
+
+		// -- Deferred structural changes
+		//
+		// Systems must not create or remove entities or components directly. Instead, they
+		// record such changes into a command buffer, which is applied via flush_commands once
+		// systems have completed. Each le_jobs worker has its own command buffer, which commands_get
+		// returns - so that systems executing in parallel may record without synchronising. All
+		// threads from outside of le_jobs share one command buffer: between flushes, only one such
+		// thread may record commands (debug builds assert this). flush_commands must not be called
+		// while any systems are executing.
+
+		le_ecs_commands_o* ( *commands_get )( le_ecs_o* self ); // returns command buffer for the calling thread
+
+		// Returns a pending entity id - only valid for recording into the same command buffer, until flush.
+		// Commands which use a pending id with any other command buffer are ignored by flush_commands.
+		EntityId ( *commands_entity_create           )( le_ecs_commands_o* self );
+		void     ( *commands_entity_remove           )( le_ecs_commands_o* self, EntityId entity );
+
+		// Returns pointer to memory into which to store component data, or nullptr for flag components.
+		// Pointer is invalidated by recording any further commands into the same command buffer.
+		void*    ( *commands_entity_add_component    )( le_ecs_commands_o* self, EntityId entity, ComponentType const & component_type );
+		void     ( *commands_entity_remove_component )( le_ecs_commands_o* self, EntityId entity, ComponentType const & component_type );
+
+		// Applies, and then clears, commands recorded into all command buffers for this ecs.
+		void ( *flush_commands             )( le_ecs_o* self );
+
+		// Writes all entities, and their components, to file descriptor fd - returns false on error.
+		// Component data is written as it is laid out in memory: snapshots may only be loaded by
+		// the same version of le_ecs, on the same platform. Systems are not part of snapshots.
+		bool       ( *snapshot_write             )( le_ecs_o const* self, int fd );
+
+		// Creates a new ecs from a snapshot file, or returns nullptr if file is not a valid snapshot.
+		// The file is mapped into memory, and component data is used in-place, copy-on-write.
+		le_ecs_o * ( *snapshot_map               )( char const* path );
+
 		
 	};
 
@@ -81,6 +132,39 @@ LE_MODULE_LOAD_DEFAULT( le_ecs );
 #	define LE_ECS_GET_READ_PARAM( index, param_type ) \
 		static_cast<param_type const*>( read_c[ index ] )
 
+// Helper macros to define batch system callback signatures
+#	define LE_ECS_BATCH_READ_WRITE_PARAMS EntityId const *entities, uint32_t count, void const **read_c, void **write_c
+#	define LE_ECS_BATCH_WRITE_ONLY_PARAMS EntityId const *entities, uint32_t count, void const **, void **write_c
+#	define LE_ECS_BATCH_READ_ONLY_PARAMS EntityId const *entities, uint32_t count, void const **read_c, void **
+
+// use this inside a batch system callback to fetch a span of write parameters
+#	define LE_ECS_GET_WRITE_SPAN( index, param_type ) \
+		LeEcs::write_span<param_type>( write_c, index, count )
+
+// use this inside a batch system callback to fetch a span of read parameters
+#	define LE_ECS_GET_READ_SPAN( index, param_type ) \
+		LeEcs::read_span<param_type>( read_c, index, count )
+
+// Typed view onto `count` tightly packed components - as passed to batch systems.
+template <typename T>
+struct LeEcsSpan {
+	T*       data;
+	uint32_t count;
+
+	T& operator[]( uint32_t i ) const {
+		return data[ i ];
+	}
+	T* begin() const {
+		return data;
+	}
+	T* end() const {
+		return data + count;
+	}
+	uint32_t size() const {
+		return count;
+	}
+};
+
 namespace le_ecs {
 static const auto& api      = le_ecs_api_i;
 static const auto& le_ecs_i = api -> le_ecs_i;
@@ -94,6 +178,12 @@ class LeEcs : NoCopy, NoMove {
 	    : self( le_ecs::le_ecs_i.create() ) {
 	}
 
+	// Takes ownership of an existing ecs, such as one returned by snapshot_map.
+	explicit LeEcs( le_ecs_o* self_ )
+	    : self( self_ ) {
+		assert( self && "ecs must not be nullptr" );
+	}
+
 	~LeEcs() {
 		le_ecs::le_ecs_i.destroy( self );
 	}
@@ -146,6 +236,19 @@ class LeEcs : NoCopy, NoMove {
 
 	inline void system_set_method( LeEcsSystemId system_id, le_ecs_api::system_fn fn );
 
+	inline void system_set_batch_method( LeEcsSystemId system_id, le_ecs_api::system_batch_fn fn );
+
+	// Use these inside a batch system callback to get typed spans for parameters.
+	template <typename T>
+	static LeEcsSpan<T const> read_span( void const** read_params, size_t index, uint32_t count ) {
+		return { static_cast<T const*>( read_params[ index ] ), count };
+	}
+
+	template <typename T>
+	static LeEcsSpan<T> write_span( void** write_params, size_t index, uint32_t count ) {
+		return { static_cast<T*>( write_params[ index ] ), count };
+	}
+
 	template <typename T>
 	inline bool system_add_read_component( LeEcsSystemId system_id );
 
@@ -160,6 +263,50 @@ class LeEcs : NoCopy, NoMove {
 
 	inline void update_system( LeEcsSystemId system_id, void* user_data );
 
+	inline void update_systems( LeEcsSystemId const* system_ids, uint32_t num_systems, void* user_data );
+
+	// -- deferred structural changes
+
+	class Commands {
+		le_ecs_commands_o* self;
+
+	  public:
+		Commands( le_ecs_commands_o* self_ )
+		    : self( self_ ) {
+		}
+
+		EntityId create_entity() {
+			return le_ecs::le_ecs_i.commands_entity_create( self );
+		}
+
+		void remove_entity( EntityId entity ) {
+			le_ecs::le_ecs_i.commands_entity_remove( self, entity );
+		}
+
+		template <typename T>
+		void add_component( EntityId entity, T const& component );
+
+		template <typename T>
+		void remove_component( EntityId entity );
+
+		inline operator le_ecs_commands_o*() {
+			return self;
+		}
+	};
+
+	// Returns command buffer for the calling thread - safe to call from within systems.
+	Commands commands() {
+		return Commands( le_ecs::le_ecs_i.commands_get( self ) );
+	}
+
+	inline void flush_commands();
+
+	// -- snapshots
+
+	bool snapshot_write( int fd ) const {
+		return le_ecs::le_ecs_i.snapshot_write( self, fd );
+	}
+
 	class SystemBuilder {
 		LeEcs&        parent;
 		LeEcsSystemId id;
@@ -232,6 +379,31 @@ constexpr le_ecs_api::ComponentType const le_ecs_get_component_type() {
 }
 // ----------------------------------------------------------------------
 
+template <typename T>
+void LeEcs::Commands::add_component( EntityId entity, T const& component ) {
+	constexpr auto ct  = le_ecs_get_component_type<T>();
+	void*          mem = le_ecs::le_ecs_i.commands_entity_add_component( self, entity, ct );
+	if ( ct.num_bytes != 0 && nullptr != mem ) {
+		new ( mem )( T ){ component }; // placement new
+	}
+}
+
+// ----------------------------------------------------------------------
+
+template <typename T>
+void LeEcs::Commands::remove_component( EntityId entity ) {
+	constexpr auto ct = le_ecs_get_component_type<T>();
+	le_ecs::le_ecs_i.commands_entity_remove_component( self, entity, ct );
+}
+
+// ----------------------------------------------------------------------
+
+void LeEcs::flush_commands() {
+	le_ecs::le_ecs_i.flush_commands( self );
+}
+
+// ----------------------------------------------------------------------
+
 EntityId LeEcs::create_entity() {
 	return le_ecs::le_ecs_i.entity_create( self );
 }
@@ -260,12 +432,24 @@ void LeEcs::system_set_method( LeEcsSystemId system_id, le_ecs_api::system_fn fn
 
 // ----------------------------------------------------------------------
 
+void LeEcs::system_set_batch_method( LeEcsSystemId system_id, le_ecs_api::system_batch_fn fn ) {
+	le_ecs::le_ecs_i.system_set_batch_method( self, system_id, fn );
+}
+
+// ----------------------------------------------------------------------
+
 void LeEcs::update_system( LeEcsSystemId system_id, void* user_data ) {
 	le_ecs::le_ecs_i.execute_system( self, system_id, user_data );
 }
 
 // ----------------------------------------------------------------------
 
+void LeEcs::update_systems( LeEcsSystemId const* system_ids, uint32_t num_systems, void* user_data ) {
+	le_ecs::le_ecs_i.execute_systems( self, system_ids, num_systems, user_data );
+}
+
+// ----------------------------------------------------------------------
+
 template <typename R, typename S, typename... T>
 bool LeEcs::system_add_write_component( LeEcsSystemId system_id ) {
 	bool result = true;
@@ -2,28 +2,74 @@
 #include "le_core.h"
 
 #include <atomic>
-#include <mutex>
-#include <forward_list>
-#include <list>
 #include <cstdlib> // for malloc
+#include <cstring> // for memcpy
+#include <cstdio>  // for fopen
+#include <algorithm>
+#include <bit>
+#include <chrono>
 #include <thread>
+#include <vector>
 #include "assert.h"
 
+#if defined( __x86_64 ) || defined( _M_X64 )
+#	include <immintrin.h> // for _mm_pause
+#endif
+
+#ifdef _WIN32
+#	include <windows.h> // for VirtualAlloc
+#else
+#	include <sys/mman.h> // for mmap
+#	include <unistd.h>   // for sysconf
+#endif
+
 #include "private/lockfree_ring_buffer.h"
+#include "private/work_stealing_deque.h"
+#include "private/lockfree_slab_pool.h"
+#include "private/scratch_arena.h"
+#include "private/trace_ring_buffer.h"
 
 struct le_fiber_o;
 struct le_worker_thread_o;
+struct le_continuation_o;
 
 extern "C" void asm_call_fiber_exit( void );
 extern "C" int  asm_switch( le_fiber_o* to, le_fiber_o* from, int switch_to_guest );
 extern "C" void asm_fetch_default_control_words( uint64_t* );
 
-struct le_jobs_api::counter_t {
-	std::atomic<uint32_t> data{ 0 };
+// Counters are decremented from any worker thread: we give each counter
+// its own cache line so that counters don't falsely share.
+//
+// Fibers which wait for a counter to reach zero don't poll the counter:
+// they add themselves to the counter's list of waiters instead. Whoever
+// brings the counter to zero swaps the list for COUNTER_SIGNALLED, and
+// puts all waiting fibers back on their workers' ready queues.
+//
+// Besides fibers, continuations (see run_jobs_after) may wait on a
+// counter. We tell them apart by tagging pointers to continuations.
+struct alignas( 64 ) le_jobs_api::counter_t {
+	std::atomic<uint32_t>  data{ 0 };
+	std::atomic<uintptr_t> waiters{ 0 }; // intrusive list of fibers and continuations waiting for data to reach zero, or COUNTER_SIGNALLED once it has
 };
 
+constexpr static uintptr_t COUNTER_SIGNALLED       = 1; // sentinel for counter_t::waiters
+constexpr static uintptr_t WAITER_TAG_CONTINUATION = 2; // tag for waiters which are continuations, not fibers
+
 using counter_t = le_jobs_api::counter_t;
 using le_job_o  = le_jobs_api::le_job_o;
+using Priority  = le_jobs_api::Priority;
+
+// Job records of stackless jobs carry this instead of a complete_counter - counters are
+// 64 byte aligned, so this can't be the address of any actual counter.
+static counter_t* const STACKLESS_JOB = reinterpret_cast<counter_t*>( uintptr_t( 1 ) );
+
+struct parallel_context_t; // shared state for one call to parallel_for or parallel_reduce
+
+struct parallel_range_t {
+	uint32_t            begin;
+	uint32_t            end;
+	parallel_context_t* ctx;
+};
 
 /* NOTE - consider appropriate stack size.
  *
@@ -34,19 +80,53 @@ using le_job_o  = le_jobs_api::le_job_o;
  * trace using data-breakpoints. If heap memory is magically overwritten by another thread
  * - without you wanting it - this is a symptom of stack spill.
  *
- * We keep the stack size at 8 MB, which seems to be standard on linux. Don't worry about the
- * potentially large size, memory overcommitting makes sure that physical memory only gets
- * allocated if you really need it.
+ * We keep the default stack size at 8 MB, which seems to be standard on linux. Don't worry
+ * about the potentially large size: stacks are only reserved, and physical memory only gets
+ * committed once a page is touched.
+ *
+ * Below each stack sits a guard page without any access rights, so that a stack overflow
+ * faults immediately, instead of silently overwriting whatever happens to be next in memory.
  *
  */
 
-constexpr static size_t FIBER_POOL_SIZE         = 128;     // Number of available fibers, each with their own stack
-constexpr static size_t FIBER_STACK_SIZE        = 1 << 23; // 2^23 == 8 MB
-constexpr static size_t MAX_WORKER_THREAD_COUNT = 16;      // Maximum number of possible, but not necessarily requested worker threads.
-
-enum class FIBER_STATUS : uint64_t {
-	eIdle       = 0,
-	eProcessing = 1,
+constexpr static size_t FIBER_POOL_SIZE                  = 128;     // Default number of fibers created on initialize, each with their own stack
+constexpr static size_t FIBER_POOL_SIZE_MAX              = 1024;    // Default number of fibers up to which the fiber pool may grow
+constexpr static size_t FIBER_STACK_SIZE                 = 1 << 23; // Default stack size: 2^23 == 8 MB
+constexpr static size_t LOCAL_IDLE_FIBER_LIMIT           = 8;       // Workers keep at most this many idle fibers to themselves, any further idle fibers go to the shared pool
+constexpr static size_t MAX_WORKER_THREAD_COUNT          = 64;      // Maximum number of possible, but not necessarily requested worker threads.
+constexpr static size_t WORKER_DEQUE_SIZE_LOG2           = 10;      // Per-worker job deque holds 2^10 == 1024 jobs before spilling into the global job queue
+constexpr static size_t PRIORITY_COUNT                   = 3;       // Number of priority lanes: high, normal, background
+constexpr static size_t NORMAL_LANE_INTERVAL             = 8;       // Every n-th time a worker picks a job, it looks at the normal lane first, so that it can't starve
+constexpr static size_t BACKGROUND_LANE_INTERVAL         = 32;      // Every n-th time a worker picks a job, it looks at the background lane first, so that it can't starve
+constexpr static size_t JOB_POOL_SIZE                    = 1 << 14; // Number of job records which may be in flight before we fall back to allocating from the heap
+constexpr static size_t COUNTER_POOL_SIZE                = 1 << 12; // Number of counters which may be in flight before we fall back to allocating from the heap
+constexpr static size_t RANGE_POOL_SIZE                  = 1 << 12; // Number of parallel_for sub-ranges which may be in flight before we fall back to allocating from the heap
+constexpr static size_t CONTINUATION_POOL_SIZE           = 1 << 10; // Number of continuations which may be pending before we fall back to allocating from the heap
+constexpr static size_t CONTINUATION_INLINE_DEPENDENCIES = 8;       // Number of dependency counters a continuation holds before it has to allocate from the heap
+constexpr static size_t CONTINUATION_INLINE_JOBS         = 8;       // Number of jobs a continuation holds before it has to allocate from the heap
+constexpr static size_t WORKER_SPIN_LIMIT_MIN            = 16;      // Idle workers spin at least this many rounds looking for work before they park
+constexpr static size_t WORKER_SPIN_LIMIT_MAX            = 2048;    // Idle workers spin at most this many rounds looking for work before they park
+constexpr static size_t SCRATCH_BLOCK_SIZE               = 1 << 16; // Scratch memory is allocated in blocks of 64 KB - each fiber keeps one block once it has used scratch memory
+constexpr static size_t FIBER_LOCAL_SLOT_COUNT           = 16;      // Number of fiber-local storage slots
+constexpr static size_t COROUTINE_FRAME_SIZE_MIN         = 128;     // Coroutine frames come from pools for sizes 128, 256, ... bytes
+constexpr static size_t COROUTINE_FRAME_CLASS_COUNT      = 5;       // Number of coroutine frame pools: frames larger than 2 KB are allocated from the heap
+constexpr static size_t COROUTINE_FRAME_POOL_BYTES       = 1 << 18; // Each coroutine frame pool holds 256 KB worth of frames
+
+static_assert( MAX_WORKER_THREAD_COUNT <= 64, "parked workers are tracked in a 64 bit mask" );
+static_assert( size_t( Priority::eBackground ) + 1 == PRIORITY_COUNT, "each priority must have its own lane" );
+
+struct le_continuation_o {
+	uintptr_t   waiter_next      = 0;                 // intrusive list of waiters on current dependency
+	counter_t*  complete_counter = nullptr;           // counter for jobs - holds one extra count until jobs have been issued; nullptr for stackless jobs
+	Priority    priority         = Priority::eNormal; // priority for jobs
+	uint32_t    num_dependencies = 0;                 //
+	uint32_t    next_dependency  = 0;                 // index of dependency we must wait for next
+	uint32_t    num_jobs         = 0;                 //
+	counter_t** dependencies     = nullptr;           // owned by continuation, points to inline_dependencies, or to heap
+	le_job_o**  jobs             = nullptr;           // job records which we own until we issue them, points to inline_jobs, or to heap
+
+	counter_t* inline_dependencies[ CONTINUATION_INLINE_DEPENDENCIES ];
+	le_job_o*  inline_jobs[ CONTINUATION_INLINE_JOBS ];
 };
 
 /* A Fiber is an execution context, in which a job can execute.
@@ -62,26 +142,80 @@ enum class FIBER_STATUS : uint64_t {
  * that jobs resume on the same worker thread on which they did
  * yield.
  *
+ * Idle fibers are kept in a small per-worker pool, backed by a shared
+ * pool. Only if both are empty does a worker create a new fiber, up
+ * to the limit given in settings_t.
+ *
+ * Each fiber owns a scratch arena for its job's temporary allocations,
+ * and fiber-local storage slots for its job. Since a fiber runs one job
+ * at a time, and stays on one worker thread, neither needs any locking,
+ * and both survive yield, and waiting. We reset the arena once the job
+ * completes, and clear fiber-local slots once a new job is loaded.
+ *
  */
 struct le_fiber_o {
 	void**                    stack                = nullptr;             // pointer to address of current stack
 	void*                     job_param            = nullptr;             // parameter pointer for job
-	void*                     stack_bottom         = nullptr;             // allocation address so that it may be freed
-	counter_t*                fiber_await_counter  = nullptr;             // owned by le_job_manager, must be nullptr, or counter->data must be zero for fiber to start/resume
+	void*                     stack_bottom         = nullptr;             // lowest usable stack address, just above the guard page
+	counter_t*                fiber_await_counter  = nullptr;             // owned by le_job_manager, must be nullptr, or counter must be signalled for fiber to start/resume
 	counter_t*                job_complete_counter = nullptr;             // owned by le_job_manager
 	uint64_t                  job_complete         = 0;                   // flag whether job was completed.
-	std::atomic<FIBER_STATUS> fiber_status         = FIBER_STATUS::eIdle; // flag whether fiber is currently active
 	le_fiber_o*               list_prev            = nullptr;             // intrusive list
 	le_fiber_o*               list_next            = nullptr;             // intrusive list
+	uintptr_t                 waiter_next          = 0;                   // intrusive list of waiters on fiber_await_counter
+	le_fiber_o*               pool_next            = nullptr;             // intrusive list of all fibers which were created by the same worker
+	le_worker_thread_o*       worker               = nullptr;             // worker thread which executes this fiber's current job
+	Priority                  priority             = Priority::eNormal;   // priority of this fiber's current job
+	le_jobs_api::fun_ptr_t    job_fun_ptr          = nullptr;             // function of this fiber's current job, for tracing
+	scratch_arena_t*          scratch              = nullptr;             // temporary allocations for current job, created on first use, reset once job completes
+	void*                     fiber_local[ FIBER_LOCAL_SLOT_COUNT ]{};    // fiber-local storage for current job, cleared when a job is loaded
 	constexpr static size_t   NUM_REGISTERS        = 6;                   // must save RBX, RBP, and R12..R15
 };
 
 struct le_job_manager_o {
-	std::mutex                    counters_mtx;                // mutex protecting counters list
-	std::forward_list<counter_t*> counters;                    // storage for counters, list.
-	le_fiber_o*                   fibers[ FIBER_POOL_SIZE ]{}; // pool of available fibers
-	lockfree_ring_buffer_t*       job_queue;                   // queue onto which to push jobs
-	size_t                        worker_thread_count = 0;     // actual number of initialised worker threads
+	lockfree_ring_buffer_t* job_queues[ PRIORITY_COUNT ];  // per priority: queue for jobs submitted from outside the job system (or spilled from a full worker deque)
+	lockfree_slab_pool_t*   job_pool;                      // storage for job records which are in flight
+	lockfree_slab_pool_t*   counter_pool;                  // storage for counters
+	lockfree_slab_pool_t*   range_pool;                    // storage for parallel_for/parallel_reduce sub-ranges which are in flight
+	lockfree_slab_pool_t*   continuation_pool;             // storage for continuations which are pending
+	lockfree_slab_pool_t*   frame_pools[ COROUTINE_FRAME_CLASS_COUNT ]; // storage for coroutine frames, per size class
+	size_t                  worker_thread_count = 0;       // actual number of initialised worker threads
+	std::atomic<uint64_t>   job_heap_allocations{ 0 };     // number of job records which had to be allocated from the heap because the pool was exhausted
+	std::atomic<uint64_t>   counter_heap_allocations{ 0 }; // number of counters which had to be allocated from the heap because the pool was exhausted
+	std::atomic<uint64_t>   scratch_heap_allocations{ 0 }; // number of scratch blocks which had to be allocated from the heap
+	std::atomic<uint32_t>   job_queue_depth_max{ 0 };      // highest number of jobs in any of the global job queues
+	std::atomic<uint64_t>   frame_heap_allocations{ 0 };   // number of coroutine frames which had to be allocated from the heap
+	std::atomic<uint64_t>   range_heap_allocations{ 0 };   // number of sub-range records which had to be allocated from the heap because the pool was exhausted
+	std::atomic<uint64_t>   continuation_heap_allocations{ 0 }; // number of continuations which had to be allocated from the heap, plus dependency and job arrays too large to be stored inline
+	std::atomic<uint64_t>   parked_workers{ 0 };           // bitmask: bit i is set if worker i is parked (or about to park)
+	lockfree_ring_buffer_t* idle_fibers;                   // shared pool of idle fibers, for when a worker's own pool is full, or runs dry
+	std::atomic<uint32_t>   fiber_count{ 0 };              // number of fibers over all workers
+	uint32_t                fiber_count_max  = 0;          // fiber pools may not grow beyond this number of fibers
+	size_t                  fiber_stack_size = 0;          // usable stack size per fiber, multiple of page_size
+	size_t                  page_size        = 0;          // size of one memory page, which is also the size of a guard page
+	le_worker_thread_o*     helper           = nullptr;    // worker for a thread from outside the job system which helps out while it waits
+	std::atomic<uint32_t>   helper_claimed{ 0 };           // flag, `1` while a thread from outside the job system uses helper
+	uint32_t                trace_capacity_log2 = 0;       // log2 of number of events per worker trace ring buffer, only valid if tracing
+	bool                    is_tracing          = false;   // whether workers record job events into their trace ring buffers
+	uint64_t                start_ns            = 0;       // timestamp at initialize - trace timestamps are relative to this
+};
+
+/* Scheduler counters for one worker, see worker_stats_t.
+ *
+ * Only the worker itself writes to its counters - which is why these
+ * don't need any read-modify-write atomics - but any thread may read
+ * them at any time.
+ */
+struct le_worker_stats_o {
+	std::atomic<uint64_t> jobs_executed{ 0 };
+	std::atomic<uint64_t> busy_ns{ 0 };
+	std::atomic<uint64_t> idle_ns{ 0 };
+	std::atomic<uint64_t> idle_since{ 0 }; // timestamp at which this worker ran out of work, 0 while it has work
+	std::atomic<uint64_t> steals{ 0 };
+	std::atomic<uint64_t> yields{ 0 };
+	std::atomic<uint64_t> waits{ 0 };
+	std::atomic<uint64_t> fiber_pool_exhausted{ 0 };
+	std::atomic<uint32_t> queue_depth_max{ 0 };
 };
 
 struct le_fiber_list_t {
@@ -95,9 +229,42 @@ struct le_fiber_list_t {
  * Worker threads are pinned to CPUs.
  *
  * Worker threads pull in fibers so that that they can execute jobs.
- * If a fiber yields within a worker thread,
- * it is put on the worker thread's wait_list. If a fiber is ready to
- * resume, it is taken from the wait_list and put on the ready_list.
+ *
+ * Each worker thread owns a job deque per priority: jobs which are
+ * issued from within a worker thread are pushed onto the deque for
+ * their priority, and popped from it again in LIFO order. Once a
+ * worker's deque runs dry, the worker checks the global job queue for
+ * the same priority, and then attempts to steal jobs from other
+ * workers' deques for the same priority.
+ *
+ * Workers look for jobs in higher priority lanes first. So that jobs
+ * in lower priority lanes can't starve, every NORMAL_LANE_INTERVAL-th
+ * and BACKGROUND_LANE_INTERVAL-th pick starts with the normal and the
+ * background lane, respectively.
+ *
+ * If a fiber yields within a worker thread, it is put on the worker
+ * thread's yielded_list. Workers take turns between resuming yielded
+ * fibers and picking up new jobs, so that a fiber which yields while
+ * it polls for some condition lets other jobs make progress, even
+ * with a single worker. If a fiber waits for a counter,
+ * it is handed over to the counter, and whoever brings the counter to
+ * zero pushes the fiber onto its worker's ready_inbox, from where the
+ * worker moves it to the ready_list. This way, dispatching does not
+ * depend on how many fibers are waiting.
+ *
+ * A thread from outside the job system (typically, the main thread)
+ * which waits for a counter becomes a temporary worker while it waits,
+ * using `job_manager->helper`. This worker has no thread of its own,
+ * and it never parks. Its id is the number of worker threads.
+ *
+ * If a worker can't find any work, it spins for a while, and then
+ * parks, i.e. it sleeps on its `wake_signal` until it gets woken up
+ * by run_jobs. The number of rounds a worker spins adapts: it grows
+ * if spinning was successful, and shrinks if the worker had to park.
+ *
+ * Each worker keeps scheduler counters, which only it writes to, and -
+ * if tracing - a ring buffer of its most recent job events. Both may
+ * be read from any thread, at any time.
  *
  */
 struct le_worker_thread_o {
@@ -105,16 +272,214 @@ struct le_worker_thread_o {
 	le_fiber_o*     guest_fiber = nullptr; // current fiber executing inside this worker thread
 	std::thread     thread      = {};      //
 	std::thread::id thread_id   = {};      //
-	le_fiber_list_t wait_list   = {};      // list of fibers which need checking their condition
-	le_fiber_list_t ready_list  = {};      // list of fibers ready to resume after yield
-	uint64_t        stop_thread = 0;       // flag, value `1` tells worker to join
+	le_fiber_list_t ready_list   = {};      // list of fibers ready to resume after waiting for a counter
+	le_fiber_list_t yielded_list = {};      // list of fibers which yielded - these take turns with new jobs
+	le_fiber_list_t idle_fibers  = {};      // pool of fibers which are available to run a job, at most LOCAL_IDLE_FIBER_LIMIT
+	le_fiber_o*     fibers       = nullptr; // all fibers created by this worker, linked via pool_next
+	std::atomic<le_fiber_o*> ready_inbox{ nullptr }; // fibers made ready by other threads, linked via list_next; owner takes all at once
+	std::atomic<uint32_t>    stop_thread{ 0 };       // flag, value `1` tells worker to join
+	bool                     resumed_yielded = false; // whether last dispatch resumed a yielded fiber - if so, next dispatch looks for a new job first
+	std::atomic<uint32_t>    wake_signal{ 0 };       // parked worker waits on this to become `1`
+
+	work_stealing_deque_t* job_deques[ PRIORITY_COUNT ]{};       // per priority: jobs issued from this worker; owner pushes/pops, other workers steal
+	uint32_t               worker_index = 0;                     // index of this worker in static_worker_threads
+	uint32_t               pick_count   = 0;                     // number of jobs this worker has picked, for anti-starvation
+	uint32_t               idle_count   = 0;                     // number of fibers in idle_fibers
+	uint32_t               busy_count   = 0;                     // number of fibers which have started, but not yet completed a job on this worker
+	uint32_t               steal_seed   = 0;                     // state for picking steal victims
+	uint32_t               spin_limit   = WORKER_SPIN_LIMIT_MIN; // adaptive: number of idle rounds before we park
+
+	le_worker_stats_o    stats;                             // scheduler counters, see get_worker_stats
+	trace_ring_buffer_t* trace                   = nullptr; // most recent job events, nullptr unless tracing
+	bool                 is_fiber_pool_exhausted = false;   // whether the last attempt to acquire a fiber failed
 };
 
-static le_worker_thread_o* static_worker_threads[ MAX_WORKER_THREAD_COUNT ]{};
+static le_worker_thread_o* static_worker_threads[ MAX_WORKER_THREAD_COUNT + 2 ]{}; // nullptr-terminated, one extra slot for helper on terminate
 static le_job_manager_o*   job_manager = nullptr; ///< job manager singleton, must be initialised via initialise(), and terminated via terminate().
 
+static thread_local bool        tls_is_helping    = false;   // true if current thread is from outside the job system, and currently acts as job_manager->helper
+static thread_local le_fiber_o* tls_current_fiber = nullptr; // fiber which currently executes a job on this thread, nullptr outside of jobs
+static thread_local bool        tls_is_stackless  = false;   // true while current thread executes a stackless job
+
+// Threads from outside the job system get their own scratch arena, and
+// fiber-local storage, which they use whenever they're not running a job.
+struct le_thread_scratch_o {
+	scratch_arena_t* arena = nullptr; // created on first use
+	void*            fiber_local[ FIBER_LOCAL_SLOT_COUNT ]{};
+
+	~le_thread_scratch_o() {
+		scratch_arena_destroy( arena );
+	}
+};
+
+static thread_local le_thread_scratch_o tls_thread_scratch;
+static std::atomic<uint32_t>            fiber_local_slot_count{ 0 }; // number of fiber-local storage slots handed out via create_fiber_local_slot
+
 static uint64_t DEFAULT_CONTROL_WORDS = 0; // storage for default control words (must be 8 byte, == 2 words)
 
+// ----------------------------------------------------------------------
+// Monotonic timestamp in nanoseconds, for scheduler counters, and tracing.
+static inline uint64_t le_jobs_now_ns() {
+	return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+// ----------------------------------------------------------------------
+// Add to a scheduler counter - must only be called by the worker which owns the counter.
+static inline void le_worker_stat_add( std::atomic<uint64_t>& stat, uint64_t value ) {
+	stat.store( stat.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+}
+
+// ----------------------------------------------------------------------
+// Job records and counters come from fixed-size pools, so that issuing
+// and completing jobs does not need to touch the global allocator.
+// Should a pool be exhausted, we fall back to the heap, and keep count.
+static le_job_o* le_job_record_alloc( le_jobs_api::fun_ptr_t fun_ptr, void* fun_param, counter_t* counter ) {
+	void* mem = lockfree_slab_pool_trypop( job_manager->job_pool );
+	if ( nullptr == mem ) {
+		++job_manager->job_heap_allocations;
+		return new le_job_o{ fun_ptr, fun_param, counter };
+	}
+	return new ( mem ) le_job_o{ fun_ptr, fun_param, counter };
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_record_free( le_job_o* job ) {
+	if ( lockfree_slab_pool_owns( job_manager->job_pool, job ) ) {
+		lockfree_slab_pool_push( job_manager->job_pool, job ); // le_job_o is trivially destructible
+	} else {
+		delete job;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static counter_t* le_counter_alloc( uint32_t value ) {
+	void*      mem     = lockfree_slab_pool_trypop( job_manager->counter_pool );
+	counter_t* counter = nullptr;
+	if ( nullptr == mem ) {
+		++job_manager->counter_heap_allocations;
+		counter = new counter_t();
+	} else {
+		counter = new ( mem ) counter_t();
+	}
+	counter->data = value;
+	if ( 0 == value ) {
+		// Nobody is ever going to decrement this counter to zero.
+		counter->waiters.store( COUNTER_SIGNALLED, std::memory_order_relaxed );
+	}
+	return counter;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_counter_free( counter_t* counter ) {
+	if ( lockfree_slab_pool_owns( job_manager->counter_pool, counter ) ) {
+		counter->~counter_t();
+		lockfree_slab_pool_push( job_manager->counter_pool, counter );
+	} else {
+		delete counter;
+	}
+}
+
+// ----------------------------------------------------------------------
+// Signal worker `w`, whose bit in `parked_workers` we have claimed.
+static void le_worker_thread_signal( le_worker_thread_o* w ) {
+	w->wake_signal.store( 1, std::memory_order_release );
+	w->wake_signal.notify_one();
+}
+
+// ----------------------------------------------------------------------
+// Wake up worker `w` if it is parked. Must be called after the work
+// for `w` has been published. See le_worker_thread_park.
+static void le_worker_thread_wake( le_worker_thread_o* w ) {
+
+	if ( w == job_manager->helper ) {
+		return; // helper never parks
+	}
+
+	uint64_t const worker_bit = uint64_t( 1 ) << w->worker_index;
+
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+
+	if ( ( job_manager->parked_workers.load( std::memory_order_relaxed ) & worker_bit ) &&
+	     ( job_manager->parked_workers.fetch_and( ~worker_bit, std::memory_order_seq_cst ) & worker_bit ) ) {
+		le_worker_thread_signal( w );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Hand a fiber which has become ready back to the worker which owns it.
+// May be called from any thread.
+static void le_fiber_make_ready( le_fiber_o* fiber ) {
+
+	le_worker_thread_o* w    = fiber->worker;
+	le_fiber_o*         head = w->ready_inbox.load( std::memory_order_relaxed );
+
+	do {
+		fiber->list_next = head;
+	} while ( !w->ready_inbox.compare_exchange_weak( head, fiber, std::memory_order_release, std::memory_order_relaxed ) );
+
+	le_worker_thread_wake( w );
+}
+
+// ----------------------------------------------------------------------
+
+static inline bool le_counter_is_signalled( counter_t const* counter ) {
+	return COUNTER_SIGNALLED == counter->waiters.load( std::memory_order_acquire );
+}
+
+// ----------------------------------------------------------------------
+
+static uintptr_t le_continuation_waiter_next( le_continuation_o const* continuation ); // ffdecl
+static void      le_continuation_advance( le_continuation_o* continuation );          // ffdecl
+
+// ----------------------------------------------------------------------
+// If the counter reaches zero, all fibers waiting on it are made ready,
+// and all continuations waiting on it move on to their next dependency.
+static void le_counter_decrement( counter_t* counter ) {
+
+	if ( 1 != counter->data.fetch_sub( 1, std::memory_order_acq_rel ) ) {
+		return;
+	}
+
+	uintptr_t waiter = counter->waiters.exchange( COUNTER_SIGNALLED, std::memory_order_acq_rel );
+
+	// --------| invariant: we must not touch counter anymore, as a waiting
+	// fiber may free it as soon as it sees that the counter was signalled.
+
+	while ( waiter ) {
+		// We must read next before we hand over the waiter.
+		if ( waiter & WAITER_TAG_CONTINUATION ) {
+			le_continuation_o* continuation = reinterpret_cast<le_continuation_o*>( waiter & ~WAITER_TAG_CONTINUATION );
+			waiter                          = le_continuation_waiter_next( continuation );
+			le_continuation_advance( continuation );
+		} else {
+			le_fiber_o* fiber = reinterpret_cast<le_fiber_o*>( waiter );
+			waiter            = fiber->waiter_next;
+			le_fiber_make_ready( fiber );
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Add a waiter to the counter's waiters. `waiter_next` is the waiter's link.
+// Returns false if the counter has already been signalled, in which case
+// the waiter has not been added, and may go ahead right away.
+static bool le_counter_add_waiter( counter_t* counter, uintptr_t waiter, uintptr_t* waiter_next ) {
+
+	uintptr_t head = counter->waiters.load( std::memory_order_acquire );
+
+	do {
+		if ( COUNTER_SIGNALLED == head ) {
+			return false;
+		}
+		*waiter_next = head;
+	} while ( !counter->waiters.compare_exchange_weak( head, waiter, std::memory_order_release, std::memory_order_acquire ) );
+
+	return true;
+}
+
 // ----------------------------------------------------------------------
 void fiber_list_push_back( le_fiber_list_t* list, le_fiber_o* element ) {
 
@@ -174,18 +539,47 @@ void fiber_list_remove_element( le_fiber_list_t* list, le_fiber_o* element ) {
 }
 
 // ----------------------------------------------------------------------
-// Creates a fiber object, and allocates memory for this fiber
-static le_fiber_o* le_fiber_create() {
-
-	le_fiber_o* fiber = new le_fiber_o();
-
-	/* Create a 16-byte aligned stack */
-	static_assert( FIBER_STACK_SIZE % 16 == 0, "stack size must be 16 byte-aligned." );
-
-	fiber->stack_bottom = malloc( FIBER_STACK_SIZE );
-
-	if ( fiber->stack_bottom == nullptr )
+// Creates a fiber object, and reserves memory for this fiber's stack.
+// Returns nullptr if memory could not be reserved, or guarded.
+static le_fiber_o* le_fiber_create( le_worker_thread_o* owner ) {
+
+	size_t const guard_size = job_manager->page_size;
+	size_t const total_size = guard_size + job_manager->fiber_stack_size;
+
+	// Stacks grow downwards: the guard page goes at the lowest address.
+	// Stacks are page-aligned, which means they are also 16-byte aligned.
+
+#ifdef _WIN32
+	// Windows does not overcommit: committed memory counts against the commit
+	// limit whether it gets touched or not - and committing pages on demand would
+	// need an exception handler, since the OS only grows a thread's own stack.
+	// We therefore commit the stack in full, but leave the guard page reserved
+	// only, so that touching it faults without it taking up any commit charge.
+	char* allocation = static_cast<char*>( VirtualAlloc( nullptr, total_size, MEM_RESERVE, PAGE_NOACCESS ) );
+	if ( nullptr == allocation ) {
+		return nullptr;
+	}
+	if ( nullptr == VirtualAlloc( allocation + guard_size, job_manager->fiber_stack_size, MEM_COMMIT, PAGE_READWRITE ) ) {
+		VirtualFree( allocation, 0, MEM_RELEASE );
 		return nullptr;
+	}
+#else
+	void* mapping = mmap( nullptr, total_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+	if ( MAP_FAILED == mapping ) {
+		return nullptr;
+	}
+	char* allocation = static_cast<char*>( mapping );
+	if ( 0 != mprotect( allocation, guard_size, PROT_NONE ) ) {
+		// Without a guard page, a stack overflow would silently corrupt whatever
+		// memory lies below this stack - rather not create this fiber at all.
+		munmap( mapping, total_size );
+		return nullptr;
+	}
+#endif
+
+	le_fiber_o* fiber   = new le_fiber_o();
+	fiber->stack_bottom = allocation + guard_size;
+	fiber->worker       = owner;
 
 	return fiber;
 }
@@ -193,7 +587,13 @@ static le_fiber_o* le_fiber_create() {
 // ----------------------------------------------------------------------
 
 static void le_fiber_destroy( le_fiber_o* fiber ) {
-	free( fiber->stack_bottom );
+	scratch_arena_destroy( fiber->scratch );
+	char* allocation = static_cast<char*>( fiber->stack_bottom ) - job_manager->page_size;
+#ifdef _WIN32
+	VirtualFree( allocation, 0, MEM_RELEASE );
+#else
+	munmap( allocation, job_manager->page_size + job_manager->fiber_stack_size );
+#endif
 	delete ( fiber );
 }
 
@@ -201,7 +601,7 @@ static void le_fiber_destroy( le_fiber_o* fiber ) {
 // Associate a fiber with a job
 static void le_fiber_load_job( le_fiber_o* fiber, le_fiber_o* host_fiber, le_job_o* job ) {
 
-	fiber->stack = reinterpret_cast<void**>( static_cast<char*>( fiber->stack_bottom ) + FIBER_STACK_SIZE );
+	fiber->stack = reinterpret_cast<void**>( static_cast<char*>( fiber->stack_bottom ) + job_manager->fiber_stack_size );
 	//
 	// We push host_fiber and guest_fiber (==fiber) onto the stack so
 	// that fiber_exit method can retrieve this information via popping
@@ -226,9 +626,14 @@ static void le_fiber_load_job( le_fiber_o* fiber, le_fiber_o* host_fiber, le_job
 	*( --fiber->stack ) = reinterpret_cast<void*>( DEFAULT_CONTROL_WORDS );
 
 	fiber->job_param            = job->fun_param;
+	fiber->job_fun_ptr          = job->fun_ptr;
 	fiber->job_complete         = 0;
 	fiber->job_complete_counter = job->complete_counter;
 	fiber->fiber_await_counter  = nullptr;
+
+	for ( auto& value : fiber->fiber_local ) {
+		value = nullptr;
+	}
 }
 
 // ----------------------------------------------------------------------
@@ -244,15 +649,26 @@ static inline int32_t get_current_worker_thread_id() {
 		}
 	}
 
+	if ( tls_is_helping ) {
+		return i; // helper comes after all worker threads
+	}
+
 	return result;
 }
 
+// ----------------------------------------------------------------------
+// return worker with given index - the helper's index is the number of
+// worker threads.
+static inline le_worker_thread_o* le_job_manager_get_worker( size_t index ) {
+	return ( index == job_manager->worker_thread_count ) ? job_manager->helper : static_worker_threads[ index ];
+}
+
 // ----------------------------------------------------------------------
 // return pointer to current worker thread providing context,
 // or nullptr if no current worker thread could be found.
 static le_worker_thread_o* get_current_thread() {
 	int32_t worker_thread_id = get_current_worker_thread_id();
-	return ( worker_thread_id == -1 ) ? nullptr : static_worker_threads[ worker_thread_id ];
+	return ( worker_thread_id == -1 ) ? nullptr : le_job_manager_get_worker( size_t( worker_thread_id ) );
 }
 
 // ----------------------------------------------------------------------
@@ -269,6 +685,7 @@ static void le_fiber_yield() {
 	le_worker_thread_o* yielding_thread = get_current_thread();
 
 	assert( yielding_thread ); // must be one of our worker threads. Can't yield from the main thread.
+	assert( !tls_is_stackless && "stackless jobs must not yield" );
 
 	if ( yielding_thread ) {
 		// Call switch method using the fiber information from the yielding thread.
@@ -289,8 +706,14 @@ static void le_fiber_yield() {
 
 extern "C" void ATTR_NO_RETURN fiber_exit( le_fiber_o* host_fiber, le_fiber_o* guest_fiber ) {
 
+	// Count the job before we signal its counter: whoever waits for the counter
+	// may read worker stats right away, and must find the job counted.
+	if ( le_worker_thread_o* worker = get_current_thread() ) {
+		le_worker_stat_add( worker->stats.jobs_executed, 1 );
+	}
+
 	if ( guest_fiber->job_complete_counter ) {
-		--guest_fiber->job_complete_counter->data;
+		le_counter_decrement( guest_fiber->job_complete_counter );
 	}
 
 	guest_fiber->job_complete = 1;
@@ -303,273 +726,823 @@ extern "C" void ATTR_NO_RETURN fiber_exit( le_fiber_o* host_fiber, le_fiber_o* g
 }
 
 // ----------------------------------------------------------------------
+// Attempt to steal a job from any other worker's deque - including the
+// helper's. We start at a pseudo-random victim so that thieves spread
+// out over all workers instead of all hammering on the same deque.
+static le_job_o* le_worker_thread_steal_job( le_worker_thread_o* self, size_t lane ) {
 
-static void le_worker_thread_dispatch( le_worker_thread_o* self ) {
+	uint32_t const worker_count = uint32_t( job_manager->worker_thread_count ) + 1; // +1 for helper
 
-	// -- Check all fibers on the wait list, and add them to the ready list
-	// should their condition have become true.
-	//
-	for ( auto it_f = self->wait_list.begin; it_f != nullptr; ) {
+	// xorshift32
+	self->steal_seed ^= self->steal_seed << 13;
+	self->steal_seed ^= self->steal_seed >> 17;
+	self->steal_seed ^= self->steal_seed << 5;
 
-		le_fiber_o* f = it_f;            // We must capture f here,
-		it_f          = it_f->list_next; // and increase iterator, since it_f may be invalidated because of remove op
+	uint32_t const first_victim = self->steal_seed % worker_count;
 
-		if ( nullptr == f->fiber_await_counter || 0 == f->fiber_await_counter->data ) {
-			fiber_list_remove_element( &self->wait_list, f ); // Must first remove, since list op is intrusive and will update the fiber
-			fiber_list_push_back( &self->ready_list, f );     // This will also update the fiber
+	for ( uint32_t i = 0; i != worker_count; ++i ) {
+		le_worker_thread_o* victim = le_job_manager_get_worker( ( first_victim + i ) % worker_count );
+		if ( victim == self || nullptr == victim ) {
+			continue;
+		}
+		void* job = work_stealing_deque_trysteal( victim->job_deques[ lane ] );
+		if ( job ) {
+			le_worker_stat_add( self->stats.steals, 1 );
+			return static_cast<le_job_o*>( job );
 		}
 	}
 
-	// -- If there is any fiber in the ready-list, we must switch to that fiber.
-	//
-	if ( self->ready_list.begin ) {
-		self->guest_fiber = self->ready_list.begin;
-		fiber_list_remove_element( &self->ready_list, self->ready_list.begin );
-	}
+	return nullptr;
+}
 
-	if ( nullptr == self->guest_fiber ) {
+// ----------------------------------------------------------------------
+// Find the next job to execute in a given priority lane: first look at
+// our own deque, then at the global queue, and only then try to steal
+// from other workers.
+static le_job_o* le_worker_thread_find_job_in_lane( le_worker_thread_o* self, size_t lane ) {
 
-		// find first available idle fiber
-		size_t i = 0;
-		for ( i = 0; i != FIBER_POOL_SIZE; ++i ) {
-			auto fib_idle = FIBER_STATUS::eIdle; // < value to compare against
+	void* job = work_stealing_deque_trypop( self->job_deques[ lane ] );
 
-			if ( job_manager->fibers[ i ]->fiber_status.compare_exchange_weak( fib_idle, FIBER_STATUS::eProcessing ) ) {
-				// ----------| invariant: `fiber_active` was 0, is now atomically changed to 1
-				self->guest_fiber = job_manager->fibers[ i ];
-				break;
-			}
-		}
+	if ( nullptr == job ) {
+		job = lockfree_ring_buffer_trypop( job_manager->job_queues[ lane ] );
+	}
 
-		if ( i == FIBER_POOL_SIZE ) {
-			// we could not find an available fiber, we must return empty-handed.
-			return;
-		}
+	if ( nullptr == job ) {
+		job = le_worker_thread_steal_job( self, lane );
+	}
 
-		// Pop the job which has been waiting the longest off the job queue
+	return static_cast<le_job_o*>( job );
+}
 
-		le_job_o* job = static_cast<le_job_o*>( lockfree_ring_buffer_trypop( job_manager->job_queue ) );
+// ----------------------------------------------------------------------
+// Find the next job to execute, looking at higher priority lanes first -
+// but every so often we start with a lower priority lane, so that jobs
+// in lower priority lanes make progress even if higher priority lanes
+// never run dry. Stores the priority of the job found in `priority`.
+static le_job_o* le_worker_thread_find_job( le_worker_thread_o* self, Priority* priority ) {
 
-		if ( nullptr == job ) {
-			// We couldn't get another job from the queue - this could mean that the queue is empty.
-			// anyway, let's wait a little bit before returning...
+	size_t first_lane = size_t( Priority::eHigh );
 
-			self->guest_fiber->fiber_status = FIBER_STATUS::eIdle; // return fiber to pool
-			self->guest_fiber               = nullptr;
+	++self->pick_count;
 
-			std::this_thread::sleep_for( std::chrono::nanoseconds( 100 ) );
-			return;
-		} else {
+	if ( 0 == self->pick_count % BACKGROUND_LANE_INTERVAL ) {
+		first_lane = size_t( Priority::eBackground );
+	} else if ( 0 == self->pick_count % NORMAL_LANE_INTERVAL ) {
+		first_lane = size_t( Priority::eNormal );
+	}
 
-			le_fiber_load_job( self->guest_fiber, &self->host_fiber, job );
+	if ( le_job_o* job = le_worker_thread_find_job_in_lane( self, first_lane ) ) {
+		*priority = Priority( first_lane );
+		return job;
+	}
 
-			// we don't need job anymore after it was passed to fiber_setup
-			// and since the ring buffer did own the job, we must delete it
-			// here.
-			delete ( job );
+	for ( size_t lane = 0; lane != PRIORITY_COUNT; ++lane ) {
+		if ( lane == first_lane ) {
+			continue; // we already looked at this lane
+		}
+		if ( le_job_o* job = le_worker_thread_find_job_in_lane( self, lane ) ) {
+			*priority = Priority( lane );
+			return job;
 		}
 	}
 
-	// --------| invariant: current_fiber contains a fiber
+	return nullptr;
+}
 
-	// We are only allowed to switch to a fiber if its await counter is zero,
-	// or unset. Otherwise this means that child jobs of a fiber are still
-	// executing.
+// ----------------------------------------------------------------------
 
-	if ( self->guest_fiber->fiber_await_counter && self->guest_fiber->fiber_await_counter->data != 0 ) {
-		// This fiber is not ready yet, as its dependent jobs are still executing.
-		// we must not process it further, instead place this fiber on the wait list.
-		assert( false );
-		return;
-	}
+static inline void cpu_relax() {
+#if defined( __x86_64 ) || defined( _M_X64 )
+	_mm_pause();
+#endif
+}
 
-	assert( self->guest_fiber->stack ); // address of stack must not be 0
+// ----------------------------------------------------------------------
+// Returns true if there is any job which this worker could pick up.
+// This is only an estimate, but it errs on the side of caution, which
+// is what we want when deciding whether to park.
+static bool le_worker_thread_has_work( le_worker_thread_o const* self ) {
 
-	// switch to guest fiber
-	asm_switch( self->guest_fiber, &self->host_fiber, 1 );
+	if ( self->ready_list.begin || self->yielded_list.begin || self->ready_inbox.load( std::memory_order_relaxed ) ) {
+		return true;
+	}
 
-	// If we're back here, this means that the fiber in current_fiber has
-	// finished executing for now. This can have two reasons:
-	//
-	// 1. Fiber did complete
-	// 2. Fiber did yield
+	for ( size_t lane = 0; lane != PRIORITY_COUNT; ++lane ) {
 
-	if ( 1 == self->guest_fiber->job_complete ) {
-		// Fiber was completed: We must return it to the pool
-		self->guest_fiber->stack        = nullptr;             // Reset fiber stack
-		self->guest_fiber->fiber_status = FIBER_STATUS::eIdle; // return fiber to pool !! do this as the last thing, otherwise other threads will already have taken ownership of it !!
-		self->guest_fiber               = nullptr;             // reset current fiber
-	} else {
-		// Fiber has yielded: We must add it to the wait_list.
-		fiber_list_push_back( &self->wait_list, self->guest_fiber );
-		self->guest_fiber = nullptr;
+		if ( lockfree_ring_buffer_size( job_manager->job_queues[ lane ] ) > 0 ) {
+			return true;
+		}
+
+		for ( size_t i = 0; i <= job_manager->worker_thread_count; ++i ) { // includes helper
+			if ( work_stealing_deque_size( le_job_manager_get_worker( i )->job_deques[ lane ] ) > 0 ) {
+				return true;
+			}
+		}
 	}
+
+	return false;
 }
 
 // ----------------------------------------------------------------------
-// Main loop for each worker thread
+// Put the current worker to sleep until it gets woken up via wake_signal.
 //
-static void le_worker_thread_loop( le_worker_thread_o* self ) {
-
-	self->thread_id = std::this_thread::get_id();
+// We first announce that we are about to park by setting our bit in
+// `parked_workers`, and only then check for work one last time - while
+// anyone who adds work first publishes the work, and then checks
+// `parked_workers`. This way, either we see their work, or they see our
+// bit, and no wake-up can get lost in-between.
+static void le_worker_thread_park( le_worker_thread_o* self ) {
+
+	uint64_t const worker_bit = uint64_t( 1 ) << self->worker_index;
+
+	self->wake_signal.store( 0, std::memory_order_relaxed );
+	job_manager->parked_workers.fetch_or( worker_bit, std::memory_order_seq_cst );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+
+	if ( self->stop_thread.load( std::memory_order_relaxed ) || le_worker_thread_has_work( self ) ) {
+		if ( job_manager->parked_workers.fetch_and( ~worker_bit, std::memory_order_seq_cst ) & worker_bit ) {
+			return; // we un-parked ourselves.
+		}
+		// Someone else has already claimed our bit, which means that they
+		// are about to signal us - we must wait for the signal, which won't take long.
+	}
 
-	while ( 0 == self->stop_thread ) {
-		le_worker_thread_dispatch( self );
+	while ( 0 == self->wake_signal.load( std::memory_order_acquire ) ) {
+		self->wake_signal.wait( 0, std::memory_order_acquire );
 	}
 }
 
 // ----------------------------------------------------------------------
+// Wake up to `count` parked workers, so that they may pick up new work.
+// Must be called after the work has been published.
+static void le_job_manager_wake_workers( uint32_t count ) {
 
-static void le_job_manager_initialize( size_t num_threads ) {
-
-	assert( num_threads <= MAX_WORKER_THREAD_COUNT );
-	assert( num_threads > 0 && "num_threads must be > than 0" );
-
-	assert( nullptr == job_manager );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
 
-	asm_fetch_default_control_words( &DEFAULT_CONTROL_WORDS );
+	uint64_t parked = job_manager->parked_workers.load( std::memory_order_relaxed );
 
-	job_manager = new le_job_manager_o();
+	while ( count != 0 && parked != 0 ) {
+		uint64_t worker_bit = parked & ( ~parked + 1 ); // lowest set bit
 
-	job_manager->job_queue = lockfree_ring_buffer_create( 10 ); // note size is given as a power of 2, so "10" means 1024 elements
+		if ( job_manager->parked_workers.compare_exchange_weak( parked, parked & ~worker_bit, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {
+			// ----------| invariant: we have claimed the parked worker: we must wake it.
+			uint32_t worker_index = uint32_t( std::countr_zero( worker_bit ) );
+			le_worker_thread_signal( static_worker_threads[ worker_index ] );
+			parked &= ~worker_bit;
+			--count;
+		}
+		// If compare-exchange failed, `parked` has been updated with the current value and we try again.
+	}
+}
 
-	// Allocate a number of fibers to execute jobs in.
-	for ( size_t i = 0; i != FIBER_POOL_SIZE; ++i ) {
-		job_manager->fibers[ i ] = le_fiber_create();
+// ----------------------------------------------------------------------
+// Take an idle fiber from this worker's fiber pool, or from the shared
+// pool. If both are empty, create a new fiber - unless that would exceed
+// the maximum number of fibers, in which case we return nullptr.
+static le_fiber_o* le_worker_thread_acquire_fiber( le_worker_thread_o* self ) {
+
+	if ( self->idle_fibers.end ) {
+		// Most recently used fibers come first: their stacks are still warm.
+		le_fiber_o* fiber = self->idle_fibers.end;
+		fiber_list_remove_element( &self->idle_fibers, fiber );
+		--self->idle_count;
+		return fiber;
 	}
 
-	// Create a number of worker threads to host fibers in
-	for ( size_t i = 0; i != num_threads; ++i ) {
+	if ( le_fiber_o* fiber = static_cast<le_fiber_o*>( lockfree_ring_buffer_trypop( job_manager->idle_fibers ) ) ) {
+		fiber->worker = self;
+		return fiber;
+	}
 
-		le_worker_thread_o* w = new le_worker_thread_o();
+	uint32_t count = job_manager->fiber_count.load( std::memory_order_relaxed );
 
-		w->thread = std::thread( le_worker_thread_loop, w );
+	do {
+		if ( count >= job_manager->fiber_count_max ) {
+			return nullptr;
+		}
+	} while ( !job_manager->fiber_count.compare_exchange_weak( count, count + 1, std::memory_order_relaxed ) );
 
-		auto pthread = w->thread.native_handle();
-#ifdef _MSC_VER
+	le_fiber_o* fiber = le_fiber_create( self );
 
-#else
-		cpu_set_t mask;
-		CPU_ZERO( &mask );
-		CPU_SET( i + 1, &mask );
-		pthread_setaffinity_np( pthread, sizeof( mask ), &mask );
-#endif //                                         \
-    // Thread in static ledger of threads so that \
-    // we may retrieve thread-ids later.
-		static_worker_threads[ i ] = w;
+	if ( nullptr == fiber ) {
+		--job_manager->fiber_count;
+		return nullptr;
 	}
 
-	job_manager->worker_thread_count = num_threads;
+	fiber->pool_next = self->fibers;
+	self->fibers     = fiber;
+
+	return fiber;
 }
 
 // ----------------------------------------------------------------------
+// Return an idle fiber to this worker's fiber pool - or to the shared pool,
+// should this worker's pool be full, so that other workers may use it.
+static void le_worker_thread_release_fiber( le_worker_thread_o* self, le_fiber_o* fiber ) {
 
-static void le_job_manager_terminate() {
+	if ( self->idle_count < LOCAL_IDLE_FIBER_LIMIT ) {
+		fiber_list_push_back( &self->idle_fibers, fiber );
+		++self->idle_count;
+		return;
+	}
 
-	assert( job_manager ); // job manager must exist
+	// The shared pool has room for all fibers: push never has to wait.
+	lockfree_ring_buffer_push( job_manager->idle_fibers, fiber );
+}
 
-	// - Send termination signal to all threads.
+// ----------------------------------------------------------------------
+// Call just before a worker executes a job - returns the current time,
+// and accounts for any time the worker was idle.
+static inline uint64_t le_worker_thread_begin_busy( le_worker_thread_o* self ) {
 
-	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
-		( *t )->stop_thread = 1;
+	uint64_t const now_ns = le_jobs_now_ns();
+
+	if ( uint64_t idle_since = self->stats.idle_since.load( std::memory_order_relaxed ) ) {
+		le_worker_stat_add( self->stats.idle_ns, now_ns - idle_since );
+		self->stats.idle_since.store( 0, std::memory_order_relaxed );
 	}
 
-	// - Join all worker threads
+	return now_ns;
+}
 
-	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
-		( *t )->thread.join();
-		delete ( *t );
-		( *t ) = nullptr;
+// ----------------------------------------------------------------------
+// Call once a worker has stopped executing a job - either because the job
+// completed, or because it yielded, or waits.
+static inline void le_worker_thread_end_busy( le_worker_thread_o* self, uint64_t begin_ns, le_jobs_api::fun_ptr_t job, Priority priority, trace_event_outcome_t outcome ) {
+
+	uint64_t const end_ns = le_jobs_now_ns();
+
+	le_worker_stat_add( self->stats.busy_ns, end_ns - begin_ns );
+
+	if ( self->trace ) {
+		trace_event_t event;
+		event.begin_ns = begin_ns;
+		event.end_ns   = end_ns;
+		event.job      = reinterpret_cast<void*>( job );
+		event.priority = uint32_t( priority );
+		event.outcome  = outcome;
+		trace_ring_buffer_write( self->trace, &event );
 	}
+}
 
-	for ( size_t i = 0; i != FIBER_POOL_SIZE; ++i ) {
-		le_fiber_destroy( job_manager->fibers[ i ] );
-		job_manager->fibers[ i ] = nullptr;
-	}
+// ----------------------------------------------------------------------
+// Execute a stackless job directly on the worker's own stack - stackless
+// jobs run to completion in one go, which is why they don't need a fiber.
+static void le_worker_thread_run_stackless_job( le_worker_thread_o* self, le_job_o* job, Priority priority ) {
 
-	// attempt to delete any leftover jobs on the job queue.
-	void* ret;
-	while ( ( ret = lockfree_ring_buffer_trypop( job_manager->job_queue ) ) ) {
-		delete ( static_cast<le_job_o*>( ret ) );
-	}
+	le_jobs_api::fun_ptr_t fun_ptr   = job->fun_ptr;
+	void*                  fun_param = job->fun_param;
 
-	lockfree_ring_buffer_destroy( job_manager->job_queue );
+	le_job_record_free( job );
 
-	{
-		std::scoped_lock lock( job_manager->counters_mtx );
-		// free all leftover counters.
-		for ( auto& c : job_manager->counters ) {
-			delete c;
-		}
+	// Stackless jobs always run to completion, so we may count them up front - a
+	// stackless job may signal a counter, and waiters must find the job counted.
+	le_worker_stat_add( self->stats.jobs_executed, 1 );
 
-		// clear list of leftover counters.
-		job_manager->counters.clear();
-	}
+	uint64_t const begin_ns = le_worker_thread_begin_busy( self );
 
-	delete job_manager;
+	tls_is_stackless = true;
+	fun_ptr( fun_param );
+	tls_is_stackless = false;
 
-	job_manager = nullptr;
+	le_worker_thread_end_busy( self, begin_ns, fun_ptr, priority, TRACE_EVENT_COMPLETE );
 }
 
 // ----------------------------------------------------------------------
-// polls counter, and will not return until counter == target_value
-static void le_job_manager_wait_for_counter_and_free( counter_t* counter, uint32_t target_value ) {
-
-	auto current_worker = get_current_thread();
+// Returns true if a fiber, or a stackless job was executed, false if there
+// was nothing to do.
+static bool le_worker_thread_dispatch( le_worker_thread_o* self ) {
 
-	if ( nullptr == current_worker ) {
-		for ( ; counter->data != target_value; ) {
-			// called from the main thread - we must wait until
-			// all jobs which affect the counter have completed.
-			std::this_thread::sleep_for( std::chrono::nanoseconds( 100 ) );
+	// -- Move any fibers which have been made ready by other threads onto our ready list.
+	//
+	if ( self->ready_inbox.load( std::memory_order_relaxed ) ) {
+		le_fiber_o* f = self->ready_inbox.exchange( nullptr, std::memory_order_acquire );
+		while ( f ) {
+			le_fiber_o* next = f->list_next; // must capture next, since push_back updates the fiber
+			fiber_list_push_back( &self->ready_list, f );
+			f = next;
 		}
-	} else {
-		// This method has been issued from a job, and not from the main thread.
-		// We must issue a yield, but not before we have set the wait_counter for the
-		// current worker.
-		current_worker->guest_fiber->fiber_await_counter = counter;
-		// Switch back to current worker's host fiber
-		asm_switch( &current_worker->host_fiber, current_worker->guest_fiber, 0 );
-		// If we're back from the switch, this means that the counter has reached
-		// zero.
 	}
 
-	// --------| invariant: counter must be at zero.
-	assert( counter->data == 0 );
-
-	// Remove counter from list of counters owned by job manager
-	{
-		// we must protect this using a mutex, as other threads might want to add/remove counters
-		// and this might lead to a race condition on the forward_list of counters.
-		std::scoped_lock lock( job_manager->counters_mtx );
-		job_manager->counters.remove( counter );
-		// free counter memory
-		delete counter;
+	// -- If there is any fiber in the ready-list, we must switch to that fiber.
+	//
+	if ( self->ready_list.begin ) {
+		self->guest_fiber = self->ready_list.begin;
+		fiber_list_remove_element( &self->ready_list, self->ready_list.begin );
+	}
+
+	// -- Otherwise, yielded fibers and new jobs take turns.
+	//
+	if ( nullptr == self->guest_fiber && self->yielded_list.begin && !self->resumed_yielded ) {
+		self->guest_fiber = self->yielded_list.begin;
+		fiber_list_remove_element( &self->yielded_list, self->yielded_list.begin );
+		self->resumed_yielded = true;
+	} else if ( nullptr == self->guest_fiber ) {
+
+		self->guest_fiber = le_worker_thread_acquire_fiber( self );
+
+		if ( ( nullptr == self->guest_fiber ) != self->is_fiber_pool_exhausted ) {
+			// We only count the moment at which we run out of fibers, not every attempt while we're out.
+			self->is_fiber_pool_exhausted = !self->is_fiber_pool_exhausted;
+			if ( self->is_fiber_pool_exhausted ) {
+				le_worker_stat_add( self->stats.fiber_pool_exhausted, 1 );
+			}
+		}
+
+		Priority  priority = Priority::eNormal;
+		le_job_o* job      = self->guest_fiber ? le_worker_thread_find_job( self, &priority ) : nullptr;
+
+		if ( nullptr == job ) {
+			// We couldn't get an available fiber, or another job from any queue - this could mean
+			// that all queues are empty. Resume a fiber which yielded, if there is any - otherwise
+			// it's up to the caller to decide whether to spin, or to park.
+
+			if ( self->guest_fiber ) {
+				le_worker_thread_release_fiber( self, self->guest_fiber ); // return fiber to pool
+				self->guest_fiber = nullptr;
+			}
+
+			if ( nullptr == self->yielded_list.begin ) {
+				if ( 0 == self->stats.idle_since.load( std::memory_order_relaxed ) ) {
+					self->stats.idle_since.store( le_jobs_now_ns(), std::memory_order_relaxed );
+				}
+				return false;
+			}
+
+			self->guest_fiber = self->yielded_list.begin;
+			fiber_list_remove_element( &self->yielded_list, self->yielded_list.begin );
+			self->resumed_yielded = true;
+		} else if ( STACKLESS_JOB == job->complete_counter ) {
+
+			// Stackless jobs don't need the fiber - we may return it right away.
+			le_worker_thread_release_fiber( self, self->guest_fiber );
+			self->guest_fiber     = nullptr;
+			self->resumed_yielded = false;
+
+			le_worker_thread_run_stackless_job( self, job, priority );
+
+			return true;
+		} else {
+
+			le_fiber_load_job( self->guest_fiber, &self->host_fiber, job );
+			self->resumed_yielded = false;
+			self->guest_fiber->priority = priority;
+			++self->busy_count;
+
+			// we don't need job anymore after it was passed to fiber_setup
+			// and since the queue did own the job, we must free it here.
+			le_job_record_free( job );
+		}
+	}
+
+	// --------| invariant: current_fiber contains a fiber
+
+	// We are only allowed to switch to a fiber if its await counter has been
+	// signalled, or is unset. Otherwise this means that child jobs of a fiber
+	// are still executing.
+	assert( nullptr == self->guest_fiber->fiber_await_counter || le_counter_is_signalled( self->guest_fiber->fiber_await_counter ) );
+
+	assert( self->guest_fiber->stack ); // address of stack must not be 0
+
+	uint64_t const switch_begin_ns = le_worker_thread_begin_busy( self );
+
+	// switch to guest fiber
+	tls_current_fiber = self->guest_fiber;
+	asm_switch( self->guest_fiber, &self->host_fiber, 1 );
+	tls_current_fiber = nullptr;
+
+	le_worker_thread_end_busy( self, switch_begin_ns, self->guest_fiber->job_fun_ptr, self->guest_fiber->priority,
+	                           self->guest_fiber->job_complete          ? TRACE_EVENT_COMPLETE
+	                           : self->guest_fiber->fiber_await_counter ? TRACE_EVENT_WAIT
+	                                                                    : TRACE_EVENT_YIELD );
+
+	// If we're back here, this means that the fiber in current_fiber has
+	// finished executing for now. This can have two reasons:
+	//
+	// 1. Fiber did complete
+	// 2. Fiber did yield
+
+	if ( 1 == self->guest_fiber->job_complete ) {
+		// Fiber was completed: We must return it to the pool
+		if ( self->guest_fiber->scratch ) {
+			scratch_arena_reset( self->guest_fiber->scratch ); // free job's temporary allocations
+		}
+		self->guest_fiber->stack = nullptr;                        // Reset fiber stack
+		le_worker_thread_release_fiber( self, self->guest_fiber ); // return fiber to pool
+		self->guest_fiber = nullptr;                               // reset current fiber
+		--self->busy_count;
+	} else if ( self->guest_fiber->fiber_await_counter ) {
+		// Fiber waits for a counter: We hand it over to the counter, which
+		// will make it ready again once it reaches zero. Note that we may only
+		// do this now that the fiber has been switched out.
+		le_fiber_o* fiber = self->guest_fiber;
+		le_worker_stat_add( self->stats.waits, 1 );
+		if ( !le_counter_add_waiter( fiber->fiber_await_counter, reinterpret_cast<uintptr_t>( fiber ), &fiber->waiter_next ) ) {
+			// Counter was signalled in the meantime: fiber may resume right away.
+			fiber_list_push_back( &self->ready_list, fiber );
+		}
+		self->guest_fiber = nullptr;
+	} else {
+		// Fiber has yielded: It may resume once it's its turn again.
+		fiber_list_push_back( &self->yielded_list, self->guest_fiber );
+		self->guest_fiber = nullptr;
+		le_worker_stat_add( self->stats.yields, 1 );
 	}
+
+	return true;
 }
 
 // ----------------------------------------------------------------------
-// copies jobs into job queue
-static void le_job_manager_run_jobs( le_job_o* jobs, uint32_t num_jobs, counter_t** p_counter ) {
+// Main loop for each worker thread
+//
+static void le_worker_thread_loop( le_worker_thread_o* self ) {
 
-	auto counter  = new counter_t();
-	counter->data = num_jobs;
+	self->thread_id = std::this_thread::get_id();
 
+	uint32_t idle_rounds = 0;
+
+	while ( 0 == self->stop_thread.load( std::memory_order_relaxed ) ) {
+
+		if ( le_worker_thread_dispatch( self ) ) {
+			if ( idle_rounds != 0 ) {
+				// Spinning paid off - allow ourselves to spin a little longer next time.
+				self->spin_limit = std::min<uint32_t>( self->spin_limit * 2, WORKER_SPIN_LIMIT_MAX );
+			}
+			idle_rounds = 0;
+			continue;
+		}
+
+		// ----------| invariant: there was nothing to do.
+
+		if ( ++idle_rounds < self->spin_limit ) {
+			cpu_relax();
+			continue;
+		}
+
+		// Spinning did not pay off - spin a little less next time.
+		self->spin_limit = std::max<uint32_t>( self->spin_limit / 2, WORKER_SPIN_LIMIT_MIN );
+		idle_rounds      = 0;
+
+		le_worker_thread_park( self );
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_initialize( size_t num_threads, le_jobs_api::settings_t const* p_settings ) {
+
+	assert( num_threads <= MAX_WORKER_THREAD_COUNT );
+	assert( num_threads > 0 && "num_threads must be > than 0" );
+
+	assert( nullptr == job_manager );
+
+	asm_fetch_default_control_words( &DEFAULT_CONTROL_WORDS );
+
+	job_manager = new le_job_manager_o();
+
+	le_jobs_api::settings_t settings{};
+
+	if ( p_settings ) {
+		settings = *p_settings;
+	}
+
+	// Any settings which are 0 get default values
+	settings.fiber_pool_size     = settings.fiber_pool_size ? settings.fiber_pool_size : uint32_t( FIBER_POOL_SIZE );
+	settings.fiber_pool_size_max = settings.fiber_pool_size_max ? settings.fiber_pool_size_max : uint32_t( FIBER_POOL_SIZE_MAX );
+	settings.fiber_stack_size    = settings.fiber_stack_size ? settings.fiber_stack_size : FIBER_STACK_SIZE;
+
+#ifdef _WIN32
+	SYSTEM_INFO system_info;
+	GetSystemInfo( &system_info );
+	job_manager->page_size = system_info.dwPageSize;
+#else
+	job_manager->page_size = size_t( sysconf( _SC_PAGESIZE ) );
+#endif
+
+	job_manager->start_ns = le_jobs_now_ns();
+
+	if ( settings.trace_capacity ) {
+		job_manager->is_tracing          = true;
+		job_manager->trace_capacity_log2 = std::max<uint32_t>( 1, std::bit_width( settings.trace_capacity - 1 ) );
+	}
+
+	job_manager->fiber_stack_size = ( settings.fiber_stack_size + job_manager->page_size - 1 ) & ~( job_manager->page_size - 1 );
+	job_manager->fiber_count_max  = std::max( settings.fiber_pool_size_max, settings.fiber_pool_size );
+	job_manager->idle_fibers      = lockfree_ring_buffer_create( std::max<uint32_t>( 1, std::bit_width( job_manager->fiber_count_max - 1 ) ) ); // must have room for all fibers
+
+	for ( size_t lane = 0; lane != PRIORITY_COUNT; ++lane ) {
+		job_manager->job_queues[ lane ] = lockfree_ring_buffer_create( 10 ); // note size is given as a power of 2, so "10" means 1024 elements
+	}
+
+	job_manager->job_pool     = lockfree_slab_pool_create( sizeof( le_job_o ), alignof( le_job_o ), JOB_POOL_SIZE );
+	job_manager->counter_pool = lockfree_slab_pool_create( sizeof( counter_t ), alignof( counter_t ), COUNTER_POOL_SIZE );
+	job_manager->range_pool   = lockfree_slab_pool_create( sizeof( parallel_range_t ), alignof( parallel_range_t ), RANGE_POOL_SIZE );
+
+	job_manager->continuation_pool = lockfree_slab_pool_create( sizeof( le_continuation_o ), alignof( le_continuation_o ), CONTINUATION_POOL_SIZE );
+
+	for ( size_t i = 0; i != COROUTINE_FRAME_CLASS_COUNT; ++i ) {
+		size_t const frame_size       = COROUTINE_FRAME_SIZE_MIN << i;
+		job_manager->frame_pools[ i ] = lockfree_slab_pool_create( uint32_t( frame_size ), 64, uint32_t( COROUTINE_FRAME_POOL_BYTES / frame_size ) );
+	}
+
+	// Create all worker thread objects before we start any threads, so that
+	// workers will find a complete set of victims once they start stealing.
+	for ( size_t i = 0; i != num_threads; ++i ) {
+		le_worker_thread_o* w = new le_worker_thread_o();
+		w->worker_index       = uint32_t( i );
+		w->steal_seed         = uint32_t( i + 1 ) * 0x9e3779b9u; // must not be 0 for xorshift
+		for ( size_t lane = 0; lane != PRIORITY_COUNT; ++lane ) {
+			w->job_deques[ lane ] = work_stealing_deque_create( WORKER_DEQUE_SIZE_LOG2 );
+		}
+		if ( job_manager->is_tracing ) {
+			w->trace = trace_ring_buffer_create( job_manager->trace_capacity_log2 );
+		}
+		// Thread in static ledger of threads so that
+		// we may retrieve thread-ids later.
+		static_worker_threads[ i ] = w;
+	}
+
+	// Create the helper - a worker without a thread, which a thread from
+	// outside the job system may use while it waits for a counter.
 	{
-		std::scoped_lock lock( job_manager->counters_mtx );
-		job_manager->counters.emplace_front( counter );
+		le_worker_thread_o* w = new le_worker_thread_o();
+		w->worker_index       = uint32_t( num_threads );
+		w->steal_seed         = uint32_t( num_threads + 1 ) * 0x9e3779b9u;
+		for ( size_t lane = 0; lane != PRIORITY_COUNT; ++lane ) {
+			w->job_deques[ lane ] = work_stealing_deque_create( WORKER_DEQUE_SIZE_LOG2 );
+		}
+		if ( job_manager->is_tracing ) {
+			w->trace = trace_ring_buffer_create( job_manager->trace_capacity_log2 );
+		}
+		job_manager->helper = w;
+	}
+
+	// Allocate a number of fibers to execute jobs in, spread evenly over all workers.
+	for ( size_t i = 0; i != settings.fiber_pool_size; ++i ) {
+		le_worker_thread_o* w     = static_worker_threads[ i % num_threads ];
+		le_fiber_o*         fiber = le_worker_thread_acquire_fiber( w );
+		if ( nullptr == fiber ) {
+			break;
+		}
+		le_worker_thread_release_fiber( w, fiber );
 	}
 
+	job_manager->worker_thread_count = num_threads;
+
+	// Create a number of worker threads to host fibers in
+	for ( size_t i = 0; i != num_threads; ++i ) {
+
+		le_worker_thread_o* w = static_worker_threads[ i ];
+
+		w->thread = std::thread( le_worker_thread_loop, w );
+
+		auto pthread = w->thread.native_handle();
+#ifdef _MSC_VER
+
+#else
+		cpu_set_t mask;
+		CPU_ZERO( &mask );
+		CPU_SET( i + 1, &mask );
+		pthread_setaffinity_np( pthread, sizeof( mask ), &mask );
+#endif
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_terminate() {
+
+	assert( job_manager ); // job manager must exist
+
+	// - Send termination signal to all threads.
+
+	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
+		( *t )->stop_thread = 1;
+	}
+
+	// - Wake up any parked workers, so that they may see the termination signal.
+
+	le_job_manager_wake_workers( uint32_t( job_manager->worker_thread_count ) );
+
+	// - Join all worker threads
+
+	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
+		( *t )->thread.join();
+	}
+
+	// Helper goes last, so that we may treat it just like any other worker.
+	static_worker_threads[ job_manager->worker_thread_count ] = job_manager->helper;
+	job_manager->helper                                       = nullptr;
+
+	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
+		// attempt to delete any leftover jobs on the worker's deques.
+		for ( auto& job_deque : ( *t )->job_deques ) {
+			void* ret;
+			while ( ( ret = work_stealing_deque_trypop( job_deque ) ) ) {
+				le_job_record_free( static_cast<le_job_o*>( ret ) );
+			}
+			work_stealing_deque_destroy( job_deque );
+		}
+		for ( le_fiber_o* fiber = ( *t )->fibers; fiber != nullptr; ) {
+			le_fiber_o* next = fiber->pool_next;
+			le_fiber_destroy( fiber );
+			fiber = next;
+		}
+		trace_ring_buffer_destroy( ( *t )->trace );
+		delete ( *t );
+		( *t ) = nullptr;
+	}
+
+	// attempt to delete any leftover jobs on the job queues.
+	for ( auto& job_queue : job_manager->job_queues ) {
+		void* ret;
+		while ( ( ret = lockfree_ring_buffer_trypop( job_queue ) ) ) {
+			le_job_record_free( static_cast<le_job_o*>( ret ) );
+		}
+		lockfree_ring_buffer_destroy( job_queue );
+	}
+
+	// Note that this frees any leftover pooled counters - but not any counters
+	// which had to be allocated from the heap and were never waited upon.
+	lockfree_ring_buffer_destroy( job_manager->idle_fibers );
+	lockfree_slab_pool_destroy( job_manager->job_pool );
+	lockfree_slab_pool_destroy( job_manager->counter_pool );
+	lockfree_slab_pool_destroy( job_manager->range_pool );
+	lockfree_slab_pool_destroy( job_manager->continuation_pool );
+
+	for ( auto& frame_pool : job_manager->frame_pools ) {
+		lockfree_slab_pool_destroy( frame_pool );
+	}
+
+	delete job_manager;
+
+	job_manager = nullptr;
+}
+
+// ----------------------------------------------------------------------
+// will not return until counter == target_value
+// Turns the calling thread - which must be from outside the job system -
+// into a temporary worker, which executes jobs until `is_done` returns true.
+//
+// Before we may return, all fibers which started a job on the helper must
+// have completed, since a fiber can only ever resume on the thread on which
+// it started. We also don't want to leave any jobs behind on the helper's
+// deques - other workers could steal them, but the helper can't wake anyone.
+template <typename F>
+static void le_job_manager_help_until( F const& is_done ) {
+
+	le_worker_thread_o* self = job_manager->helper;
+
+	auto has_unfinished_work = [ self ]() -> bool {
+		if ( self->busy_count != 0 ) {
+			return true;
+		}
+		for ( auto const& job_deque : self->job_deques ) {
+			if ( work_stealing_deque_size( job_deque ) > 0 ) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	tls_is_helping = true;
+
+	uint32_t idle_rounds = 0;
+
+	while ( !is_done() || has_unfinished_work() ) {
+		if ( le_worker_thread_dispatch( self ) ) {
+			idle_rounds = 0;
+		} else if ( ++idle_rounds < WORKER_SPIN_LIMIT_MIN ) {
+			cpu_relax();
+		} else {
+			// Nothing to do - any jobs which affect the counter must be
+			// in flight on other workers. The helper can't park, as nobody
+			// would wake it, so we sleep briefly instead.
+			std::this_thread::sleep_for( std::chrono::nanoseconds( 100 ) );
+		}
+	}
+
+	// The helper is only idle for as long as somebody helps: we must not
+	// count the time until somebody helps again.
+	if ( uint64_t idle_since = self->stats.idle_since.load( std::memory_order_relaxed ) ) {
+		le_worker_stat_add( self->stats.idle_ns, le_jobs_now_ns() - idle_since );
+		self->stats.idle_since.store( 0, std::memory_order_relaxed );
+	}
+
+	tls_is_helping = false;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_wait_for_counter_and_free( counter_t* counter, uint32_t target_value ) {
+
+	// A counter which reaches zero is signalled by whoever decremented it
+	// last - only once it has been signalled do we know that nobody is
+	// going to touch the counter anymore. Any other target value must be polled.
+	auto is_at_target = [ counter, target_value ]() -> bool {
+		return ( 0 == target_value ) ? le_counter_is_signalled( counter ) : counter->data == target_value;
+	};
+
+	auto current_worker = get_current_thread();
+
+	assert( !tls_is_stackless && "stackless jobs must not wait - use run_stackless_job_after instead" );
+
+	if ( nullptr == current_worker ) {
+		// Called from the main thread - we must wait until all jobs which
+		// affect the counter have completed. We help out with executing
+		// jobs in the meantime, unless another thread is already helping.
+		uint32_t expected = 0;
+		if ( job_manager->helper_claimed.compare_exchange_strong( expected, 1, std::memory_order_acquire ) ) {
+			le_job_manager_help_until( is_at_target );
+			job_manager->helper_claimed.store( 0, std::memory_order_release );
+		} else {
+			for ( ; !is_at_target(); ) {
+				std::this_thread::sleep_for( std::chrono::nanoseconds( 100 ) );
+			}
+		}
+	} else if ( 0 == target_value ) {
+		if ( !is_at_target() ) {
+			// This method has been issued from a job, and not from the main thread.
+			// We must issue a yield, but not before we have set the wait_counter for the
+			// current fiber - the worker will then hand the fiber over to the counter.
+			le_fiber_o* fiber          = current_worker->guest_fiber;
+			fiber->fiber_await_counter = counter;
+			// Switch back to current worker's host fiber
+			asm_switch( &current_worker->host_fiber, fiber, 0 );
+			// If we're back from the switch, this means that the counter has reached
+			// zero. Note that fibers always resume on the same worker thread.
+			fiber->fiber_await_counter = nullptr;
+		}
+	} else {
+		for ( ; !is_at_target(); ) {
+			le_fiber_yield();
+		}
+	}
+
+	// --------| invariant: counter must be at zero.
+	assert( counter->data == 0 );
+
+	// Return counter to the pool of counters owned by job manager
+	le_counter_free( counter );
+}
+
+// ----------------------------------------------------------------------
+// Push a job record onto the current worker's deque for the given priority -
+// or, if called from outside the job system, or if the worker's deque is full,
+// onto the global job queue for the given priority. Does not wake any workers.
+static void le_job_manager_enqueue_job( le_worker_thread_o* current_worker, le_job_o* job, Priority priority ) {
+
+	size_t const lane = size_t( priority );
+
+	if ( current_worker && work_stealing_deque_trypush( current_worker->job_deques[ lane ], job ) ) {
+		uint32_t const depth = uint32_t( work_stealing_deque_size( current_worker->job_deques[ lane ] ) );
+		if ( depth > current_worker->stats.queue_depth_max.load( std::memory_order_relaxed ) ) {
+			current_worker->stats.queue_depth_max.store( depth, std::memory_order_relaxed );
+		}
+		return;
+	}
+
+	if ( 0 == lockfree_ring_buffer_trypush( job_manager->job_queues[ lane ], job ) ) {
+		// The global queue is full: we must make sure that all workers are awake
+		// to drain it, otherwise we might wait forever.
+		le_job_manager_wake_workers( uint32_t( job_manager->worker_thread_count ) );
+		lockfree_ring_buffer_push( job_manager->job_queues[ lane ], job );
+	}
+
+	// Anyone may push to the global queues, so we must update the high-water mark with compare-exchange.
+	uint32_t const depth     = uint32_t( lockfree_ring_buffer_size( job_manager->job_queues[ lane ] ) );
+	uint32_t       depth_max = job_manager->job_queue_depth_max.load( std::memory_order_relaxed );
+	while ( depth > depth_max && !job_manager->job_queue_depth_max.compare_exchange_weak( depth_max, depth, std::memory_order_relaxed ) ) {
+	}
+}
+
+// ----------------------------------------------------------------------
+// copies jobs into job queue for the given priority
+static void le_job_manager_run_jobs_with_priority( le_job_o* jobs, uint32_t num_jobs, counter_t** p_counter, Priority priority ) {
+
+	assert( size_t( priority ) < PRIORITY_COUNT );
+
+	counter_t* counter = le_counter_alloc( num_jobs );
+
+	// If we are called from within a job, jobs go onto the current worker's
+	// own deque, where they are picked up again by this worker, or stolen
+	// by other workers. Otherwise jobs go onto the global job queue.
+	le_worker_thread_o* current_worker = get_current_thread();
+
 	le_job_o*       j        = jobs;
 	le_job_o* const jobs_end = jobs + num_jobs;
 
 	for ( ; j != jobs_end; j++ ) {
 		// Note that we must store a pointer to counter with each job,
 		// which is why we must allocate job objects for each job.
-		// Jobs are freed when
-		lockfree_ring_buffer_push( job_manager->job_queue, new le_job_o{ j->fun_ptr, j->fun_param, counter } );
+		// Jobs are freed when they have been loaded into a fiber.
+		le_job_manager_enqueue_job( current_worker, le_job_record_alloc( j->fun_ptr, j->fun_param, counter ), priority );
 	}
 
+	// Wake up as many parked workers as we have issued jobs - if we were
+	// called from within a worker, this worker will pick up one of the jobs.
+	le_job_manager_wake_workers( ( current_worker && num_jobs > 0 ) ? num_jobs - 1 : num_jobs );
+
 	// store address back into parameter, so that caller knows about our counter.
 	if ( p_counter ) {
 		*p_counter = counter;
@@ -578,14 +1551,635 @@ static void le_job_manager_run_jobs( le_job_o* jobs, uint32_t num_jobs, counter_
 
 // ----------------------------------------------------------------------
 
+static void le_job_manager_run_jobs( le_job_o* jobs, uint32_t num_jobs, counter_t** p_counter ) {
+	le_job_manager_run_jobs_with_priority( jobs, num_jobs, p_counter, Priority::eNormal );
+}
+
+// ----------------------------------------------------------------------
+// Continuations
+//
+// A continuation holds jobs which may only be issued once all counters
+// it depends on have reached zero. It waits for its dependencies one
+// after the other: it adds itself to the waiters of its next dependency,
+// and whoever signals that counter moves the continuation on to the
+// next dependency. Once there are no more dependencies left, the
+// continuation frees its dependency counters, and issues its jobs.
+//
+// This way, a continuation only ever waits on one counter at a time -
+// which means it needs just one link - and no fiber needs to wait.
+
+// ----------------------------------------------------------------------
+
+static uintptr_t le_continuation_waiter_next( le_continuation_o const* continuation ) {
+	return continuation->waiter_next;
+}
+
+// ----------------------------------------------------------------------
+
+static le_continuation_o* le_continuation_alloc() {
+	void* mem = lockfree_slab_pool_trypop( job_manager->continuation_pool );
+	if ( nullptr == mem ) {
+		++job_manager->continuation_heap_allocations;
+		return new le_continuation_o{};
+	}
+	return new ( mem ) le_continuation_o{};
+}
+
+// ----------------------------------------------------------------------
+
+static void le_continuation_free( le_continuation_o* continuation ) {
+	if ( continuation->dependencies != continuation->inline_dependencies ) {
+		delete[] continuation->dependencies;
+	}
+	if ( continuation->jobs != continuation->inline_jobs ) {
+		delete[] continuation->jobs;
+	}
+	if ( lockfree_slab_pool_owns( job_manager->continuation_pool, continuation ) ) {
+		lockfree_slab_pool_push( job_manager->continuation_pool, continuation );
+	} else {
+		delete continuation;
+	}
+}
+
+// ----------------------------------------------------------------------
+// Wait for the next dependency which has not yet been signalled - or, if
+// all dependencies have been signalled, issue jobs. May be called from
+// any thread.
+static void le_continuation_advance( le_continuation_o* continuation ) {
+
+	while ( continuation->next_dependency != continuation->num_dependencies ) {
+		counter_t* dependency = continuation->dependencies[ continuation->next_dependency++ ];
+		if ( le_counter_add_waiter( dependency, reinterpret_cast<uintptr_t>( continuation ) | WAITER_TAG_CONTINUATION, &continuation->waiter_next ) ) {
+			// --------| invariant: continuation now belongs to dependency, we must not touch it anymore.
+			return;
+		}
+	}
+
+	// --------| invariant: all dependencies have been signalled.
+
+	for ( uint32_t i = 0; i != continuation->num_dependencies; ++i ) {
+		le_counter_free( continuation->dependencies[ i ] );
+	}
+
+	le_worker_thread_o* current_worker = get_current_thread();
+
+	for ( uint32_t i = 0; i != continuation->num_jobs; ++i ) {
+		le_job_manager_enqueue_job( current_worker, continuation->jobs[ i ], continuation->priority );
+	}
+
+	le_job_manager_wake_workers( continuation->num_jobs );
+
+	counter_t* complete_counter = continuation->complete_counter;
+
+	le_continuation_free( continuation );
+
+	// Release the extra count which we held while jobs had not yet been issued.
+	if ( complete_counter ) {
+		le_counter_decrement( complete_counter );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Issue jobs once all dependency counters have reached zero.
+//
+// Takes ownership of dependency counters - these are freed once they have
+// all been signalled. Counters which are nullptr are ignored.
+static void le_job_manager_run_jobs_after( counter_t** dependencies, uint32_t num_dependencies,
+                                           le_job_o* jobs, uint32_t num_jobs, counter_t** p_counter, Priority priority ) {
+
+	assert( size_t( priority ) < PRIORITY_COUNT );
+
+	// The extra count keeps counter from reaching zero before we have issued all jobs.
+	counter_t*         counter      = le_counter_alloc( num_jobs + 1 );
+	le_continuation_o* continuation = le_continuation_alloc();
+
+	continuation->complete_counter = counter;
+	continuation->priority         = priority;
+	continuation->dependencies     = continuation->inline_dependencies;
+	continuation->jobs             = continuation->inline_jobs;
+
+	if ( num_dependencies > CONTINUATION_INLINE_DEPENDENCIES ) {
+		++job_manager->continuation_heap_allocations;
+		continuation->dependencies = new counter_t*[ num_dependencies ];
+	}
+
+	if ( num_jobs > CONTINUATION_INLINE_JOBS ) {
+		++job_manager->continuation_heap_allocations;
+		continuation->jobs = new le_job_o*[ num_jobs ];
+	}
+
+	for ( uint32_t i = 0; i != num_dependencies; ++i ) {
+		if ( dependencies[ i ] ) {
+			continuation->dependencies[ continuation->num_dependencies++ ] = dependencies[ i ];
+		}
+	}
+
+	for ( uint32_t i = 0; i != num_jobs; ++i ) {
+		continuation->jobs[ continuation->num_jobs++ ] = le_job_record_alloc( jobs[ i ].fun_ptr, jobs[ i ].fun_param, counter );
+	}
+
+	// store address back into parameter before we advance: once jobs have
+	// been issued, they may complete at any time.
+	if ( p_counter ) {
+		*p_counter = counter;
+	}
+
+	le_continuation_advance( continuation );
+}
+
+// ----------------------------------------------------------------------
+// Stackless jobs
+//
+// Stackless jobs go into the same lanes as any other jobs, but they run
+// directly on a worker's own stack, without a fiber. This makes them
+// cheap - but it also means that they can't yield, nor wait: a stackless
+// job must run to completion in one go. To continue once some counter
+// has reached zero, a stackless job issues another stackless job via
+// run_stackless_job_after. This is how le_jobs::task resumes coroutines.
+
+static void le_job_manager_run_stackless_jobs( le_job_o* jobs, uint32_t num_jobs, Priority priority ) {
+
+	assert( size_t( priority ) < PRIORITY_COUNT );
+
+	le_worker_thread_o* current_worker = get_current_thread();
+
+	for ( uint32_t i = 0; i != num_jobs; ++i ) {
+		le_job_manager_enqueue_job( current_worker, le_job_record_alloc( jobs[ i ].fun_ptr, jobs[ i ].fun_param, STACKLESS_JOB ), priority );
+	}
+
+	le_job_manager_wake_workers( ( current_worker && num_jobs > 0 ) ? num_jobs - 1 : num_jobs );
+}
+
+// ----------------------------------------------------------------------
+// Issue a stackless job once `counter` has reached zero. Takes ownership of
+// counter. Returns false, without issuing the job, if counter had already
+// reached zero - so that the caller may continue right away instead.
+static bool le_job_manager_run_stackless_job_after( counter_t* counter, le_job_o const* job, Priority priority ) {
+
+	assert( size_t( priority ) < PRIORITY_COUNT );
+
+	if ( le_counter_is_signalled( counter ) ) {
+		le_counter_free( counter );
+		return false;
+	}
+
+	le_continuation_o* continuation = le_continuation_alloc();
+
+	continuation->priority          = priority;
+	continuation->dependencies      = continuation->inline_dependencies;
+	continuation->jobs              = continuation->inline_jobs;
+	continuation->num_dependencies  = 1;
+	continuation->num_jobs          = 1;
+	continuation->dependencies[ 0 ] = counter;
+	continuation->jobs[ 0 ]         = le_job_record_alloc( job->fun_ptr, job->fun_param, STACKLESS_JOB );
+
+	le_continuation_advance( continuation );
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+
+static counter_t* le_job_manager_create_counter( uint32_t value ) {
+	return le_counter_alloc( value );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_decrement_counter( counter_t* counter ) {
+	assert( counter->data.load( std::memory_order_relaxed ) > 0 );
+	le_counter_decrement( counter );
+}
+
+// ----------------------------------------------------------------------
+// Coroutine frames come from pools, one per size class: 128, 256, ... bytes.
+// Returns COROUTINE_FRAME_CLASS_COUNT for frames which are too large for any pool.
+static inline size_t le_coroutine_frame_size_class( size_t num_bytes ) {
+	size_t size_class = size_t( std::bit_width( ( std::max<size_t>( num_bytes, 1 ) - 1 ) / COROUTINE_FRAME_SIZE_MIN ) );
+	return std::min( size_class, COROUTINE_FRAME_CLASS_COUNT );
+}
+
+// ----------------------------------------------------------------------
+
+static void* le_job_manager_coroutine_frame_alloc( size_t num_bytes ) {
+
+	if ( job_manager ) {
+		size_t size_class = le_coroutine_frame_size_class( num_bytes );
+		if ( size_class < COROUTINE_FRAME_CLASS_COUNT ) {
+			if ( void* mem = lockfree_slab_pool_trypop( job_manager->frame_pools[ size_class ] ) ) {
+				return mem;
+			}
+		}
+		++job_manager->frame_heap_allocations;
+	}
+
+	return ::operator new( num_bytes );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_coroutine_frame_free( void* frame, size_t num_bytes ) {
+
+	if ( job_manager ) {
+		size_t size_class = le_coroutine_frame_size_class( num_bytes );
+		if ( size_class < COROUTINE_FRAME_CLASS_COUNT && lockfree_slab_pool_owns( job_manager->frame_pools[ size_class ], frame ) ) {
+			lockfree_slab_pool_push( job_manager->frame_pools[ size_class ], frame );
+			return;
+		}
+	}
+
+	::operator delete( frame );
+}
+
+// ----------------------------------------------------------------------
+// parallel_for, parallel_reduce
+//
+// We use lazy binary splitting: a range job processes its range in chunks
+// of `grain_size` elements. Before each chunk, it checks whether its
+// worker's deque has run empty - which means that any work we pushed
+// earlier has been stolen, and other workers are hungry. Only then does
+// it split off the upper half of its remaining range into a new job.
+//
+// This means we only create as many jobs as there is demand for, and
+// small ranges don't create any jobs at all.
+//
+// All range jobs which belong to the same call share one counter. Since
+// a range job only ever splits while it is itself still running, the
+// counter can never reach zero before the whole range is processed.
+
+struct parallel_context_t {
+	uint32_t                                grain_size;
+	le_jobs_api::parallel_for_fun_t         for_fun;     // set for parallel_for
+	le_jobs_api::parallel_reduce_fun_t      reduce_fun;  // set for parallel_reduce
+	le_jobs_api::parallel_reduce_join_fun_t join_fun;    // set for parallel_reduce
+	void*                                   user_data;   //
+	counter_t*                              counter;     // counts range jobs in flight
+	Priority                                priority;    // priority for range jobs: that of the caller
+	void*                                   result;      // parallel_reduce: final result, protected by result_lock
+	void const*                             identity;    // parallel_reduce: initial value for accumulators
+	uint32_t                                result_size; // parallel_reduce: size of result in bytes
+	std::atomic_flag                        result_lock = ATOMIC_FLAG_INIT;
+};
+
+static void parallel_range_job( void* param ); // ffdecl
+
+// ----------------------------------------------------------------------
+
+static parallel_range_t* parallel_range_alloc( uint32_t begin, uint32_t end, parallel_context_t* ctx ) {
+	void* mem = lockfree_slab_pool_trypop( job_manager->range_pool );
+	if ( nullptr == mem ) {
+		++job_manager->range_heap_allocations;
+		return new parallel_range_t{ begin, end, ctx };
+	}
+	return new ( mem ) parallel_range_t{ begin, end, ctx };
+}
+
+// ----------------------------------------------------------------------
+
+static void parallel_range_free( parallel_range_t* range ) {
+	if ( lockfree_slab_pool_owns( job_manager->range_pool, range ) ) {
+		lockfree_slab_pool_push( job_manager->range_pool, range );
+	} else {
+		delete range;
+	}
+}
+
+// ----------------------------------------------------------------------
+// Issue a job which processes range [begin, end) - the caller must have accounted for the job in ctx->counter
+static void parallel_range_issue( le_worker_thread_o* current_worker, uint32_t begin, uint32_t end, parallel_context_t* ctx ) {
+	le_job_manager_enqueue_job( current_worker, le_job_record_alloc( parallel_range_job, parallel_range_alloc( begin, end, ctx ), ctx->counter ), ctx->priority );
+	le_job_manager_wake_workers( 1 );
+}
+
+// ----------------------------------------------------------------------
+
+static void parallel_range_job( void* param ) {
+
+	parallel_range_t* range = static_cast<parallel_range_t*>( param );
+
+	uint32_t            begin = range->begin;
+	uint32_t            end   = range->end;
+	parallel_context_t* ctx   = range->ctx;
+
+	parallel_range_free( range );
+
+	le_worker_thread_o* current_worker = get_current_thread();
+	assert( current_worker );
+
+	// For parallel_reduce, each range job accumulates into its own local
+	// accumulator, which it joins into the result once it is done.
+	// This is so that we don't need to synchronise for each chunk.
+	constexpr size_t LOCAL_ACCUMULATOR_SIZE = 256;
+	alignas( 16 ) char local_accumulator_storage[ LOCAL_ACCUMULATOR_SIZE ];
+	void*              accumulator = nullptr;
+
+	if ( ctx->reduce_fun ) {
+		accumulator = ( ctx->result_size <= LOCAL_ACCUMULATOR_SIZE ) ? local_accumulator_storage : malloc( ctx->result_size );
+		memcpy( accumulator, ctx->identity, ctx->result_size );
+	}
+
+	while ( begin < end ) {
+
+		if ( end - begin > ctx->grain_size &&
+		     0 == work_stealing_deque_size( current_worker->job_deques[ size_t( ctx->priority ) ] ) ) {
+			// Somebody took our work - split off upper half of our range for others to pick up.
+			uint32_t mid = begin + ( end - begin ) / 2;
+			ctx->counter->data.fetch_add( 1, std::memory_order_relaxed ); // can't reach zero while we are still running
+			parallel_range_issue( current_worker, mid, end, ctx );
+			end = mid;
+			continue;
+		}
+
+		uint32_t chunk_end = ( end - begin > ctx->grain_size ) ? begin + ctx->grain_size : end;
+
+		if ( ctx->for_fun ) {
+			ctx->for_fun( begin, chunk_end, ctx->user_data );
+		} else {
+			ctx->reduce_fun( begin, chunk_end, accumulator, ctx->user_data );
+		}
+
+		begin = chunk_end;
+	}
+
+	if ( ctx->reduce_fun ) {
+		while ( ctx->result_lock.test_and_set( std::memory_order_acquire ) ) {
+			cpu_relax();
+		}
+		ctx->join_fun( ctx->result, accumulator, ctx->user_data );
+		ctx->result_lock.clear( std::memory_order_release );
+
+		if ( accumulator != local_accumulator_storage ) {
+			free( accumulator );
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void parallel_context_run( uint32_t begin, uint32_t end, parallel_context_t* ctx ) {
+
+	le_worker_thread_o* current_worker = get_current_thread();
+
+	// Range jobs inherit the priority of the job which issued them.
+	ctx->priority = ( current_worker && current_worker->guest_fiber ) ? current_worker->guest_fiber->priority : Priority::eNormal;
+	ctx->counter  = le_counter_alloc( 1 ); // accounts for the initial range job
+
+	parallel_range_issue( current_worker, begin, end, ctx );
+
+	le_job_manager_wait_for_counter_and_free( ctx->counter, 0 );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_parallel_for( uint32_t begin, uint32_t end, uint32_t grain_size,
+                                         le_jobs_api::parallel_for_fun_t fun, void* user_data ) {
+
+	assert( !tls_is_stackless && "stackless jobs must not wait - use parallel_for only from regular jobs" );
+
+	grain_size = std::max<uint32_t>( grain_size, 1 );
+
+	if ( end <= begin ) {
+		return;
+	}
+
+	if ( end - begin <= grain_size ) {
+		// Not worth splitting: we process the range right here.
+		fun( begin, end, user_data );
+		return;
+	}
+
+	parallel_context_t ctx{};
+	ctx.grain_size = grain_size;
+	ctx.for_fun    = fun;
+	ctx.user_data  = user_data;
+
+	parallel_context_run( begin, end, &ctx );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_parallel_reduce( uint32_t begin, uint32_t end, uint32_t grain_size,
+                                            le_jobs_api::parallel_reduce_fun_t fun, le_jobs_api::parallel_reduce_join_fun_t join,
+                                            void* result, uint32_t result_size, void* user_data ) {
+
+	assert( !tls_is_stackless && "stackless jobs must not wait - use parallel_reduce only from regular jobs" );
+
+	grain_size = std::max<uint32_t>( grain_size, 1 );
+
+	if ( end <= begin ) {
+		return;
+	}
+
+	if ( end - begin <= grain_size ) {
+		// Not worth splitting: we accumulate straight into result.
+		fun( begin, end, result, user_data );
+		return;
+	}
+
+	// `result` holds the identity value on entry - we must keep a copy of it,
+	// since we will join partial results into `result`.
+	constexpr size_t LOCAL_IDENTITY_SIZE = 256;
+	alignas( 16 ) char local_identity_storage[ LOCAL_IDENTITY_SIZE ];
+	void*              identity = ( result_size <= LOCAL_IDENTITY_SIZE ) ? local_identity_storage : malloc( result_size );
+	memcpy( identity, result, result_size );
+
+	parallel_context_t ctx{};
+	ctx.grain_size  = grain_size;
+	ctx.reduce_fun  = fun;
+	ctx.join_fun    = join;
+	ctx.user_data   = user_data;
+	ctx.result      = result;
+	ctx.identity    = identity;
+	ctx.result_size = result_size;
+
+	parallel_context_run( begin, end, &ctx );
+
+	if ( identity != local_identity_storage ) {
+		free( identity );
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_get_allocation_stats( le_jobs_api::allocation_stats_t* stats ) {
+	assert( job_manager );
+	stats->job_pool_capacity             = lockfree_slab_pool_capacity( job_manager->job_pool );
+	stats->counter_pool_capacity         = lockfree_slab_pool_capacity( job_manager->counter_pool );
+	stats->job_heap_allocations          = job_manager->job_heap_allocations;
+	stats->counter_heap_allocations      = job_manager->counter_heap_allocations;
+	stats->fiber_count                   = job_manager->fiber_count;
+	stats->scratch_heap_allocations      = job_manager->scratch_heap_allocations;
+	stats->job_queue_depth_max           = job_manager->job_queue_depth_max;
+	stats->frame_heap_allocations        = job_manager->frame_heap_allocations;
+	stats->range_heap_allocations        = job_manager->range_heap_allocations;
+	stats->continuation_heap_allocations = job_manager->continuation_heap_allocations;
+}
+
+// ----------------------------------------------------------------------
+
+static uint32_t le_job_manager_get_worker_stats( le_jobs_api::worker_stats_t* stats, uint32_t max_count ) {
+
+	if ( nullptr == job_manager ) {
+		return 0;
+	}
+
+	uint32_t const worker_count = uint32_t( job_manager->worker_thread_count ) + 1; // +1 for helper
+	uint64_t const now_ns       = le_jobs_now_ns();
+
+	for ( uint32_t i = 0; stats && i != std::min( worker_count, max_count ); ++i ) {
+		le_worker_stats_o const& s = le_job_manager_get_worker( i )->stats;
+
+		// A worker which is idle right now hasn't yet added its current idle time.
+		uint64_t const idle_since = s.idle_since.load( std::memory_order_relaxed );
+
+		stats[ i ].jobs_executed        = s.jobs_executed.load( std::memory_order_relaxed );
+		stats[ i ].busy_ns              = s.busy_ns.load( std::memory_order_relaxed );
+		stats[ i ].idle_ns              = s.idle_ns.load( std::memory_order_relaxed ) + ( ( idle_since && now_ns > idle_since ) ? now_ns - idle_since : 0 );
+		stats[ i ].steals               = s.steals.load( std::memory_order_relaxed );
+		stats[ i ].yields               = s.yields.load( std::memory_order_relaxed );
+		stats[ i ].waits                = s.waits.load( std::memory_order_relaxed );
+		stats[ i ].fiber_pool_exhausted = s.fiber_pool_exhausted.load( std::memory_order_relaxed );
+		stats[ i ].queue_depth_max      = s.queue_depth_max.load( std::memory_order_relaxed );
+	}
+
+	return worker_count;
+}
+
+// ----------------------------------------------------------------------
+// Write job events of all workers as Chrome trace events - one complete ("X")
+// event per slice of time during which a job executed, one thread per worker.
+static bool le_job_manager_write_chrome_trace( char const* path ) {
+
+	if ( nullptr == job_manager || !job_manager->is_tracing ) {
+		return false;
+	}
+
+	FILE* file = fopen( path, "wb" );
+
+	if ( nullptr == file ) {
+		return false;
+	}
+
+	static char const* priority_names[ PRIORITY_COUNT ] = { "high", "normal", "background" };
+	static char const* outcome_names[]                  = { "complete", "yield", "wait" };
+
+	uint32_t const             worker_count = uint32_t( job_manager->worker_thread_count ) + 1; // +1 for helper
+	std::vector<trace_event_t> events( size_t( 1 ) << job_manager->trace_capacity_log2 );
+
+	fprintf( file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+
+	for ( uint32_t i = 0; i != worker_count; ++i ) {
+
+		fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+		         i ? ",\n" : "", i, ( i + 1 == worker_count ) ? "helper" : "worker", i );
+
+		size_t num_events = trace_ring_buffer_read( le_job_manager_get_worker( i )->trace, events.data(), events.size() );
+
+		for ( size_t j = 0; j != num_events; ++j ) {
+			trace_event_t const& e = events[ j ];
+			// Timestamps are in microseconds, relative to initialize.
+			fprintf( file, ",\n{\"name\":\"%p\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"end\":\"%s\"}}",
+			         e.job,
+			         e.priority < PRIORITY_COUNT ? priority_names[ e.priority ] : "unknown",
+			         i,
+			         double( e.begin_ns - job_manager->start_ns ) / 1000.0,
+			         double( e.end_ns - e.begin_ns ) / 1000.0,
+			         e.outcome <= TRACE_EVENT_WAIT ? outcome_names[ e.outcome ] : "unknown" );
+		}
+	}
+
+	fprintf( file, "\n]}\n" );
+
+	bool const success = ( 0 == ferror( file ) );
+
+	return ( 0 == fclose( file ) ) && success;
+}
+
+// ----------------------------------------------------------------------
+// Return scratch arena for the calling job - or for the calling thread,
+// if called from outside a job.
+static scratch_arena_t* le_jobs_get_scratch_arena() {
+	assert( !tls_is_stackless && "stackless jobs must not use scratch memory" );
+	scratch_arena_t** arena = tls_current_fiber ? &tls_current_fiber->scratch : &tls_thread_scratch.arena;
+	if ( nullptr == *arena ) {
+		*arena = scratch_arena_create( SCRATCH_BLOCK_SIZE );
+	}
+	return *arena;
+}
+
+// ----------------------------------------------------------------------
+
+static void* le_jobs_scratch_alloc( size_t num_bytes, size_t alignment ) {
+	scratch_arena_t* arena            = le_jobs_get_scratch_arena();
+	size_t           heap_allocations = scratch_arena_heap_allocations( arena );
+
+	void* result = scratch_arena_alloc( arena, num_bytes, alignment );
+
+	if ( job_manager && heap_allocations != scratch_arena_heap_allocations( arena ) ) {
+		++job_manager->scratch_heap_allocations;
+	}
+
+	return result;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_jobs_scratch_reset() {
+	scratch_arena_reset( le_jobs_get_scratch_arena() );
+}
+
+// ----------------------------------------------------------------------
+
+static uint32_t le_jobs_create_fiber_local_slot() {
+	uint32_t slot = fiber_local_slot_count.fetch_add( 1, std::memory_order_relaxed );
+	assert( slot < FIBER_LOCAL_SLOT_COUNT && "too many fiber-local slots" );
+	return slot;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_jobs_set_fiber_local( uint32_t slot, void* value ) {
+	assert( slot < FIBER_LOCAL_SLOT_COUNT );
+	assert( !tls_is_stackless && "stackless jobs must not use fiber-local storage" );
+	( tls_current_fiber ? tls_current_fiber->fiber_local : tls_thread_scratch.fiber_local )[ slot ] = value;
+}
+
+// ----------------------------------------------------------------------
+
+static void* le_jobs_get_fiber_local( uint32_t slot ) {
+	assert( slot < FIBER_LOCAL_SLOT_COUNT );
+	assert( !tls_is_stackless && "stackless jobs must not use fiber-local storage" );
+	return ( tls_current_fiber ? tls_current_fiber->fiber_local : tls_thread_scratch.fiber_local )[ slot ];
+}
+
+// ----------------------------------------------------------------------
+
 LE_MODULE_REGISTER_IMPL( le_jobs, api ) {
 
 	static_cast<le_jobs_api*>( api )->yield                     = le_fiber_yield;
 	static_cast<le_jobs_api*>( api )->get_current_worker_id     = get_current_worker_thread_id;
 	static_cast<le_jobs_api*>( api )->run_jobs                  = le_job_manager_run_jobs;
+	static_cast<le_jobs_api*>( api )->run_jobs_with_priority    = le_job_manager_run_jobs_with_priority;
+	static_cast<le_jobs_api*>( api )->run_jobs_after            = le_job_manager_run_jobs_after;
+	static_cast<le_jobs_api*>( api )->run_stackless_jobs        = le_job_manager_run_stackless_jobs;
+	static_cast<le_jobs_api*>( api )->run_stackless_job_after   = le_job_manager_run_stackless_job_after;
+	static_cast<le_jobs_api*>( api )->create_counter            = le_job_manager_create_counter;
+	static_cast<le_jobs_api*>( api )->decrement_counter         = le_job_manager_decrement_counter;
+	static_cast<le_jobs_api*>( api )->coroutine_frame_alloc     = le_job_manager_coroutine_frame_alloc;
+	static_cast<le_jobs_api*>( api )->coroutine_frame_free      = le_job_manager_coroutine_frame_free;
 	static_cast<le_jobs_api*>( api )->initialize                = le_job_manager_initialize;
 	static_cast<le_jobs_api*>( api )->terminate                 = le_job_manager_terminate;
 	static_cast<le_jobs_api*>( api )->wait_for_counter_and_free = le_job_manager_wait_for_counter_and_free;
+	static_cast<le_jobs_api*>( api )->get_allocation_stats      = le_job_manager_get_allocation_stats;
+	static_cast<le_jobs_api*>( api )->get_worker_stats          = le_job_manager_get_worker_stats;
+	static_cast<le_jobs_api*>( api )->write_chrome_trace        = le_job_manager_write_chrome_trace;
+	static_cast<le_jobs_api*>( api )->parallel_for              = le_job_manager_parallel_for;
+	static_cast<le_jobs_api*>( api )->parallel_reduce           = le_job_manager_parallel_reduce;
+	static_cast<le_jobs_api*>( api )->scratch_alloc             = le_jobs_scratch_alloc;
+	static_cast<le_jobs_api*>( api )->scratch_reset             = le_jobs_scratch_reset;
+	static_cast<le_jobs_api*>( api )->create_fiber_local_slot   = le_jobs_create_fiber_local_slot;
+	static_cast<le_jobs_api*>( api )->set_fiber_local           = le_jobs_set_fiber_local;
+	static_cast<le_jobs_api*>( api )->get_fiber_local           = le_jobs_get_fiber_local;
 
 	//	le_core_load_library_persistently( "libpthread.so" );
 }
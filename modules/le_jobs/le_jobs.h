@@ -9,6 +9,19 @@ struct le_jobs_api {
 	struct counter_t;
 
 	typedef void ( *fun_ptr_t )( void * );
+
+	/* Workers always pick jobs from higher priority lanes first - but every so
+	 * often they look at lower priority lanes first, so that these can't starve.
+	 */
+	enum class Priority : uint32_t {
+		eHigh       = 0, // frame-critical work
+		eNormal     = 1, // default
+		eBackground = 2, // long-running work which must not hold up frames, such as asset streaming
+	};
+
+	typedef void ( *parallel_for_fun_t         )( uint32_t begin, uint32_t end, void* user_data );
+	typedef void ( *parallel_reduce_fun_t      )( uint32_t begin, uint32_t end, void* accumulator, void* user_data );
+	typedef void ( *parallel_reduce_join_fun_t )( void* accumulator, void const* other, void* user_data );
 	
 	/* A Job is a function pointer with a complete_counter which gets decreased
 	 * once the job is complete.
@@ -19,12 +32,65 @@ struct le_jobs_api {
 		counter_t *complete_counter = nullptr; // owned by le_job_manager, counter to decrement when job completes
 	};
 
+	/* Job records and counters are allocated from fixed-size pools. Only if a pool
+	 * is exhausted does the job system fall back to allocating from the heap.
+	 * In steady state, heap allocation counts should therefore not increase.
+	 */
+	struct allocation_stats_t {
+		uint32_t job_pool_capacity;             // number of job records in job record pool
+		uint32_t counter_pool_capacity;         // number of counters in counter pool
+		uint64_t job_heap_allocations;          // number of job records allocated from the heap since initialize
+		uint64_t counter_heap_allocations;      // number of counters allocated from the heap since initialize
+		uint32_t fiber_count;                   // number of fibers currently in the fiber pool, whether idle or not
+		uint64_t scratch_heap_allocations;      // number of scratch memory blocks allocated from the heap since initialize
+		uint32_t job_queue_depth_max;           // highest number of jobs waiting in a global job queue since initialize - issuing jobs blocks once a queue holds 1024 jobs
+		uint64_t frame_heap_allocations;        // number of coroutine frames allocated from the heap since initialize - frames larger than 2 KB always are
+		uint64_t range_heap_allocations;        // number of parallel_for/parallel_reduce sub-range records allocated from the heap since initialize
+		uint64_t continuation_heap_allocations; // number of continuations, and of their dependency and job arrays, allocated from the heap since initialize
+	};
+
+	/* Scheduler counters for one worker, accumulated since initialize - subtract two
+	 * samples to get counters for an interval, such as a frame. Counters are always
+	 * on, and cheap: each worker updates only its own counters.
+	 *
+	 * Time which is neither busy, nor idle, is spent finding jobs, and switching fibers.
+	 */
+	struct worker_stats_t {
+		uint64_t jobs_executed;        // number of jobs which ran to completion on this worker
+		uint64_t busy_ns;              // time spent executing jobs
+		uint64_t idle_ns;              // time spent without any work, spinning or parked
+		uint64_t steals;               // number of jobs stolen from other workers
+		uint64_t yields;               // number of times a job yielded
+		uint64_t waits;                // number of times a job had to wait for a counter
+		uint64_t fiber_pool_exhausted; // number of times this worker ran out of fibers - no new job can start until a fiber becomes available
+		uint32_t queue_depth_max;      // highest number of jobs on any of this worker's job deques
+	};
+
+	/* Settings for initialize. Any field which is 0 gets its default value.
+	 *
+	 * Fiber stacks are only reserved - memory gets committed once it is touched, except
+	 * on Windows, see below.
+	 * A guard page below each stack makes stack overflows fault immediately.
+	 *
+	 * On Windows, which does not overcommit, each fiber's stack gets committed in
+	 * full when the fiber is created: up to fiber_pool_size_max * fiber_stack_size
+	 * bytes count against the system commit limit. Lower fiber_stack_size, or
+	 * fiber_pool_size_max, if that is too much. The guard page is only reserved.
+	 */
+	struct settings_t {
+		uint32_t fiber_pool_size;     // number of fibers to create on initialize (default: 128)
+		uint32_t fiber_pool_size_max; // fiber pool grows on demand up to this many fibers (default: 1024)
+		size_t   fiber_stack_size;    // stack size per fiber in bytes, rounded up to page size (default: 8 MB)
+		uint32_t trace_capacity;      // number of most recent job events each worker keeps for write_chrome_trace, rounded up to a power of 2 (default: 0, no tracing)
+	};
+
 	/* Initialise job system: This needs to be called only once,
 	 * before any other method involving the job system; 
 	 * 
 	 * `num_threads` tells us how many worker threads to initialise.
+	 * `settings` may be nullptr, in which case defaults are used.
 	 */
-	void ( * initialize                ) ( size_t num_threads );
+	void ( * initialize                ) ( size_t num_threads, settings_t const* settings );
 	void ( * terminate                 ) ( );
 
 	/* Adds num_jobs to the job system queue, and immediately starts running them.
@@ -37,9 +103,64 @@ struct le_jobs_api {
 	 */
 	void ( * run_jobs                  ) ( le_job_o* jobs, uint32_t num_jobs, counter_t** counter );
 
+	/* Like run_jobs, but jobs go into the lane for the given priority. `run_jobs` uses
+	 * `Priority::eNormal`. Jobs issued via parallel_for and parallel_reduce inherit the
+	 * priority of the job which calls them.
+	 */
+	void ( * run_jobs_with_priority    ) ( le_job_o* jobs, uint32_t num_jobs, counter_t** counter, Priority priority );
+
+	/* Like run_jobs_with_priority, but jobs are only issued once all `dependencies`
+	 * have reached zero. No fiber needs to wait for this: this is how to express
+	 * "B after A" without blocking a fiber - and, by chaining calls, whole graphs
+	 * of jobs, which can be issued anew every frame.
+	 *
+	 * Takes ownership of all dependency counters: these are freed once they have
+	 * all reached zero, which means that you must not wait for them anymore.
+	 * Dependencies which are nullptr are ignored.
+	 *
+	 * Allocates a counter for `jobs`, just like run_jobs, which you may wait on, or
+	 * pass as a dependency to run_jobs_after.
+	 */
+	void ( * run_jobs_after            ) ( counter_t** dependencies, uint32_t num_dependencies, le_job_o* jobs, uint32_t num_jobs, counter_t** counter, Priority priority );
+
+	/* Stackless jobs run directly on a worker thread's own stack, without a fiber, which
+	 * makes them much cheaper to issue and run than regular jobs. In return, a stackless
+	 * job must run to completion in one go: it must not yield, nor wait for counters, and
+	 * it can't use scratch memory, or fiber-local storage. It may issue further jobs.
+	 *
+	 * Stackless jobs are fire-and-forget: they don't have a counter. `complete_counter` of
+	 * each job is ignored.
+	 */
+	void ( * run_stackless_jobs        ) ( le_job_o* jobs, uint32_t num_jobs, Priority priority );
+
+	/* Issue a stackless job once `counter` has reached zero, without anyone having to wait.
+	 * Takes ownership of counter, just like wait_for_counter_and_free.
+	 *
+	 * Returns false, without issuing the job, if counter has already reached zero - in
+	 * which case the caller may just as well continue right away.
+	 */
+	bool ( * run_stackless_job_after   ) ( counter_t* counter, le_job_o const* job, Priority priority );
+
+	/* Create a counter with a given value, which you decrement yourself - for example once
+	 * some work which is not a job has completed. Wait for it, or pass it as a dependency
+	 * just like any counter returned by run_jobs. Must not be decremented below zero.
+	 */
+	counter_t* ( * create_counter      ) ( uint32_t value );
+	void       ( * decrement_counter   ) ( counter_t* counter );
+
+	/* Memory for coroutine frames, see le_jobs::task. Frames up to 2 KB come from pools
+	 * and only fall back to the heap once their pool is exhausted. Frames must be freed
+	 * before terminate, and `num_bytes` must match the size given on allocation.
+	 */
+	void* ( * coroutine_frame_alloc    ) ( size_t num_bytes );
+	void  ( * coroutine_frame_free     ) ( void* frame, size_t num_bytes );
+
 	/* Wait until counter == target value.
 	 * 
-	 * When called on the main thread, this method will spin-lock until counter is at target value.
+	 * When called on the main thread, this method will execute jobs until counter is at target value.
+	 * While it does so, the main thread acts as an extra worker, with worker id == number of worker
+	 * threads. Only one thread from outside the job system may help at a time - any other thread
+	 * will spin-lock until counter is at target value.
 	 * When called from within the job system, this method will yield until counter is at target value.
 	 * 
 	 * Once counter has reached target value, the counter is freed within the job system,
@@ -51,8 +172,76 @@ struct le_jobs_api {
 	void (* yield                      ) ( void );
 
 	// return id of current worker thread (0..MAX_THREADS), or -1 if called from outside job system.
+	// returns the number of worker threads if called from the main thread while it helps out in wait_for_counter_and_free.
 	int32_t (* get_current_worker_id)(void); 
 
+	// fill in allocation stats for job records and counters
+	void (* get_allocation_stats       ) ( allocation_stats_t* stats );
+
+	/* Fill in scheduler counters for up to `max_count` workers, ordered by worker id - the
+	 * last worker is the helper, i.e. the thread which helps out in wait_for_counter_and_free.
+	 * Returns the number of workers, including the helper, or 0 if the job system is not
+	 * initialised. `stats` may be nullptr, if you only want the number of workers.
+	 */
+	uint32_t (* get_worker_stats       ) ( worker_stats_t* stats, uint32_t max_count );
+
+	/* Write the most recent job events of all workers to `path`, in Chrome trace event
+	 * format - load the file in chrome://tracing, or https://ui.perfetto.dev. Each event
+	 * is a slice of time during which a job executed on a worker: a job which yields or
+	 * waits shows up as several slices. Jobs are named after the address of their function.
+	 *
+	 * Requires settings_t::trace_capacity to be set. Returns false if tracing is off, or
+	 * if the file could not be written. May be called at any time, from any thread.
+	 */
+	bool (* write_chrome_trace         ) ( char const* path );
+
+	/* Call `fun` over sub-ranges of [begin, end), in parallel, and wait until all
+	 * sub-ranges have been processed.
+	 * 
+	 * Sub-ranges have at most `grain_size` elements. Ranges are split lazily, only
+	 * when other workers run out of work - a range of up to `grain_size` elements
+	 * is processed directly by the caller, without issuing any jobs.
+	 * 
+	 * May be called from the main thread, or from within a job - but not from within
+	 * a stackless job, or a task, since these must not wait.
+	 */
+	void (* parallel_for               ) ( uint32_t begin, uint32_t end, uint32_t grain_size, parallel_for_fun_t fun, void* user_data );
+
+	/* Like parallel_for, but additionally reduces a result over [begin, end).
+	 * 
+	 * `result` must point to `result_size` bytes which hold the identity value for
+	 * the reduction on entry, and which will hold the reduced result on return.
+	 * 
+	 * `fun` accumulates elements of its sub-range into `accumulator`, which has been
+	 * initialised with the identity value. `join` combines `other` into `accumulator`.
+	 * Both `fun` and `join` must be associative, since the order in which sub-ranges
+	 * are combined is not deterministic. Result must be trivially copyable.
+	 *
+	 * Just like parallel_for, must not be called from within a stackless job, or a task.
+	 */
+	void (* parallel_reduce            ) ( uint32_t begin, uint32_t end, uint32_t grain_size, parallel_reduce_fun_t fun, parallel_reduce_join_fun_t join, void* result, uint32_t result_size, void* user_data );
+
+	/* Allocate temporary memory for the calling job, without locking, and in steady state,
+	 * without touching the heap. Memory stays valid while the job yields or waits, and is
+	 * freed once the job completes. There is no way to free individual allocations.
+	 *
+	 * Called from outside a job, memory comes from the calling thread's own scratch arena,
+	 * which is freed by scratch_reset - call this at frame boundaries, for example.
+	 * `alignment` must be a power of 2, and no larger than 64.
+	 */
+	void* (* scratch_alloc             ) ( size_t num_bytes, size_t alignment );
+
+	// Free all scratch memory of the calling job - or of the calling thread, if called from outside a job.
+	void (* scratch_reset              ) ( void );
+
+	/* Fiber-local storage: each job sees its own value per slot, which stays the same
+	 * while the job yields or waits. Slots are nullptr whenever a job starts. Outside of
+	 * jobs, slots act as thread-local storage. There are at most 16 slots.
+	 */
+	uint32_t (* create_fiber_local_slot) ( void );
+	void     (* set_fiber_local        ) ( uint32_t slot, void* value );
+	void*    (* get_fiber_local        ) ( uint32_t slot );
+
 };
 // clang-format on
 LE_MODULE( le_jobs );
@@ -60,19 +249,92 @@ LE_MODULE_LOAD_DEFAULT( le_jobs );
 
 #ifdef __cplusplus
 
+#	include <type_traits>
+
 namespace le_jobs {
 static const auto& api = le_jobs_api_i;
 
 using counter_t = le_jobs_api::counter_t;
 using job_t     = le_jobs_api::le_job_o;
+using Priority  = le_jobs_api::Priority;
+
+using allocation_stats_t = le_jobs_api::allocation_stats_t;
+using worker_stats_t     = le_jobs_api::worker_stats_t;
+using settings_t         = le_jobs_api::settings_t;
+
+inline void initialize( size_t num_threads, settings_t const* settings = nullptr ) {
+	api->initialize( num_threads, settings );
+}
 
-static const auto& initialize                = api -> initialize;
 static const auto& terminate                 = api -> terminate;
 static const auto& run_jobs                  = api -> run_jobs;
+static const auto& run_jobs_with_priority    = api -> run_jobs_with_priority;
+static const auto& run_jobs_after            = api -> run_jobs_after;
+static const auto& run_stackless_jobs        = api -> run_stackless_jobs;
+static const auto& create_counter            = api -> create_counter;
+static const auto& decrement_counter         = api -> decrement_counter;
 static const auto& wait_for_counter_and_free = api -> wait_for_counter_and_free;
 
 static const auto& yield                 = api -> yield;
 static const auto& get_current_worker_id = api -> get_current_worker_id;
+static const auto& get_allocation_stats  = api -> get_allocation_stats;
+static const auto& get_worker_stats      = api -> get_worker_stats;
+static const auto& write_chrome_trace    = api -> write_chrome_trace;
+
+static const auto& scratch_reset           = api -> scratch_reset;
+static const auto& create_fiber_local_slot = api -> create_fiber_local_slot;
+static const auto& set_fiber_local         = api -> set_fiber_local;
+static const auto& get_fiber_local         = api -> get_fiber_local;
+
+inline void* scratch_alloc( size_t num_bytes, size_t alignment = 16 ) {
+	return api->scratch_alloc( num_bytes, alignment );
+}
+
+// Allocate scratch memory for `count` objects of type T - objects are not
+// constructed, and never destroyed.
+template <typename T>
+inline T* scratch_alloc_array( size_t count ) {
+	static_assert( std::is_trivially_destructible<T>::value, "scratch memory is never destroyed" );
+	return static_cast<T*>( api->scratch_alloc( sizeof( T ) * count, alignof( T ) ) );
+}
+
+// Call `fn( begin, end )` over sub-ranges of [begin, end) in parallel,
+// and wait until all sub-ranges have been processed.
+template <typename F>
+inline void parallel_for( uint32_t begin, uint32_t end, uint32_t grain_size, F const& fn ) {
+	api->parallel_for(
+	    begin, end, grain_size,
+	    []( uint32_t b, uint32_t e, void* user_data ) {
+		    ( *static_cast<F const*>( user_data ) )( b, e );
+	    },
+	    const_cast<F*>( &fn ) );
+}
+
+// Reduce over [begin, end) in parallel: `fn( begin, end, T& accumulator )`
+// accumulates a sub-range, `join( T& accumulator, T const& other )` combines
+// two partial results. Returns the reduced result.
+template <typename T, typename F, typename J>
+inline T parallel_reduce( uint32_t begin, uint32_t end, uint32_t grain_size, T const& identity, F const& fn, J const& join ) {
+
+	struct callbacks_t {
+		F const& fn;
+		J const& join;
+	} callbacks{ fn, join };
+
+	T result = identity;
+
+	api->parallel_reduce(
+	    begin, end, grain_size,
+	    []( uint32_t b, uint32_t e, void* accumulator, void* user_data ) {
+		    static_cast<callbacks_t*>( user_data )->fn( b, e, *static_cast<T*>( accumulator ) );
+	    },
+	    []( void* accumulator, void const* other, void* user_data ) {
+		    static_cast<callbacks_t*>( user_data )->join( *static_cast<T*>( accumulator ), *static_cast<T const*>( other ) );
+	    },
+	    &result, uint32_t( sizeof( T ) ), &callbacks );
+
+	return result;
+}
 
 } // namespace le_jobs
 
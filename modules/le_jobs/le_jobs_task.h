@@ -0,0 +1,278 @@
+#ifndef GUARD_le_jobs_task_H
+#define GUARD_le_jobs_task_H
+
+/* le_jobs::task<T> - stackless coroutines, executed by le_jobs worker threads.
+ *
+ * A task is a coroutine which may `co_await` a counter_t*, or another task.
+ * Tasks don't need a fiber: they run as stackless jobs (see run_stackless_jobs),
+ * and while a task is suspended, all that's left of it is its coroutine frame,
+ * which comes from a pool. This makes tasks a good fit for many small steps
+ * which mostly wait for something else - such as loading and streaming assets.
+ *
+ * Tasks are lazy: a task only starts once it is awaited by another task, or
+ * once it is handed to run_task.
+ *
+ *     le_jobs::task<int> load_value( ... ) {
+ *         le_jobs::counter_t* counter;
+ *         le_jobs::run_jobs( jobs, num_jobs, &counter );
+ *         co_await counter;           // suspends until jobs are complete, and frees counter
+ *         co_return 42;
+ *     }
+ *
+ *     le_jobs::task<> load_all( ... ) {
+ *         int value = co_await load_value( ... );
+ *         ...
+ *     }
+ *
+ *     le_jobs::counter_t* counter;
+ *     le_jobs::run_task( load_all( ... ), &counter );
+ *     le_jobs::wait_for_counter_and_free( counter, 0 );
+ *
+ * Since tasks run as stackless jobs, tasks must never call yield, nor
+ * wait_for_counter_and_free - use `co_await` instead. Any task must have
+ * completed before the job system is terminated.
+ *
+ */
+
+#include "le_jobs.h"
+
+#include <coroutine>
+#include <exception> // for std::terminate
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace le_jobs {
+
+template <typename T = void>
+class task;
+
+namespace detail {
+
+// Resume coroutine with given address - this is the function of stackless jobs which resume tasks.
+inline void task_resume_job( void* address ) {
+	std::coroutine_handle<>::from_address( address ).resume();
+}
+
+// ----------------------------------------------------------------------
+
+struct task_promise_base {
+	std::coroutine_handle<> continuation     = nullptr;           // coroutine which awaits this task, resumed as soon as this task completes
+	counter_t*              complete_counter = nullptr;           // detached tasks only: decremented once task has completed
+	Priority                priority         = Priority::eNormal; // priority for jobs which resume this task
+	bool                    is_detached      = false;             // whether task frees its own frame once it completes, see run_task
+
+	// Coroutine frames come from le_jobs' frame pools.
+	static void* operator new( size_t num_bytes ) {
+		return api->coroutine_frame_alloc( num_bytes );
+	}
+
+	static void operator delete( void* frame, size_t num_bytes ) {
+		api->coroutine_frame_free( frame, num_bytes );
+	}
+
+	struct final_awaiter {
+		bool await_ready() const noexcept {
+			return false;
+		}
+
+		template <typename P>
+		std::coroutine_handle<> await_suspend( std::coroutine_handle<P> handle ) noexcept {
+			task_promise_base& promise = handle.promise();
+
+			if ( promise.continuation ) {
+				return promise.continuation; // resume whoever awaits us right here, on the same worker
+			}
+
+			if ( promise.is_detached ) {
+				// We must free our frame before we signal: whoever waits for
+				// the counter might terminate the job system right away.
+				counter_t* counter = promise.complete_counter;
+				handle.destroy();
+				if ( counter ) {
+					api->decrement_counter( counter );
+				}
+			}
+
+			return std::noop_coroutine();
+		}
+
+		void await_resume() const noexcept {
+		}
+	};
+
+	// Suspends until counter has reached zero, and then frees the counter.
+	struct counter_awaiter {
+		counter_t* counter;
+		Priority   priority;
+
+		bool await_ready() const noexcept {
+			return nullptr == counter;
+		}
+
+		bool await_suspend( std::coroutine_handle<> handle ) noexcept {
+			job_t job{ task_resume_job, handle.address() };
+			// If the counter has already reached zero, we don't suspend at all.
+			return api->run_stackless_job_after( counter, &job, priority );
+		}
+
+		void await_resume() const noexcept {
+		}
+	};
+
+	std::suspend_always initial_suspend() const noexcept {
+		return {};
+	}
+
+	final_awaiter final_suspend() const noexcept {
+		return {};
+	}
+
+	void unhandled_exception() const noexcept {
+		std::terminate();
+	}
+
+	counter_awaiter await_transform( counter_t* counter ) const noexcept {
+		return { counter, priority };
+	}
+
+	template <typename A>
+	A&& await_transform( A&& awaitable ) const noexcept {
+		return std::forward<A>( awaitable );
+	}
+};
+
+// ----------------------------------------------------------------------
+
+template <typename T>
+struct task_promise : task_promise_base {
+	std::optional<T> result;
+
+	template <typename U = T>
+	void return_value( U&& value ) {
+		result.emplace( std::forward<U>( value ) );
+	}
+
+	T take_result() {
+		return std::move( *result );
+	}
+};
+
+template <>
+struct task_promise<void> : task_promise_base {
+	void return_void() const noexcept {
+	}
+
+	void take_result() const noexcept {
+	}
+};
+
+} // namespace detail
+
+// ----------------------------------------------------------------------
+
+template <typename T>
+class task {
+  public:
+	struct promise_type : detail::task_promise<T> {
+		task get_return_object() noexcept {
+			return task( std::coroutine_handle<promise_type>::from_promise( *this ) );
+		}
+	};
+
+	using handle_t = std::coroutine_handle<promise_type>;
+
+	// Awaiting a task starts it right away, on the same worker, and resumes
+	// the awaiting coroutine once the task has completed.
+	struct awaiter {
+		handle_t handle;
+
+		bool await_ready() const noexcept {
+			return !handle || handle.done();
+		}
+
+		template <typename P>
+		std::coroutine_handle<> await_suspend( std::coroutine_handle<P> awaiting ) noexcept {
+			if constexpr ( std::is_base_of_v<detail::task_promise_base, P> ) {
+				handle.promise().priority = awaiting.promise().priority; // inherit priority from awaiting task
+			}
+			handle.promise().continuation = awaiting;
+			return handle;
+		}
+
+		T await_resume() {
+			return handle.promise().take_result();
+		}
+	};
+
+	task() noexcept = default;
+
+	task( task&& other ) noexcept
+	    : handle( std::exchange( other.handle, nullptr ) ) {
+	}
+
+	task& operator=( task&& other ) noexcept {
+		if ( this != &other ) {
+			if ( handle ) {
+				handle.destroy();
+			}
+			handle = std::exchange( other.handle, nullptr );
+		}
+		return *this;
+	}
+
+	task( task const& )            = delete;
+	task& operator=( task const& ) = delete;
+
+	~task() {
+		if ( handle ) {
+			handle.destroy();
+		}
+	}
+
+	awaiter operator co_await() & noexcept {
+		return { handle };
+	}
+
+	awaiter operator co_await() && noexcept {
+		return { handle };
+	}
+
+	// Give up ownership of the coroutine - see run_task.
+	handle_t release() noexcept {
+		return std::exchange( handle, nullptr );
+	}
+
+  private:
+	explicit task( handle_t handle_ ) noexcept
+	    : handle( handle_ ) {
+	}
+
+	handle_t handle = nullptr;
+};
+
+// ----------------------------------------------------------------------
+// Start a task on the job system's worker threads, without waiting for it.
+// The task frees itself once it has completed. If `counter` is given, it
+// receives a counter which reaches zero once the task has completed - wait
+// for it via wait_for_counter_and_free, or co_await it from another task.
+inline void run_task( task<>&& t, counter_t** counter = nullptr, Priority priority = Priority::eNormal ) {
+
+	auto  handle  = t.release();
+	auto& promise = handle.promise();
+
+	promise.priority         = priority;
+	promise.is_detached      = true;
+	promise.complete_counter = counter ? api->create_counter( 1 ) : nullptr;
+
+	if ( counter ) {
+		*counter = promise.complete_counter;
+	}
+
+	job_t job{ detail::task_resume_job, handle.address() };
+	api->run_stackless_jobs( &job, 1, priority );
+}
+
+} // namespace le_jobs
+
+#endif
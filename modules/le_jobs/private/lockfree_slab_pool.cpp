@@ -0,0 +1,122 @@
+#include "lockfree_slab_pool.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+/* The free list is a Treiber stack of element indices.
+ *
+ * To protect against ABA, the list head packs a 32 bit tag next to
+ * the index of the first free element; the tag is incremented with
+ * every successful update of the head.
+ *
+ * We store the link to the next free element outside of the element
+ * memory, so that a thread which lost a race may still safely read a
+ * (stale) link while another thread already writes into the element.
+ *
+ * Indices are stored +1, so that 0 may signal an empty list.
+ */
+
+struct lockfree_slab_pool_t {
+	std::atomic<uint64_t>  head{ 0 }; // tag << 32 | ( index + 1 )
+	char                   _cache_padding1[ 64 - sizeof( std::atomic<uint64_t> ) ];
+	uint8_t*               slab      = nullptr;
+	std::atomic<uint32_t>* next      = nullptr; // next[ i ] holds ( index + 1 ) of element following element i
+	size_t                 stride    = 0;
+	size_t                 alignment = 0;
+	uint32_t               capacity  = 0;
+};
+
+static constexpr uint64_t INDEX_MASK = 0xffffffff;
+
+// ----------------------------------------------------------------------
+
+lockfree_slab_pool_t* lockfree_slab_pool_create( uint32_t element_size, uint32_t element_alignment, uint32_t capacity ) {
+	assert( capacity > 0 );
+	assert( element_alignment && ( element_alignment & ( element_alignment - 1 ) ) == 0 && "alignment must be power of 2" );
+
+	lockfree_slab_pool_t* pool = new lockfree_slab_pool_t();
+
+	pool->stride    = ( size_t( element_size ) + element_alignment - 1 ) & ~( size_t( element_alignment ) - 1 );
+	pool->alignment = element_alignment;
+	pool->capacity  = capacity;
+	pool->slab      = static_cast<uint8_t*>( ::operator new( pool->stride * capacity, std::align_val_t( element_alignment ) ) );
+	pool->next      = new std::atomic<uint32_t>[ capacity ];
+
+	// Chain all elements into the free list, in order.
+	for ( uint32_t i = 0; i != capacity; ++i ) {
+		pool->next[ i ].store( ( i + 1 == capacity ) ? 0 : i + 2, std::memory_order_relaxed );
+	}
+
+	pool->head.store( 1, std::memory_order_release );
+
+	return pool;
+}
+
+// ----------------------------------------------------------------------
+
+void lockfree_slab_pool_destroy( lockfree_slab_pool_t* pool ) {
+	if ( nullptr == pool ) {
+		return;
+	}
+	::operator delete( pool->slab, std::align_val_t( pool->alignment ) );
+	delete[] pool->next;
+	delete pool;
+}
+
+// ----------------------------------------------------------------------
+
+void* lockfree_slab_pool_trypop( lockfree_slab_pool_t* pool ) {
+	assert( pool );
+
+	uint64_t head = pool->head.load( std::memory_order_acquire );
+
+	for ( ;; ) {
+		uint64_t index_plus_one = head & INDEX_MASK;
+
+		if ( 0 == index_plus_one ) {
+			return nullptr; // pool is exhausted
+		}
+
+		uint64_t next     = pool->next[ index_plus_one - 1 ].load( std::memory_order_relaxed );
+		uint64_t new_head = ( ( head >> 32 ) + 1 ) << 32 | next;
+
+		if ( pool->head.compare_exchange_weak( head, new_head, std::memory_order_acq_rel, std::memory_order_acquire ) ) {
+			return pool->slab + ( index_plus_one - 1 ) * pool->stride;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void lockfree_slab_pool_push( lockfree_slab_pool_t* pool, void* element ) {
+	assert( lockfree_slab_pool_owns( pool, element ) );
+
+	uint64_t index_plus_one = uint64_t( ( static_cast<uint8_t*>( element ) - pool->slab ) / pool->stride ) + 1;
+	uint64_t head           = pool->head.load( std::memory_order_relaxed );
+
+	for ( ;; ) {
+		pool->next[ index_plus_one - 1 ].store( uint32_t( head & INDEX_MASK ), std::memory_order_relaxed );
+		uint64_t new_head = ( ( head >> 32 ) + 1 ) << 32 | index_plus_one;
+
+		if ( pool->head.compare_exchange_weak( head, new_head, std::memory_order_release, std::memory_order_relaxed ) ) {
+			return;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+
+int lockfree_slab_pool_owns( const lockfree_slab_pool_t* pool, const void* element ) {
+	assert( pool );
+	auto p = static_cast<const uint8_t*>( element );
+	return p >= pool->slab && p < pool->slab + pool->stride * pool->capacity;
+}
+
+// ----------------------------------------------------------------------
+
+uint32_t lockfree_slab_pool_capacity( const lockfree_slab_pool_t* pool ) {
+	assert( pool );
+	return pool->capacity;
+}
@@ -0,0 +1,26 @@
+#ifndef _LOCK_FREE_SLAB_POOL_H_
+#define _LOCK_FREE_SLAB_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Fixed-capacity pool of equally-sized elements.
+ *
+ * All elements live in one contiguous slab, which is allocated once,
+ * on create. Free elements are kept on a lock-free free list, so that
+ * any thread may allocate and free elements without touching the
+ * global allocator, and without taking a lock.
+ *
+ * trypop returns nullptr if the pool is exhausted.
+ */
+
+struct lockfree_slab_pool_t;
+
+lockfree_slab_pool_t* lockfree_slab_pool_create( uint32_t element_size, uint32_t element_alignment, uint32_t capacity );
+void                  lockfree_slab_pool_destroy( lockfree_slab_pool_t* pool );
+void*                 lockfree_slab_pool_trypop( lockfree_slab_pool_t* pool );
+void                  lockfree_slab_pool_push( lockfree_slab_pool_t* pool, void* element );
+int                   lockfree_slab_pool_owns( const lockfree_slab_pool_t* pool, const void* element );
+uint32_t              lockfree_slab_pool_capacity( const lockfree_slab_pool_t* pool );
+
+#endif
@@ -0,0 +1,118 @@
+#include "scratch_arena.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <new>
+
+/* Blocks form a list, newest first. Each block starts with its header,
+ * followed by usable memory. The oldest block is never freed, unless the
+ * arena is destroyed.
+ */
+
+struct scratch_block_t {
+	scratch_block_t* prev; // previous (older) block, nullptr for first block
+	size_t           size; // number of usable bytes following the header
+};
+
+struct scratch_arena_t {
+	scratch_block_t* current          = nullptr; // block which we currently allocate from
+	uint8_t*         cursor           = nullptr; // next free byte in current block
+	uint8_t*         end              = nullptr; // end of current block
+	size_t           block_size       = 0;       // default number of usable bytes per block
+	size_t           heap_allocations = 0;       // number of blocks allocated since create
+};
+
+static constexpr size_t BLOCK_ALIGNMENT = 64;
+static constexpr size_t HEADER_SIZE     = ( sizeof( scratch_block_t ) + BLOCK_ALIGNMENT - 1 ) & ~( BLOCK_ALIGNMENT - 1 );
+
+// ----------------------------------------------------------------------
+
+static uint8_t* block_begin( scratch_block_t* block ) {
+	return reinterpret_cast<uint8_t*>( block ) + HEADER_SIZE;
+}
+
+// ----------------------------------------------------------------------
+// allocate a new block with at least num_bytes usable bytes, and make it
+// the current block.
+static void scratch_arena_push_block( scratch_arena_t* arena, size_t num_bytes ) {
+	size_t size  = num_bytes > arena->block_size ? num_bytes : arena->block_size;
+	auto   block = static_cast<scratch_block_t*>( ::operator new( HEADER_SIZE + size, std::align_val_t( BLOCK_ALIGNMENT ) ) );
+
+	block->prev = arena->current;
+	block->size = size;
+
+	arena->current = block;
+	arena->cursor  = block_begin( block );
+	arena->end     = arena->cursor + size;
+	arena->heap_allocations++;
+}
+
+// ----------------------------------------------------------------------
+
+scratch_arena_t* scratch_arena_create( size_t block_size ) {
+	assert( block_size > 0 );
+	scratch_arena_t* arena = new scratch_arena_t();
+	arena->block_size      = block_size;
+	return arena;
+}
+
+// ----------------------------------------------------------------------
+
+void scratch_arena_destroy( scratch_arena_t* arena ) {
+	if ( nullptr == arena ) {
+		return;
+	}
+	while ( arena->current ) {
+		scratch_block_t* prev = arena->current->prev;
+		::operator delete( arena->current, std::align_val_t( BLOCK_ALIGNMENT ) );
+		arena->current = prev;
+	}
+	delete arena;
+}
+
+// ----------------------------------------------------------------------
+
+void* scratch_arena_alloc( scratch_arena_t* arena, size_t num_bytes, size_t alignment ) {
+	assert( arena );
+	assert( alignment && ( alignment & ( alignment - 1 ) ) == 0 && "alignment must be power of 2" );
+	assert( alignment <= BLOCK_ALIGNMENT && "alignment must not be larger than block alignment" );
+
+	uintptr_t p = ( reinterpret_cast<uintptr_t>( arena->cursor ) + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+
+	if ( nullptr == arena->cursor || p + num_bytes > reinterpret_cast<uintptr_t>( arena->end ) ) {
+		// Current block is full: start a new block - which is aligned to BLOCK_ALIGNMENT.
+		scratch_arena_push_block( arena, num_bytes );
+		p = reinterpret_cast<uintptr_t>( arena->cursor );
+	}
+
+	arena->cursor = reinterpret_cast<uint8_t*>( p + num_bytes );
+
+	return reinterpret_cast<void*>( p );
+}
+
+// ----------------------------------------------------------------------
+
+void scratch_arena_reset( scratch_arena_t* arena ) {
+	assert( arena );
+
+	if ( nullptr == arena->current ) {
+		return;
+	}
+
+	// Free all blocks but the first one.
+	while ( arena->current->prev ) {
+		scratch_block_t* prev = arena->current->prev;
+		::operator delete( arena->current, std::align_val_t( BLOCK_ALIGNMENT ) );
+		arena->current = prev;
+	}
+
+	arena->cursor = block_begin( arena->current );
+	arena->end    = arena->cursor + arena->current->size;
+}
+
+// ----------------------------------------------------------------------
+
+size_t scratch_arena_heap_allocations( const scratch_arena_t* arena ) {
+	assert( arena );
+	return arena->heap_allocations;
+}
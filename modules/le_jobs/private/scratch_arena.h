@@ -0,0 +1,26 @@
+#ifndef _SCRATCH_ARENA_H_
+#define _SCRATCH_ARENA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Bump-pointer arena for temporary allocations.
+ *
+ * Memory comes in blocks: allocating bumps a cursor within the current
+ * block, and only once a block is full do we allocate another block from
+ * the heap. Individual allocations can't be freed - reset frees all of
+ * them at once, and keeps the first block around, so that an arena which
+ * is used over and over again doesn't touch the heap in steady state.
+ *
+ * An arena must only be used by one thread at a time.
+ */
+
+struct scratch_arena_t;
+
+scratch_arena_t* scratch_arena_create( size_t block_size );
+void             scratch_arena_destroy( scratch_arena_t* arena );
+void*            scratch_arena_alloc( scratch_arena_t* arena, size_t num_bytes, size_t alignment );
+void             scratch_arena_reset( scratch_arena_t* arena );
+size_t           scratch_arena_heap_allocations( const scratch_arena_t* arena );
+
+#endif
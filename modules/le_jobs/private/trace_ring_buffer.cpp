@@ -0,0 +1,110 @@
+#include "trace_ring_buffer.h"
+
+#include <assert.h>
+#include <atomic>
+
+/* Slots store their fields as relaxed atomics, so that a reader which
+ * races with the writer never sees a torn value. A torn event - some
+ * fields old, some fields new - is still possible, but readers detect
+ * this via `announced`, and discard any such event.
+ */
+
+struct trace_slot_t {
+	std::atomic<uint64_t> begin_ns{ 0 };
+	std::atomic<uint64_t> end_ns{ 0 };
+	std::atomic<void*>    job{ nullptr };
+	std::atomic<uint64_t> info{ 0 }; // priority in lower 32 bits, outcome in upper 32 bits
+};
+
+struct trace_ring_buffer_t {
+	std::atomic<uint64_t> announced{ 0 }; // number of events which the writer has begun to write since create
+	std::atomic<uint64_t> written{ 0 };   // number of events which the writer has finished writing since create
+	uint64_t              mask  = 0;       // size - 1
+	trace_slot_t*         slots = nullptr; // `size` slots
+};
+
+// ----------------------------------------------------------------------
+
+trace_ring_buffer_t* trace_ring_buffer_create( uint32_t power_of_2_size ) {
+	assert( power_of_2_size < 32 );
+	trace_ring_buffer_t* rb = new trace_ring_buffer_t();
+	rb->mask                = ( uint64_t( 1 ) << power_of_2_size ) - 1;
+	rb->slots               = new trace_slot_t[ rb->mask + 1 ];
+	return rb;
+}
+
+// ----------------------------------------------------------------------
+
+void trace_ring_buffer_destroy( trace_ring_buffer_t* rb ) {
+	if ( rb ) {
+		delete[] rb->slots;
+		delete rb;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void trace_ring_buffer_write( trace_ring_buffer_t* rb, trace_event_t const* event ) {
+	uint64_t const index = rb->written.load( std::memory_order_relaxed ); // we're the only writer
+	trace_slot_t&  slot  = rb->slots[ index & rb->mask ];
+
+	// Tell readers that the slot is about to be overwritten *before* we touch it.
+	rb->announced.store( index + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+
+	slot.begin_ns.store( event->begin_ns, std::memory_order_relaxed );
+	slot.end_ns.store( event->end_ns, std::memory_order_relaxed );
+	slot.job.store( event->job, std::memory_order_relaxed );
+	slot.info.store( uint64_t( event->priority ) | ( uint64_t( event->outcome ) << 32 ), std::memory_order_relaxed );
+
+	rb->written.store( index + 1, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------
+// Copy up to `max_count` of the most recent events, oldest first, into
+// `events`. Returns the number of events copied.
+size_t trace_ring_buffer_read( trace_ring_buffer_t const* rb, trace_event_t* events, size_t max_count ) {
+
+	uint64_t const size = rb->mask + 1;
+
+	uint64_t const end   = rb->written.load( std::memory_order_acquire );
+	uint64_t       begin = end > size ? end - size : 0;
+
+	if ( end - begin > max_count ) {
+		begin = end - max_count;
+	}
+
+	for ( uint64_t i = begin; i != end; ++i ) {
+		trace_slot_t const& slot = rb->slots[ i & rb->mask ];
+		trace_event_t&      e    = events[ i - begin ];
+		uint64_t const      info = slot.info.load( std::memory_order_relaxed );
+
+		e.begin_ns = slot.begin_ns.load( std::memory_order_relaxed );
+		e.end_ns   = slot.end_ns.load( std::memory_order_relaxed );
+		e.job      = slot.job.load( std::memory_order_relaxed );
+		e.priority = uint32_t( info );
+		e.outcome  = uint32_t( info >> 32 );
+	}
+
+	std::atomic_thread_fence( std::memory_order_acquire );
+
+	// Any event whose slot the writer has begun to overwrite in the meantime may be torn.
+	uint64_t const announced   = rb->announced.load( std::memory_order_relaxed );
+	uint64_t const first_valid = announced > size ? announced - size : 0;
+
+	if ( first_valid <= begin ) {
+		return size_t( end - begin );
+	}
+
+	if ( first_valid >= end ) {
+		return 0;
+	}
+
+	// Move valid events to the front.
+	size_t const num_valid = size_t( end - first_valid );
+	for ( size_t i = 0; i != num_valid; ++i ) {
+		events[ i ] = events[ first_valid - begin + i ];
+	}
+
+	return num_valid;
+}
@@ -0,0 +1,37 @@
+#ifndef _TRACE_RING_BUFFER_H_
+#define _TRACE_RING_BUFFER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Ring buffer which keeps the most recent trace events of one worker.
+ *
+ * There must only be one writer - the worker which owns the ring buffer -
+ * but any thread may read at any time. Writing never blocks, and never
+ * fails: once the ring buffer is full, the oldest events get overwritten.
+ * Readers copy events, and then discard any events which might have been
+ * overwritten while they were copying.
+ */
+
+struct trace_event_t {
+	uint64_t begin_ns; // timestamp at which job began (or resumed) executing
+	uint64_t end_ns;   // timestamp at which job completed, yielded, or started waiting
+	void*    job;      // job function
+	uint32_t priority; // priority lane of job
+	uint32_t outcome;  // how this slice of the job ended, see trace_event_outcome_t
+};
+
+enum trace_event_outcome_t : uint32_t {
+	TRACE_EVENT_COMPLETE = 0, // job completed
+	TRACE_EVENT_YIELD    = 1, // job yielded, and will resume once it's its turn again
+	TRACE_EVENT_WAIT     = 2, // job waits for a counter, and will resume once the counter is signalled
+};
+
+struct trace_ring_buffer_t;
+
+trace_ring_buffer_t* trace_ring_buffer_create( uint32_t power_of_2_size );
+void                 trace_ring_buffer_destroy( trace_ring_buffer_t* rb );
+void                 trace_ring_buffer_write( trace_ring_buffer_t* rb, trace_event_t const* event ); // owner only
+size_t               trace_ring_buffer_read( trace_ring_buffer_t const* rb, trace_event_t* events, size_t max_count );
+
+#endif
@@ -0,0 +1,122 @@
+#include "work_stealing_deque.h"
+
+#include <assert.h>
+#include <atomic>
+
+/* Implementation follows:
+ *
+ * Chase, Lev: "Dynamic Circular Work-Stealing Deque", SPAA 2005, and
+ * Lê, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing
+ * for Weak Memory Models", PPoPP 2013 - which gives us the memory orderings.
+ *
+ * We don't implement growing the buffer: callers push into a fallback
+ * queue if the deque is full. This means we never have to reclaim old
+ * buffers while thieves might still be reading from them.
+ */
+
+struct work_stealing_deque_t {
+	// top is written by thieves, bottom only by the owner: keep them on separate cache lines.
+	std::atomic<int64_t> top{ 0 };
+	char                 _cache_padding1[ 64 - sizeof( std::atomic<int64_t> ) ];
+	std::atomic<int64_t> bottom{ 0 };
+	char                 _cache_padding2[ 64 - sizeof( std::atomic<int64_t> ) ];
+	int64_t              size           = 0;
+	int64_t              power_of_2_mod = 0;
+	std::atomic<void*>*  buffer         = nullptr;
+};
+
+// ----------------------------------------------------------------------
+
+work_stealing_deque_t* work_stealing_deque_create( uint32_t power_of_2_size ) {
+	assert( power_of_2_size && power_of_2_size < 32 );
+	work_stealing_deque_t* dq = new work_stealing_deque_t();
+	dq->size                  = int64_t( 1 ) << power_of_2_size;
+	dq->power_of_2_mod        = dq->size - 1;
+	dq->buffer                = new std::atomic<void*>[ dq->size ]{};
+	return dq;
+}
+
+// ----------------------------------------------------------------------
+
+void work_stealing_deque_destroy( work_stealing_deque_t* dq ) {
+	if ( dq ) {
+		delete[] dq->buffer;
+		delete dq;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+size_t work_stealing_deque_size( const work_stealing_deque_t* dq ) {
+	assert( dq );
+	const int64_t b = dq->bottom.load( std::memory_order_relaxed );
+	const int64_t t = dq->top.load( std::memory_order_relaxed );
+	return b > t ? size_t( b - t ) : 0;
+}
+
+// ----------------------------------------------------------------------
+
+int work_stealing_deque_trypush( work_stealing_deque_t* dq, void* in ) {
+	assert( dq );
+	assert( in );
+	const int64_t b = dq->bottom.load( std::memory_order_relaxed );
+	const int64_t t = dq->top.load( std::memory_order_acquire );
+
+	if ( b - t >= dq->size ) {
+		return 0; // deque is full
+	}
+
+	dq->buffer[ b & dq->power_of_2_mod ].store( in, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+	dq->bottom.store( b + 1, std::memory_order_relaxed );
+	return 1;
+}
+
+// ----------------------------------------------------------------------
+
+void* work_stealing_deque_trypop( work_stealing_deque_t* dq ) {
+	assert( dq );
+	const int64_t b = dq->bottom.load( std::memory_order_relaxed ) - 1;
+	dq->bottom.store( b, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t t = dq->top.load( std::memory_order_relaxed );
+
+	if ( t > b ) {
+		// deque was empty - restore bottom
+		dq->bottom.store( b + 1, std::memory_order_relaxed );
+		return nullptr;
+	}
+
+	void* result = dq->buffer[ b & dq->power_of_2_mod ].load( std::memory_order_relaxed );
+
+	if ( t == b ) {
+		// This is the last element: we must race any thieves for it.
+		if ( !dq->top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {
+			result = nullptr; // a thief got there first
+		}
+		dq->bottom.store( b + 1, std::memory_order_relaxed );
+	}
+
+	return result;
+}
+
+// ----------------------------------------------------------------------
+
+void* work_stealing_deque_trysteal( work_stealing_deque_t* dq ) {
+	assert( dq );
+	int64_t t = dq->top.load( std::memory_order_acquire );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	const int64_t b = dq->bottom.load( std::memory_order_acquire );
+
+	if ( t >= b ) {
+		return nullptr; // deque is empty
+	}
+
+	void* result = dq->buffer[ t & dq->power_of_2_mod ].load( std::memory_order_relaxed );
+
+	if ( !dq->top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {
+		return nullptr; // lost the race against the owner, or another thief
+	}
+
+	return result;
+}
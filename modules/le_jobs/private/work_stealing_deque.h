@@ -0,0 +1,27 @@
+#ifndef _WORK_STEALING_DEQUE_H_
+#define _WORK_STEALING_DEQUE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Fixed-capacity Chase-Lev work-stealing deque.
+ *
+ * The owning thread pushes and pops at the bottom (LIFO), any other
+ * thread may steal from the top (FIFO). Push and pop must only ever
+ * be called by the owning thread, steal may be called by anyone.
+ *
+ * Elements are non-null pointers. The deque does not grow - trypush
+ * returns 0 if the deque is full, so that the caller may fall back
+ * to some other queue.
+ */
+
+struct work_stealing_deque_t;
+
+work_stealing_deque_t* work_stealing_deque_create( uint32_t power_of_2_size );
+void                   work_stealing_deque_destroy( work_stealing_deque_t* dq );
+size_t                 work_stealing_deque_size( const work_stealing_deque_t* dq );
+int                    work_stealing_deque_trypush( work_stealing_deque_t* dq, void* in ); // owner only
+void*                  work_stealing_deque_trypop( work_stealing_deque_t* dq );            // owner only
+void*                  work_stealing_deque_trysteal( work_stealing_deque_t* dq );          // any thread
+
+#endif
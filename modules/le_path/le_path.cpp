@@ -1,8 +1,14 @@
 #include "le_path.h"
 
 #include "le_log.h"
+#include "le_jobs.h"
+
+#include "private/cubic_bezier_batch.h"
+
+#include "3rdparty/src/spooky/SpookyV2.h"
 
 #include <vector>
+#include <span>
 #include <algorithm>
 
 #include <cstring>
@@ -20,6 +26,9 @@ using stroke_attribute_t = le_path_api::stroke_attribute_t;
 
 static auto logger = le::Log( "le_path" );
 
+static constexpr uint32_t CONTOURS_PER_JOB   = 16;   // batch methods: maximum number of contours which one job processes in one go
+static constexpr uint32_t MAX_CURVE_SEGMENTS = 1000; // flatten_uniform: maximum number of segments per curve, should only ever be reached when tolerance is super small
+
 struct PathCommand {
 
 	enum Type : uint32_t {
@@ -75,10 +84,14 @@ struct PathCommand {
 	}
 };
 
+// A contour is a range of svg-style commands+parameters within le_path_o::commands.
 struct Contour {
-	std::vector<PathCommand> commands; // svg-style commands+parameters creating the path
+	uint32_t commands_offset = 0; // index of first command of this contour
+	uint32_t commands_count  = 0; // number of commands in this contour
 };
 
+// Trace and flatten generate each polyline into a Polyline first, and then
+// copy it into the flat polyline storage of its path, see le_path_commit_polyline.
 struct Polyline {
 	std::vector<glm::vec2> vertices;
 	std::vector<glm::vec2> tangents;
@@ -86,9 +99,51 @@ struct Polyline {
 	float                  total_distance = 0;
 };
 
+// Vertices, tangents, and distances of all polylines of a path, back to back.
+struct PolylineData {
+	std::vector<glm::vec2> vertices;
+	std::vector<glm::vec2> tangents;
+	std::vector<float>     distances; // one per vertex
+};
+
+// A polyline is a range within PolylineData.
+struct PolylineRange {
+	uint32_t vertices_offset = 0; // index of first vertex, and of first distance
+	uint32_t vertices_count  = 0;
+	uint32_t tangents_offset = 0; // index of first tangent
+	uint32_t tangents_count  = 0;
+	float    total_distance  = 0;
+	uint64_t source_hash     = 0; // hash of contour and settings which generated this polyline, 0 if unknown - see contour_hash
+};
+
+// Read-only view onto a polyline - only valid until polyline data of its path changes.
+struct PolylineView {
+	glm::vec2 const* vertices;
+	glm::vec2 const* tangents;
+	float const*     distances;
+	size_t           vertices_count;
+	size_t           tangents_count;
+	float            total_distance;
+};
+
+// Temporaries for the hobby solvers. Arrays are carved out of buffers which
+// each path keeps around, so that solving doesn't need to allocate.
+struct SolverScratch {
+	std::vector<float>     floats;
+	std::vector<glm::vec2> vec2s;
+	size_t                 floats_used = 0;
+	size_t                 vec2s_used  = 0;
+};
+
 struct le_path_o {
-	std::vector<Contour>  contours;  // an array of sub-paths, a contour must start with a moveto instruction
-	std::vector<Polyline> polylines; // an array of polylines, each corresponding to a sub-path.
+	std::vector<PathCommand>   commands;           // commands of all contours, back to back
+	std::vector<Contour>       contours;           // an array of sub-paths, a contour must start with a moveto instruction
+	std::vector<PolylineRange> polylines;          // an array of polylines, each corresponding to a sub-path.
+	std::vector<PolylineRange> polylines_stale;    // polylines from before the last clear - trace and flatten may reuse these if their contours have not changed
+	PolylineData               polyline_data;      // data for polylines, and stale polylines - may contain unused ranges, see le_path_compact_polyline_data
+	PolylineData               polyline_data_back; // scratch: polyline data gets compacted into this, and then swapped
+	Polyline                   polyline_builder;   // scratch: trace and flatten generate polylines into this
+	SolverScratch              solver_scratch;     // scratch: temporaries for hobby
 };
 
 struct CubicBezier {
@@ -138,15 +193,16 @@ struct InflectionData {
 // follow the c/cpp convention.
 //
 // Note: Parameters a, b, c, d are arrays of length `count`. a[0], and c[n]
-// are not used, `result` must be an array of length `count`.
+// are not used, `result` must be an array of length `count`. `scratch` must
+// be an array of length 2 * `count`.
 //
 template <typename T>
-inline static void thomas( T const* a, T const* b, T const* c, T const* d, size_t const count, T* result ) {
+inline static void thomas( T const* a, T const* b, T const* c, T const* d, size_t const count, T* result, T* scratch ) {
 
 	// We copy, so that we don't overwrite given paramter data.
 	//
-	std::vector<T> c_prime( count );
-	std::vector<T> d_prime( count );
+	T* c_prime = scratch;
+	T* d_prime = scratch + count;
 
 	size_t i           = 0;
 	T      denominator = b[ i ];
@@ -171,11 +227,19 @@ inline static void thomas( T const* a, T const* b, T const* c, T const* d, size_
 // top right corner of the "almost tridiagonal" matrix,
 // and that we expect c[count-1] to contain the value from the
 // bottom left corner of the "almost tridiagonal" matrix.
+//
+// `scratch` must be an array of length 7 * `count`.
 template <typename T>
-inline static void sherman_morrisson_woodbury( T const* a, T const* b, T const* c, T const* d, size_t const count, T* result ) {
+inline static void sherman_morrisson_woodbury( T const* a, T const* b, T const* c, T const* d, size_t const count, T* result, T* scratch ) {
 
-	std::vector<T> u( count, 0 );
-	std::vector<T> v( count, 0 );
+	T* u      = scratch;
+	T* v      = scratch + count;
+	T* b_dash = scratch + count * 2;
+	T* Td     = scratch + count * 3;
+	T* Tu     = scratch + count * 4;
+
+	std::fill( u, u + count, T( 0 ) );
+	std::fill( v, v + count, T( 0 ) );
 
 	u[ 0 ]         = 1;
 	u[ count - 1 ] = 1;
@@ -186,16 +250,13 @@ inline static void sherman_morrisson_woodbury( T const* a, T const* b, T const*
 	v[ count - 1 ] = s;
 	v[ 0 ]         = t;
 
-	std::vector<T> b_dash{ b, b + count };
+	std::copy( b, b + count, b_dash );
 
 	b_dash[ 0 ] -= t;
 	b_dash[ count - 1 ] -= s;
 
-	std::vector<T> Td( count );
-	std::vector<T> Tu( count );
-
-	thomas( a, b_dash.data(), c, d, count, Td.data() );
-	thomas( a, b_dash.data(), c, u.data(), count, Tu.data() );
+	thomas( a, b_dash, c, d, count, Td, scratch + count * 5 );
+	thomas( a, b_dash, c, u, count, Tu, scratch + count * 5 );
 
 	const T factor = ( t * Td[ 0 ] +
 	                   s * Td[ count - 1 ] ) /
@@ -258,18 +319,55 @@ static void le_path_destroy( le_path_o* self ) {
 
 // ----------------------------------------------------------------------
 
+// Since all commands, and all polyline data of a path live in a few flat
+// arrays of trivially copyable elements, cloning a path means copying just
+// these arrays - scratch buffers, and stale polylines are not copied.
 static le_path_o* le_path_clone( le_path_o const* old ) {
-	auto self = new le_path_o{ *old };
+	auto self = new le_path_o();
+
+	self->commands      = old->commands;
+	self->contours      = old->contours;
+	self->polylines     = old->polylines;
+	self->polyline_data = old->polyline_data;
+
 	return self;
 }
 
 static void le_path_clear( le_path_o* self ) {
+	self->commands.clear();
 	self->contours.clear();
+	// Keep polylines around: if the path gets rebuilt with some of the same
+	// contours, flatten and trace don't need to generate these again.
+	std::swap( self->polylines, self->polylines_stale );
 	self->polylines.clear();
 }
 
 // ----------------------------------------------------------------------
 
+static inline std::span<PathCommand const> le_path_get_contour_commands( le_path_o const* self, size_t contour_index ) {
+	Contour const& contour = self->contours[ contour_index ];
+	return { self->commands.data() + contour.commands_offset, contour.commands_count };
+}
+
+// ----------------------------------------------------------------------
+// Commands of the last contour - which is the only contour which may grow,
+// and whose commands are therefore always at the end of `commands`.
+static inline std::span<PathCommand> le_path_get_last_contour_commands( le_path_o* self ) {
+	assert( !self->contours.empty() );
+	Contour const& contour = self->contours.back();
+	return { self->commands.data() + contour.commands_offset, contour.commands_count };
+}
+
+// ----------------------------------------------------------------------
+
+static inline void le_path_add_command( le_path_o* self, PathCommand const& command ) {
+	assert( !self->contours.empty() ); // contour must exist
+	self->commands.push_back( command );
+	self->contours.back().commands_count++;
+}
+
+// ----------------------------------------------------------------------
+
 static void trace_move_to( Polyline& polyline, glm::vec2 const& p ) {
 	polyline.distances.emplace_back( 0 );
 	polyline.vertices.emplace_back( p );
@@ -594,67 +692,291 @@ static void trace_arc_to( Polyline&        polyline,
 }
 
 // ----------------------------------------------------------------------
-// Traces the path with all its subpaths into a list of polylines.
-// Each subpath will be translated into one polyline.
-// A polyline is a list of vertices which may be thought of being
-// connected by lines.
-//
-static void le_path_trace_path( le_path_o* self, size_t resolution ) {
+// Traces a single contour into `polyline`, which must be empty.
+static void trace_contour( std::span<PathCommand const> commands, size_t resolution, Polyline& polyline ) {
 
-	self->polylines.clear();
-	self->polylines.reserve( self->contours.size() );
+	for ( auto const& command : commands ) {
+
+		switch ( command.type ) {
+		case PathCommand::eMoveTo:
+			trace_move_to( polyline, command.p );
+			break;
+		case PathCommand::eLineTo:
+			trace_line_to( polyline, command.p );
+			break;
+		case PathCommand::eQuadBezierTo: {
+			auto& bez = command.data.as_quad_bezier;
+			trace_quad_bezier_to( polyline,
+			                      command.p,
+			                      bez.c1,
+			                      resolution );
+		} break;
+		case PathCommand::eCubicBezierTo: {
+			auto& bez = command.data.as_cubic_bezier;
+			trace_cubic_bezier_to( polyline,
+			                       command.p,
+			                       bez.c1,
+			                       bez.c2,
+			                       resolution );
+		} break;
+		case PathCommand::eArcTo: {
+			auto& arc = command.data.as_arc;
+			trace_arc_to( polyline,
+			              command.p,
+			              arc.radii,
+			              arc.phi,
+			              arc.large_arc,
+			              arc.sweep,
+			              resolution );
+		} break;
+		case PathCommand::eClosePath:
+			trace_close_path( polyline );
+			break;
+		case PathCommand::eUnknown:
+			assert( false );
+			break;
+		}
+	}
 
-	for ( auto const& s : self->contours ) {
+	assert( polyline.vertices.size() == polyline.distances.size() );
+}
 
-		Polyline polyline;
+// ----------------------------------------------------------------------
+// Dirty tracking: each polyline remembers a hash of the contour, and of the
+// settings, from which it was generated. Trace and flatten only regenerate
+// polylines whose hash doesn't match anymore - all other polylines are kept
+// as they are.
+
+struct contour_settings_t {
+	enum Method : uint64_t {
+		eTrace = 1,
+		eFlatten,
+		eFlattenUniform,
+	} method;
+	uint64_t parameter; // resolution for trace, bit pattern of tolerance for flatten methods
+};
+
+static inline uint64_t float_bits( float f ) {
+	uint32_t bits;
+	memcpy( &bits, &f, sizeof( bits ) );
+	return bits;
+}
 
-		for ( auto const& command : s.commands ) {
+// ----------------------------------------------------------------------
+// Hash commands of a contour, together with settings. Note that we must only
+// hash those fields of a command which its type uses: unused bytes of
+// PathCommand::data, and any padding, are undefined.
+static uint64_t contour_hash( std::span<PathCommand const> commands, contour_settings_t const& settings ) {
 
-			switch ( command.type ) {
-			case PathCommand::eMoveTo:
-				trace_move_to( polyline, command.p );
-				break;
-			case PathCommand::eLineTo:
-				trace_line_to( polyline, command.p );
-				break;
-			case PathCommand::eQuadBezierTo: {
-				auto& bez = command.data.as_quad_bezier;
-				trace_quad_bezier_to( polyline,
-				                      command.p,
-				                      bez.c1,
-				                      resolution );
-			} break;
-			case PathCommand::eCubicBezierTo: {
-				auto& bez = command.data.as_cubic_bezier;
-				trace_cubic_bezier_to( polyline,
-				                       command.p,
-				                       bez.c1,
-				                       bez.c2,
-				                       resolution );
-			} break;
-			case PathCommand::eArcTo: {
-				auto& arc = command.data.as_arc;
-				trace_arc_to( polyline,
-				              command.p,
-				              arc.radii,
-				              arc.phi,
-				              arc.large_arc,
-				              arc.sweep,
-				              resolution );
-			} break;
-			case PathCommand::eClosePath:
-				trace_close_path( polyline );
-				break;
-			case PathCommand::eUnknown:
-				assert( false );
-				break;
-			}
+	SpookyHash hash;
+	hash.Init( settings.method, settings.parameter );
+
+	for ( auto const& c : commands ) {
+
+		struct {
+			uint32_t type;
+			float    values[ 7 ];
+		} canonical{ c.type, { c.p.x, c.p.y } }; // all other values are zero-initialised
+
+		switch ( c.type ) {
+		case PathCommand::eQuadBezierTo:
+			canonical.values[ 2 ] = c.data.as_quad_bezier.c1.x;
+			canonical.values[ 3 ] = c.data.as_quad_bezier.c1.y;
+			break;
+		case PathCommand::eCubicBezierTo:
+			canonical.values[ 2 ] = c.data.as_cubic_bezier.c1.x;
+			canonical.values[ 3 ] = c.data.as_cubic_bezier.c1.y;
+			canonical.values[ 4 ] = c.data.as_cubic_bezier.c2.x;
+			canonical.values[ 5 ] = c.data.as_cubic_bezier.c2.y;
+			break;
+		case PathCommand::eArcTo:
+			canonical.values[ 2 ] = c.data.as_arc.radii.x;
+			canonical.values[ 3 ] = c.data.as_arc.radii.y;
+			canonical.values[ 4 ] = c.data.as_arc.phi;
+			canonical.values[ 5 ] = c.data.as_arc.large_arc ? 1.f : 0.f;
+			canonical.values[ 6 ] = c.data.as_arc.sweep ? 1.f : 0.f;
+			break;
+		default:
+			break;
 		}
 
-		assert( polyline.vertices.size() == polyline.distances.size() );
+		hash.Update( &canonical, sizeof( canonical ) );
+	}
+
+	uint64_t h1, h2;
+	hash.Final( &h1, &h2 );
+
+	return h1 ? h1 : 1; // 0 is reserved for polylines of unknown origin
+}
+
+// ----------------------------------------------------------------------
+// Empty a polyline, but keep its storage, so that we can generate into it again.
+static void polyline_reset( Polyline& polyline ) {
+	polyline.vertices.clear();
+	polyline.tangents.clear();
+	polyline.distances.clear();
+	polyline.total_distance = 0;
+}
+
+// ----------------------------------------------------------------------
+// Make sure there is one polyline per contour, and find which polylines must
+// be generated again for the given settings. Polylines which are up to date
+// are kept (or taken from polylines_stale), all others are emptied, and their
+// indices appended to `dirty`. Each dirty polyline is tagged with its new
+// hash right away - callers must generate, and commit all dirty polylines.
+static void le_path_prepare_polylines( le_path_o* self, contour_settings_t const& settings, std::vector<size_t>& dirty ) {
+
+	size_t const num_contours = self->contours.size();
+
+	if ( self->polylines.empty() ) {
+		// Stale polylines share polyline data with current polylines - we
+		// may reuse them simply by taking over their ranges.
+		std::swap( self->polylines, self->polylines_stale );
+	}
+
+	self->polylines_stale.clear();
+
+	size_t const num_previous = self->polylines.size();
+
+	self->polylines.resize( num_contours );
+
+	for ( size_t i = 0; i != num_contours; ++i ) {
+
+		uint64_t const hash = contour_hash( le_path_get_contour_commands( self, i ), settings );
+
+		if ( i < num_previous && self->polylines[ i ].source_hash == hash ) {
+			continue;
+		}
+
+		self->polylines[ i ]             = {};
+		self->polylines[ i ].source_hash = hash;
+		dirty.push_back( i );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Append vertices, tangents, and distances for polyline at `polyline_index`
+// to polyline data, and point the polyline at them. Whatever range the
+// polyline pointed at before becomes unused.
+static void le_path_commit_polyline( le_path_o*       self,
+                                     size_t           polyline_index,
+                                     glm::vec2 const* vertices,
+                                     glm::vec2 const* tangents,
+                                     float const*     distances,
+                                     size_t           vertices_count,
+                                     size_t           tangents_count,
+                                     float            total_distance ) {
+
+	PolylineData&  data  = self->polyline_data;
+	PolylineRange& range = self->polylines[ polyline_index ];
+
+	range.vertices_offset = uint32_t( data.vertices.size() );
+	range.vertices_count  = uint32_t( vertices_count );
+	range.tangents_offset = uint32_t( data.tangents.size() );
+	range.tangents_count  = uint32_t( tangents_count );
+	range.total_distance  = total_distance;
+
+	data.vertices.insert( data.vertices.end(), vertices, vertices + vertices_count );
+	data.tangents.insert( data.tangents.end(), tangents, tangents + tangents_count );
+	data.distances.insert( data.distances.end(), distances, distances + vertices_count );
+}
+
+static void le_path_commit_polyline( le_path_o* self, size_t polyline_index, Polyline const& polyline ) {
+	assert( polyline.vertices.size() == polyline.distances.size() );
+	le_path_commit_polyline( self, polyline_index,
+	                         polyline.vertices.data(), polyline.tangents.data(), polyline.distances.data(),
+	                         polyline.vertices.size(), polyline.tangents.size(), polyline.total_distance );
+}
+
+// ----------------------------------------------------------------------
+// Polyline data only ever grows: polylines which get generated again are
+// appended, and leave their previous range unused. Once most of the polyline
+// data is unused, we copy the ranges which are still in use into the back
+// buffer, and swap buffers - both buffers keep their capacity.
+static void le_path_compact_polyline_data( le_path_o* self ) {
+
+	size_t vertices_used = 0;
 
-		self->polylines.emplace_back( polyline );
+	for ( auto const& range : self->polylines ) {
+		vertices_used += range.vertices_count;
 	}
+
+	// Stale polylines may still be reused - but only until the next trace or flatten,
+	// which is when we get here.
+	assert( self->polylines_stale.empty() );
+
+	if ( self->polyline_data.vertices.size() <= 2 * vertices_used ) {
+		return;
+	}
+
+	// ----------| invariant: more than half of all vertices are unused
+
+	PolylineData const& src = self->polyline_data;
+	PolylineData&       dst = self->polyline_data_back;
+
+	dst.vertices.clear();
+	dst.tangents.clear();
+	dst.distances.clear();
+
+	for ( auto& range : self->polylines ) {
+
+		dst.vertices.insert( dst.vertices.end(), src.vertices.begin() + range.vertices_offset, src.vertices.begin() + range.vertices_offset + range.vertices_count );
+		dst.tangents.insert( dst.tangents.end(), src.tangents.begin() + range.tangents_offset, src.tangents.begin() + range.tangents_offset + range.tangents_count );
+		dst.distances.insert( dst.distances.end(), src.distances.begin() + range.vertices_offset, src.distances.begin() + range.vertices_offset + range.vertices_count );
+
+		range.vertices_offset = uint32_t( dst.vertices.size() - range.vertices_count );
+		range.tangents_offset = uint32_t( dst.tangents.size() - range.tangents_count );
+	}
+
+	std::swap( self->polyline_data, self->polyline_data_back );
+}
+
+// ----------------------------------------------------------------------
+
+static inline PolylineView le_path_get_polyline_view( le_path_o const* self, size_t polyline_index ) {
+
+	PolylineData const&  data  = self->polyline_data;
+	PolylineRange const& range = self->polylines[ polyline_index ];
+
+	return {
+	    data.vertices.data() + range.vertices_offset,
+	    data.tangents.data() + range.tangents_offset,
+	    data.distances.data() + range.vertices_offset,
+	    range.vertices_count,
+	    range.tangents_count,
+	    range.total_distance,
+	};
+}
+
+// ----------------------------------------------------------------------
+// Generate all polylines which are not up to date for the given settings,
+// one by one, via `generate( commands, polyline )`.
+template <typename GenerateFn>
+static void le_path_update_polylines( le_path_o* self, contour_settings_t const& settings, GenerateFn&& generate ) {
+
+	std::vector<size_t> dirty;
+	le_path_prepare_polylines( self, settings, dirty );
+
+	for ( size_t i : dirty ) {
+		polyline_reset( self->polyline_builder );
+		generate( le_path_get_contour_commands( self, i ), self->polyline_builder );
+		le_path_commit_polyline( self, i, self->polyline_builder );
+	}
+
+	le_path_compact_polyline_data( self );
+}
+
+// ----------------------------------------------------------------------
+// Traces the path with all its subpaths into a list of polylines.
+// Each subpath will be translated into one polyline.
+// A polyline is a list of vertices which may be thought of being
+// connected by lines.
+//
+static void le_path_trace_path( le_path_o* self, size_t resolution ) {
+	le_path_update_polylines( self, contour_settings_t{ contour_settings_t::eTrace, resolution },
+	                          [ resolution ]( std::span<PathCommand const> commands, Polyline& polyline ) {
+		                          trace_contour( commands, resolution, polyline );
+	                          } );
 }
 
 // Subdivides given cubic bezier curve `b` at position `t`
@@ -702,6 +1024,9 @@ static bool cubic_bezier_calculate_inflection_points( CubicBezier const& b, Infl
 
 	if ( fabsf( divisor ) <= std::numeric_limits<float>::epsilon() ) {
 		// must not be zero, otherwise there are no solutions.
+		infl->t_cusp = -1; // outside 0..1: no cusp
+		infl->t_1    = 0;
+		infl->t_2    = 0;
 		return false;
 	}
 
@@ -802,139 +1127,75 @@ static void split_cubic_bezier_into_monotonous_sub_segments( CubicBezier& b, std
 	calc_inflection_point_offsets( b, tolerance, infl.t_1, &t1_m, &t1_p );
 	calc_inflection_point_offsets( b, tolerance, infl.t_2, &t2_m, &t2_p );
 
-	// It's possible that our bezier curve self-intersects,
-	// in which case inflection points are out of order -
-	// then we must sort them.
-
-	bool curve_has_knot = t2_m <= t1_p || ( t1_p >= t2_m );
-
-	if ( curve_has_knot && ( infl.t_1 >= infl.t_2 ) ) {
-		std::sort( boundaries, boundaries + 4 );
-		std::swap( infl.t_1, infl.t_2 );
-	}
-
-	{
-
-		// ----------| invariant: curve does not have a cusp.
-
-		auto which_region = []( float* boundaries, size_t num_boundaries, float marker ) -> size_t {
-			size_t i = 0;
-			for ( ; i != num_boundaries; i++ ) {
-				if ( boundaries[ i ] > marker ) {
-					return i;
-				}
-			}
-			return i;
-		};
-
-		// Calculate into which of the 5 segments of an infinite cubic bezier
-		// the given start and end points (based on t = 0..1 ) fall:
-		//
-		// ---0--- t1_m ---1--- t1_p ---2--- t2_m ---3--- t2_p ---4---
-		//
-		size_t c_start = which_region( boundaries, 4, 0.f );
-		size_t c_end   = which_region( boundaries, 4, 1.f );
-
-		if ( c_start == c_end ) {
-
-			// Curve contained within a single segment.
-
-			// Note segments 1, and 3 are flat, as such they
-			// are better represented as straight lines.
-
-			if ( c_start == 1 || c_start == 3 ) {
-				CurveSegment line{ Line() };
-				line.asLine.p0 = b.p0;
-				line.asLine.p1 = b.p1;
-				curves.push_back( line );
-			} else {
-				curves.push_back( b );
-			}
-
-		} else {
-
-			// Curve spans multiple segments
-
-			if ( c_start == 0 ) {
-				// curve starts within first segment, but does not end here.
-				// this means the first segment of the curve will be 0..t1m
-				bezier_subdivide( b, t1_m, &b_0, nullptr );
-				curves.push_back( b_0 );
-			}
-
-			if ( c_start == 1 ) {
-				// curve starts between t1_m and t1_p which means that this
-				// segment, the segment before t1_p can be approximated by a
-				// straight line.
-
-				bezier_subdivide( b, t1_p, &b_0, nullptr );
-
-				CurveSegment line{ Line() };
-				line.asLine.p0 = b_0.p0;
-				line.asLine.p1 = b_0.p1;
-
-				curves.push_back( line );
-			}
-
-			if ( c_end == 1 ) {
-				// curve ends within the 1st segment, but does not start here.
-				// this means that from t1m to end the curve can be approximated
-				// by a straight line.
+	// Bring boundaries into ascending order: inflection points may come in
+	// either order, and offsets around an inflection point which lies beyond
+	// t = 1 are reversed. It's also possible that our bezier curve
+	// self-intersects, in which case flat regions around both inflection
+	// points overlap.
 
-				bezier_subdivide( b, t1_m, nullptr, &b_0 );
+	std::sort( boundaries, boundaries + 4 );
 
-				CurveSegment line{ Line() };
-				line.asLine.p0 = b_0.p0;
-				line.asLine.p1 = b_0.p1;
-
-				curves.push_back( line );
+	auto which_region = []( float* boundaries, size_t num_boundaries, float marker ) -> size_t {
+		size_t i = 0;
+		for ( ; i != num_boundaries; i++ ) {
+			if ( boundaries[ i ] > marker ) {
+				return i;
 			}
+		}
+		return i;
+	};
 
-			if ( c_end == 2 ) {
-				// curve ends within the 2nd segment, but does not start here.
-				// this means that the next segment of the curve will be limited
-				// by t1_p .. 1
-				bezier_subdivide( b, t1_p, nullptr, &b_0 );
-				curves.push_back( b_0 );
-			}
+	// Calculate into which of the 5 segments of an infinite cubic bezier
+	// the given start and end points (based on t = 0..1 ) fall:
+	//
+	// ---0--- t1_m ---1--- t1_p ---2--- t2_m ---3--- t2_p ---4---
+	//
+	size_t c_start = which_region( boundaries, 4, 0.f );
+	size_t c_end   = which_region( boundaries, 4, 1.f );
 
-			if ( c_start < 2 && c_end > 2 ) {
-				// curve goes over segment 2, we need to get segment t1_p .. t2..m
-				bezier_subdivide( b, t1_p, nullptr, &b_1 );  // part t1_p .. 1
-				float t3 = map( t2_m, t1_p, 1.f, 0.f, 1.f ); // t2_m expressed in t1_p .. 1 space
-				bezier_subdivide( b_1, t3, &b_0, nullptr );  // part t1_p .. t2_m
-				curves.push_back( b_0 );
-			}
+	// Emit one sub-segment for each segment which the curve passes through.
+	// Note segments 1, and 3 are flat, as such they are better represented
+	// as straight lines.
+	//
+	// Sub-segments share their end points exactly, so that they join up
+	// without any gaps.
 
-			if ( c_start == 2 ) {
-				bezier_subdivide( b, t2_m, &b_0, nullptr );
-				curves.push_back( b_0 );
-			}
+	float     t_lo = 0;
+	glm::vec2 p_lo = b.p0;
 
-			if ( c_start == 3 ) {
-				bezier_subdivide( b, t2_p, &b_0, nullptr );
+	for ( size_t i = c_start; i <= c_end; i++ ) {
 
-				CurveSegment line{ Line() };
-				line.asLine.p0 = b.p0;
-				line.asLine.p1 = b_0.p1;
+		float const t_hi = ( i == c_end ) ? 1.f : boundaries[ i ];
 
-				curves.push_back( line );
-			}
+		if ( t_hi <= t_lo ) {
+			continue; // empty segment
+		}
 
-			if ( c_end == 3 ) {
-				bezier_subdivide( b, t2_m, nullptr, &b_0 );
-				CurveSegment line{ Line() };
-				line.asLine.p0 = b_0.p0;
-				line.asLine.p1 = b_0.p1;
+		// Part 0 .. t_hi
+		CubicBezier b_sub = b;
+		if ( t_hi < 1.f ) {
+			bezier_subdivide( b, t_hi, &b_sub, nullptr );
+		}
 
-				curves.push_back( line );
-			}
+		glm::vec2 const p_hi = ( i == c_end ) ? b.p1 : b_sub.p1;
 
-			if ( c_end == 4 ) {
-				bezier_subdivide( b, t2_p, nullptr, &b_0 );
-				curves.push_back( b_0 );
+		if ( i == 1 || i == 3 ) {
+			CurveSegment line{ Line() };
+			line.asLine.p0 = p_lo;
+			line.asLine.p1 = p_hi;
+			curves.push_back( line );
+		} else {
+			// Part t_lo .. t_hi
+			if ( t_lo > 0.f ) {
+				bezier_subdivide( b_sub, t_lo / t_hi, nullptr, &b_sub );
 			}
+			b_sub.p0 = p_lo;
+			b_sub.p1 = p_hi;
+			curves.push_back( b_sub );
 		}
+
+		t_lo = t_hi;
+		p_lo = p_hi;
 	}
 }
 
@@ -1209,65 +1470,209 @@ static void flatten_arc_to( Polyline&        polyline,
 }
 
 // ----------------------------------------------------------------------
+// Flattens a single contour into `polyline`, which must be empty.
+static void flatten_contour( std::span<PathCommand const> commands, float tolerance, Polyline& polyline ) {
 
-static void le_path_flatten_path( le_path_o* self, float tolerance ) {
+	glm::vec2 prev_point = {};
 
-	self->polylines.clear();
-	self->polylines.reserve( self->contours.size() );
+	for ( auto const& command : commands ) {
 
-	for ( auto const& s : self->contours ) {
+		switch ( command.type ) {
+		case PathCommand::eMoveTo:
+			trace_move_to( polyline, command.p );
+			prev_point = command.p;
+			break;
+		case PathCommand::eLineTo:
+			trace_line_to( polyline, command.p );
+			prev_point = command.p;
+			break;
+		case PathCommand::eQuadBezierTo: {
+			auto& bez = command.data.as_quad_bezier;
+			flatten_cubic_bezier_to( polyline,
+			                         command.p,
+			                         prev_point + 2 / 3.f * ( bez.c1 - prev_point ),
+			                         command.p + 2 / 3.f * ( bez.c1 - command.p ),
+			                         tolerance );
+			prev_point = command.p;
+		} break;
+		case PathCommand::eCubicBezierTo: {
+			auto& bez = command.data.as_cubic_bezier;
+			flatten_cubic_bezier_to( polyline,
+			                         command.p,
+			                         bez.c1,
+			                         bez.c2,
+			                         tolerance );
+			prev_point = command.p;
+		} break;
+		case PathCommand::eArcTo: {
+			auto& arc = command.data.as_arc;
+			flatten_arc_to( polyline, command.p, arc.radii, arc.phi, arc.large_arc, arc.sweep, tolerance );
+			prev_point = command.p;
+		} break;
+		case PathCommand::eClosePath:
+			trace_close_path( polyline );
+			break;
+		case PathCommand::eUnknown:
+			assert( false );
+			break;
+		}
+	}
 
-		Polyline polyline;
+	assert( polyline.vertices.size() == polyline.distances.size() );
+}
+
+// ----------------------------------------------------------------------
+// Append curve `index` from `curves`, split into `n` equally spaced segments.
+static void flatten_uniform_curve_to( Polyline& polyline, cubic_bezier_batch_t const& curves, size_t index, uint32_t n ) {
+
+	assert( !polyline.vertices.empty() ); // Contour vertices must not be empty.
 
+	if ( n == 1 ) {
+		trace_line_to( polyline, { curves.p1_x[ index ], curves.p1_y[ index ] } );
+		return;
+	}
+
+	static_assert( sizeof( glm::vec2 ) == 2 * sizeof( float ), "vertices must be tightly packed pairs of floats" );
+
+	size_t const first_vertex  = polyline.vertices.size();
+	size_t const first_tangent = polyline.tangents.size();
+
+	polyline.vertices.resize( first_vertex + n );
+	polyline.tangents.resize( first_tangent + n );
+
+	cubic_bezier_batch_evaluate_uniform( &curves, index, n, &polyline.vertices[ first_vertex ].x, &polyline.tangents[ first_tangent ].x );
+
+	polyline.distances.reserve( polyline.distances.size() + n );
+
+	for ( size_t i = first_vertex; i != first_vertex + n; ++i ) {
+		polyline.total_distance += glm::distance( polyline.vertices[ i ], polyline.vertices[ i - 1 ] );
+		polyline.distances.emplace_back( polyline.total_distance );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Flattens a single contour into `polyline`, which must be empty - just like
+// flatten_contour, but each curve is split into equally spaced segments, just
+// as many as needed to stay within tolerance. We gather all curves of the
+// contour first, so that segment counts for all curves can be calculated in
+// one batch, see cubic_bezier_batch.h.
+//
+// Arcs are flattened just like in flatten_contour.
+static void flatten_contour_uniform( std::span<PathCommand const> commands, float tolerance, Polyline& polyline ) {
+
+	size_t num_curves = 0;
+
+	for ( auto const& command : commands ) {
+		if ( command.type == PathCommand::eQuadBezierTo || command.type == PathCommand::eCubicBezierTo ) {
+			num_curves++;
+		}
+	}
+
+	// Control points of all curves, in structure-of-arrays layout: all p0.x, then all p0.y, ...
+	std::vector<float>    curve_data( 8 * num_curves );
+	std::vector<uint32_t> segment_counts( num_curves );
+
+	float* soa[ 8 ];
+
+	for ( size_t j = 0; j != 8; ++j ) {
+		soa[ j ] = curve_data.data() + j * num_curves;
+	}
+
+	cubic_bezier_batch_t const curves{ soa[ 0 ], soa[ 1 ], soa[ 2 ], soa[ 3 ], soa[ 4 ], soa[ 5 ], soa[ 6 ], soa[ 7 ] };
+
+	{
+		size_t    i          = 0;
 		glm::vec2 prev_point = {};
 
-		for ( auto const& command : s.commands ) {
+		for ( auto const& command : commands ) {
 
-			switch ( command.type ) {
-			case PathCommand::eMoveTo:
-				trace_move_to( polyline, command.p );
-				prev_point = command.p;
-				break;
-			case PathCommand::eLineTo:
-				trace_line_to( polyline, command.p );
-				prev_point = command.p;
-				break;
-			case PathCommand::eQuadBezierTo: {
-				auto& bez = command.data.as_quad_bezier;
-				flatten_cubic_bezier_to( polyline,
-				                         command.p,
-				                         prev_point + 2 / 3.f * ( bez.c1 - prev_point ),
-				                         command.p + 2 / 3.f * ( bez.c1 - command.p ),
-				                         tolerance );
-				prev_point = command.p;
-			} break;
-			case PathCommand::eCubicBezierTo: {
-				auto& bez = command.data.as_cubic_bezier;
-				flatten_cubic_bezier_to( polyline,
-				                         command.p,
-				                         bez.c1,
-				                         bez.c2,
-				                         tolerance );
-				prev_point = command.p;
-			} break;
-			case PathCommand::eArcTo: {
-				auto& arc = command.data.as_arc;
-				flatten_arc_to( polyline, command.p, arc.radii, arc.phi, arc.large_arc, arc.sweep, tolerance );
-				prev_point = command.p;
-			} break;
-			case PathCommand::eClosePath:
-				trace_close_path( polyline );
-				break;
-			case PathCommand::eUnknown:
-				assert( false );
-				break;
+			glm::vec2 c1;
+			glm::vec2 c2;
+
+			if ( command.type == PathCommand::eQuadBezierTo ) {
+				// Elevate quadratic to cubic bezier - this is exact.
+				auto const& bez = command.data.as_quad_bezier;
+				c1              = prev_point + 2 / 3.f * ( bez.c1 - prev_point );
+				c2              = command.p + 2 / 3.f * ( bez.c1 - command.p );
+			} else if ( command.type == PathCommand::eCubicBezierTo ) {
+				c1 = command.data.as_cubic_bezier.c1;
+				c2 = command.data.as_cubic_bezier.c2;
+			} else {
+				if ( command.type != PathCommand::eClosePath ) {
+					prev_point = command.p;
+				}
+				continue;
+			}
+
+			glm::vec2 const points[ 4 ] = { prev_point, c1, c2, command.p };
+
+			for ( size_t j = 0; j != 8; ++j ) {
+				soa[ j ][ i ] = points[ j / 2 ][ j % 2 ];
 			}
+
+			prev_point = command.p;
+			i++;
 		}
+	}
+
+	cubic_bezier_batch_segment_counts( &curves, num_curves, tolerance, MAX_CURVE_SEGMENTS, segment_counts.data() );
 
-		assert( polyline.vertices.size() == polyline.distances.size() );
+	size_t i = 0;
 
-		self->polylines.emplace_back( polyline );
+	for ( auto const& command : commands ) {
+
+		switch ( command.type ) {
+		case PathCommand::eMoveTo:
+			trace_move_to( polyline, command.p );
+			break;
+		case PathCommand::eLineTo:
+			trace_line_to( polyline, command.p );
+			break;
+		case PathCommand::eQuadBezierTo: // fall-through: all curves are cubic curves by now
+		case PathCommand::eCubicBezierTo:
+			flatten_uniform_curve_to( polyline, curves, i, segment_counts[ i ] );
+			i++;
+			break;
+		case PathCommand::eArcTo: {
+			auto& arc = command.data.as_arc;
+			flatten_arc_to( polyline, command.p, arc.radii, arc.phi, arc.large_arc, arc.sweep, tolerance );
+		} break;
+		case PathCommand::eClosePath:
+			trace_close_path( polyline );
+			break;
+		case PathCommand::eUnknown:
+			assert( false );
+			break;
+		}
 	}
+
+	assert( polyline.vertices.size() == polyline.distances.size() );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_path_flatten_path( le_path_o* self, float tolerance ) {
+
+	le_path_update_polylines( self, contour_settings_t{ contour_settings_t::eFlatten, float_bits( tolerance ) },
+	                          [ tolerance ]( std::span<PathCommand const> commands, Polyline& polyline ) {
+		                          flatten_contour( commands, tolerance, polyline );
+	                          } );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_path_flatten_path_uniform( le_path_o* self, float tolerance ) {
+
+	le_path_update_polylines( self, contour_settings_t{ contour_settings_t::eFlattenUniform, float_bits( tolerance ) },
+	                          [ tolerance ]( std::span<PathCommand const> commands, Polyline& polyline ) {
+		                          flatten_contour_uniform( commands, tolerance, polyline );
+	                          } );
+}
+
+// ----------------------------------------------------------------------
+
+static uint32_t le_path_get_flatten_uniform_lane_count() {
+	return cubic_bezier_batch_lane_count();
 }
 
 // ----------------------------------------------------------------------
@@ -1582,8 +1987,7 @@ static bool le_path_generate_offset_outline_for_contour(
 	glm::vec2 prev_point  = {};
 	float     line_offset = line_weight * 0.5f;
 
-	auto& s = self->contours[ contour_index ];
-	for ( auto const& command : s.commands ) {
+	for ( auto const& command : le_path_get_contour_commands( self, contour_index ) ) {
 
 		switch ( command.type ) {
 		case PathCommand::eMoveTo:
@@ -1855,11 +2259,11 @@ static void draw_cap_square( std::vector<glm::vec2>& triangles, glm::vec2 const&
 // update cmd_prev, cmd, cmd_next
 // Returns false if no next element.
 // TODO: Skip duplicates
-static bool path_command_iterator( std::vector<PathCommand> const& cmds,
-                                   PathCommand const**             cmd_prev,
-                                   PathCommand const**             cmd,
-                                   PathCommand const**             cmd_next,
-                                   bool*                           wasClosed ) {
+static bool path_command_iterator( std::span<PathCommand const> cmds,
+                                   PathCommand const**          cmd_prev,
+                                   PathCommand const**          cmd,
+                                   PathCommand const**          cmd_next,
+                                   bool*                        wasClosed ) {
 	auto cmds_start = cmds.data();
 	auto cmds_end   = cmds.data() + cmds.size();
 
@@ -1888,12 +2292,10 @@ static bool path_command_iterator( std::vector<PathCommand> const& cmds,
 
 	*cmd_next = ( *cmd ) + 1;
 
-	if ( ( *cmd_next )->type == PathCommand::eClosePath ) {
-		*cmd_next = cmds_start;
-	}
-
 	if ( *cmd_next == cmds_end ) {
-		*cmd_next = nullptr;
+		*cmd_next = nullptr; // we must not look past the last command
+	} else if ( ( *cmd_next )->type == PathCommand::eClosePath ) {
+		*cmd_next = cmds_start;
 	}
 
 	return true;
@@ -1902,7 +2304,7 @@ static bool path_command_iterator( std::vector<PathCommand> const& cmds,
 // ----------------------------------------------------------------------
 // Calculate tangent at path end point
 // Note: does not return anything of value if pathcommand is not endpoint.
-static bool get_path_endpoint_tangents( std::vector<PathCommand> const& commands, glm::vec2& tangent_tail, glm::vec2& tangent_head ) {
+static bool get_path_endpoint_tangents( std::span<PathCommand const> commands, glm::vec2& tangent_tail, glm::vec2& tangent_head ) {
 	auto cmds_start = commands.data();
 	auto cmds_end   = cmds_start + commands.size();
 
@@ -2010,16 +2412,11 @@ void tessellate_outline_l_r( std::vector<glm::vec2>& triangles, std::vector<glm:
 
 // ----------------------------------------------------------------------
 
-bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le_path_api::stroke_attribute_t const* stroke_attributes, glm::vec2* vertices, size_t* num_vertices ) {
-	std::vector<glm::vec2> triangles;
-
-	triangles.reserve( *num_vertices );
-
-	auto& contour = self->contours[ contour_index ];
+// Tessellates a single contour into triangles, which are appended to `triangles`.
+static void tessellate_thick_contour_to( std::vector<glm::vec2>& triangles, std::span<PathCommand const> commands, stroke_attribute_t const* stroke_attributes ) {
 
-	if ( contour.commands.empty() ) {
-		*num_vertices = 0;
-		return true;
+	if ( commands.empty() ) {
+		return;
 	}
 
 	// ---------| Invariant: There are commands to render
@@ -2034,7 +2431,7 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 
 	glm::vec2 tangent{};
 
-	while ( path_command_iterator( contour.commands, &command_prev, &command, &command_next, &wasClosed ) ) {
+	while ( path_command_iterator( commands, &command_prev, &command, &command_next, &wasClosed ) ) {
 
 		switch ( command->type ) {
 
@@ -2095,9 +2492,9 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 		}
 		case PathCommand::eClosePath: {
 
-			generate_offset_outline_line_to( vertices_l, vertices_r, command_prev->p, contour.commands.front().p, stroke_attributes->width );
+			generate_offset_outline_line_to( vertices_l, vertices_r, command_prev->p, commands.front().p, stroke_attributes->width );
 
-			tangent = contour.commands.front().p - command_prev->p;
+			tangent = commands.front().p - command_prev->p;
 
 			break;
 		}
@@ -2130,7 +2527,7 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 			tangent /= tangent_length;
 
 			tessellate_joint( triangles, stroke_attributes, tangent,
-			                  ( command->type == PathCommand::eClosePath ) ? &contour.commands.front()
+			                  ( command->type == PathCommand::eClosePath ) ? &commands.front()
 			                                                               : command,
 			                  command_next );
 		}
@@ -2139,23 +2536,23 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 
 	// -- Draw caps if path was not closed
 
-	if ( !wasClosed && !contour.commands.empty() &&
+	if ( !wasClosed && !commands.empty() &&
 	     stroke_attributes->line_cap_type != stroke_attribute_t::LineCapType::eLineCapButt ) {
 
-		if ( contour.commands.size() == 1 ) {
+		if ( commands.size() == 1 ) {
 			// path has zero length
 			// draw ending on first point
 		} else {
 
 			// we must find out tangent into the path
 
-			PathCommand* tail = &contour.commands.front();
-			PathCommand* head = &contour.commands.back();
+			PathCommand const* tail = &commands.front();
+			PathCommand const* head = &commands.back();
 
 			glm::vec2 tangent_head{};
 			glm::vec2 tangent_tail{};
 
-			get_path_endpoint_tangents( contour.commands, tangent_tail, tangent_head );
+			get_path_endpoint_tangents( commands, tangent_tail, tangent_head );
 
 			if ( stroke_attributes->line_cap_type == stroke_attribute_t::LineCapType::eLineCapRound ) {
 				draw_cap_round( triangles, head->p, { -tangent_head.y, tangent_head.x }, stroke_attributes );
@@ -2167,7 +2564,23 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 		}
 	}
 
-	//
+}
+
+// ----------------------------------------------------------------------
+
+bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le_path_api::stroke_attribute_t const* stroke_attributes, glm::vec2* vertices, size_t* num_vertices ) {
+	std::vector<glm::vec2> triangles;
+
+	triangles.reserve( *num_vertices );
+
+	auto const commands = le_path_get_contour_commands( self, contour_index );
+
+	if ( commands.empty() ) {
+		*num_vertices = 0;
+		return true;
+	}
+
+	tessellate_thick_contour_to( triangles, commands, stroke_attributes );
 
 	bool success = true;
 
@@ -2183,15 +2596,186 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 	return success;
 }
 
+// ----------------------------------------------------------------------
+// Batch processing: contours are independent of each other, which is why we
+// can flatten, trace, or tessellate them concurrently on le_jobs. Each job
+// writes only to the output slots of its own contours, and every contour is
+// processed by exactly the same code as in the serial methods above - results
+// are therefore bit-identical, no matter how contours are distributed over
+// workers.
+
+struct contour_ref_t {
+	le_path_o* path;
+	uint32_t   contour_index;
+};
+
+// Polylines which one job generates for a run of up to CONTOURS_PER_JOB
+// contours. Polylines are stored back to back, so that jobs allocate once per
+// run of contours, and not once per contour.
+struct polyline_batch_t {
+	PolylineData               data;
+	std::vector<PolylineRange> ranges; // one per contour, ranges within `data`
+};
+
+// Collect all contours of all given paths whose polylines must be generated
+// again for given settings, in order - see le_path_prepare_polylines.
+static void le_path_collect_dirty_contours( le_path_o** paths, size_t num_paths, contour_settings_t const& settings, std::vector<contour_ref_t>& refs ) {
+
+	std::vector<size_t> dirty;
+
+	for ( size_t i = 0; i != num_paths; ++i ) {
+		le_path_o* path = paths[ i ];
+
+		dirty.clear();
+		le_path_prepare_polylines( path, settings, dirty );
+
+		for ( size_t c : dirty ) {
+			refs.push_back( { path, uint32_t( c ) } );
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Batch version of le_path_update_polylines: jobs generate polylines for runs
+// of contours into their own polyline batch, and once all jobs are complete,
+// we copy polylines from batches into the polyline data of their paths.
+template <typename GenerateFn>
+static void le_path_update_polylines_batch( le_path_o** paths, size_t num_paths, contour_settings_t const& settings, GenerateFn&& generate ) {
+
+	std::vector<contour_ref_t> refs;
+	le_path_collect_dirty_contours( paths, num_paths, settings, refs );
+
+	uint32_t const                num_batches = uint32_t( ( refs.size() + CONTOURS_PER_JOB - 1 ) / CONTOURS_PER_JOB );
+	std::vector<polyline_batch_t> batches( num_batches );
+
+	le_jobs::parallel_for( 0, num_batches, 1, [ & ]( uint32_t begin, uint32_t end ) {
+		Polyline polyline;
+
+		for ( uint32_t b = begin; b != end; ++b ) {
+			polyline_batch_t& batch = batches[ b ];
+			size_t const      first = size_t( b ) * CONTOURS_PER_JOB;
+			size_t const      last  = std::min( first + CONTOURS_PER_JOB, refs.size() );
+
+			batch.ranges.reserve( last - first );
+
+			for ( size_t i = first; i != last; ++i ) {
+				polyline_reset( polyline );
+				generate( le_path_get_contour_commands( refs[ i ].path, refs[ i ].contour_index ), polyline );
+
+				PolylineRange range;
+				range.vertices_offset = uint32_t( batch.data.vertices.size() );
+				range.vertices_count  = uint32_t( polyline.vertices.size() );
+				range.tangents_offset = uint32_t( batch.data.tangents.size() );
+				range.tangents_count  = uint32_t( polyline.tangents.size() );
+				range.total_distance  = polyline.total_distance;
+				batch.ranges.push_back( range );
+
+				batch.data.vertices.insert( batch.data.vertices.end(), polyline.vertices.begin(), polyline.vertices.end() );
+				batch.data.tangents.insert( batch.data.tangents.end(), polyline.tangents.begin(), polyline.tangents.end() );
+				batch.data.distances.insert( batch.data.distances.end(), polyline.distances.begin(), polyline.distances.end() );
+			}
+		}
+	} );
+
+	for ( size_t i = 0; i != refs.size(); ++i ) {
+		polyline_batch_t const& batch = batches[ i / CONTOURS_PER_JOB ];
+		PolylineRange const&    range = batch.ranges[ i % CONTOURS_PER_JOB ];
+
+		le_path_commit_polyline( refs[ i ].path, refs[ i ].contour_index,
+		                         batch.data.vertices.data() + range.vertices_offset,
+		                         batch.data.tangents.data() + range.tangents_offset,
+		                         batch.data.distances.data() + range.vertices_offset,
+		                         range.vertices_count, range.tangents_count, range.total_distance );
+	}
+
+	for ( size_t i = 0; i != num_paths; ++i ) {
+		le_path_compact_polyline_data( paths[ i ] );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Flatten many paths at once - same as calling flatten on each path, but
+// contours of all paths are flattened concurrently, using le_jobs.
+static void le_path_flatten_paths( le_path_o** paths, size_t num_paths, float tolerance ) {
+	le_path_update_polylines_batch( paths, num_paths, contour_settings_t{ contour_settings_t::eFlatten, float_bits( tolerance ) },
+	                                [ tolerance ]( std::span<PathCommand const> commands, Polyline& polyline ) {
+		                                flatten_contour( commands, tolerance, polyline );
+	                                } );
+}
+
+// ----------------------------------------------------------------------
+// Trace many paths at once - same as calling trace on each path, but
+// contours of all paths are traced concurrently, using le_jobs.
+static void le_path_trace_paths( le_path_o** paths, size_t num_paths, size_t resolution ) {
+	le_path_update_polylines_batch( paths, num_paths, contour_settings_t{ contour_settings_t::eTrace, resolution },
+	                                [ resolution ]( std::span<PathCommand const> commands, Polyline& polyline ) {
+		                                trace_contour( commands, resolution, polyline );
+	                                } );
+}
+
+// ----------------------------------------------------------------------
+// Tessellate all contours of a path concurrently, using le_jobs. Triangles
+// for each contour are written to `vertices` in contour order, so that the
+// result is the same as calling tessellate_thick_contour for each contour in
+// turn, and appending results.
+//
+// Each contour is tessellated into its own buffer first - only once we know
+// how many vertices each contour needs can we tell where in `vertices` its
+// triangles must go.
+static bool le_path_tessellate_thick_contours( le_path_o* self, le_path_api::stroke_attribute_t const* stroke_attributes, glm::vec2* vertices, size_t* num_vertices, size_t* contour_offsets ) {
+
+	size_t const num_contours = self->contours.size();
+
+	std::vector<std::vector<glm::vec2>> triangles( num_contours );
+
+	le_jobs::parallel_for( 0, uint32_t( num_contours ), CONTOURS_PER_JOB, [ & ]( uint32_t begin, uint32_t end ) {
+		for ( uint32_t i = begin; i != end; ++i ) {
+			tessellate_thick_contour_to( triangles[ i ], le_path_get_contour_commands( self, i ), stroke_attributes );
+		}
+	} );
+
+	size_t total = 0;
+
+	for ( size_t i = 0; i != num_contours; ++i ) {
+		if ( contour_offsets ) {
+			contour_offsets[ i ] = total;
+		}
+		total += triangles[ i ].size();
+	}
+
+	if ( contour_offsets ) {
+		contour_offsets[ num_contours ] = total;
+	}
+
+	bool success = true;
+
+	if ( total == 0 ) {
+		// Nothing to copy.
+	} else if ( vertices && total <= *num_vertices ) {
+		glm::vec2* v = vertices;
+		for ( auto const& t : triangles ) {
+			memcpy( v, t.data(), sizeof( glm::vec2 ) * t.size() );
+			v += t.size();
+		}
+	} else {
+		success = false;
+	}
+
+	// update outline counts with actual number of generated vertices.
+	*num_vertices = total;
+
+	return success;
+}
+
 // ----------------------------------------------------------------------
 
 static void le_path_iterate_vertices_for_contour( le_path_o* self, size_t const& contour_index, le_path_api::contour_vertex_cb callback, void* user_data ) {
 
 	assert( self->contours.size() > contour_index );
 
-	auto const& s = self->contours[ contour_index ];
+	auto const s = le_path_get_contour_commands( self, contour_index );
 
-	for ( auto const& command : s.commands ) {
+	for ( auto const& command : s ) {
 
 		switch ( command.type ) {
 		case PathCommand::eMoveTo:        // fall-through, as we're allways just issueing the vertex, ignoring control points
@@ -2202,7 +2786,7 @@ static void le_path_iterate_vertices_for_contour( le_path_o* self, size_t const&
 			callback( user_data, command.p );
 			break;
 		case PathCommand::eClosePath:
-			callback( user_data, s.commands[ 0 ].p ); // re-issue first vertex
+			callback( user_data, s[ 0 ].p ); // re-issue first vertex
 			break;
 		case PathCommand::eUnknown:
 			assert( false );
@@ -2217,11 +2801,9 @@ static void le_path_iterate_quad_beziers_for_contour( le_path_o* self, size_t co
 
 	assert( self->contours.size() > contour_index );
 
-	auto const& s = self->contours[ contour_index ];
-
 	glm::vec2 p0 = {};
 
-	for ( auto const& command : s.commands ) {
+	for ( auto const& command : le_path_get_contour_commands( self, contour_index ) ) {
 
 		switch ( command.type ) {
 		case PathCommand::eMoveTo:
@@ -2250,28 +2832,62 @@ static void le_path_iterate_quad_beziers_for_contour( le_path_o* self, size_t co
 }
 
 // ----------------------------------------------------------------------
-// Updates `result` to the vertex position on polyline
-// at normalized position `t`
-static void le_polyline_get_at( Polyline const& polyline, float t, glm::vec2* result ) {
+// Returns index `b` of the vertex which ends the polyline segment at distance `d`:
+// the first vertex in ]0, n-1[ whose distance is larger than `d`, or n-1.
+//
+// `cursor` is the result of a previous lookup on the same polyline, or 1. If `d`
+// lies beyond the segment before `cursor`, we gallop forward from `cursor`,
+// which, for positions which increase from one lookup to the next, costs O(1)
+// per lookup on average. Otherwise, we binary search all distances. Either way,
+// a lookup costs at most O(log n).
+static inline size_t polyline_find_segment_end( PolylineView const& polyline, float d, size_t cursor ) {
 
-	// -- Calculate unnormalised distance
-	float d = t * float( polyline.total_distance );
+	float const* distances = polyline.distances;
+	size_t const end       = polyline.vertices_count - 1;
 
-	// find the first element in polyline which has a position larger than pos
+	assert( cursor >= 1 && cursor <= end );
 
-	size_t       a = 0, b = 1;
-	size_t const n = polyline.distances.size();
+	if ( !( distances[ cursor - 1 ] <= d ) ) {
+		return size_t( std::upper_bound( distances + 1, distances + end, d ) - distances );
+	}
 
-	assert( n >= 2 ); // we must have at least two elements for this to work.
+	// ----------| invariant: all distances before `cursor` are <= d, result is >= cursor
 
-	for ( ; b < n - 1; ++a, ++b ) {
-		if ( polyline.distances[ b ] > d ) {
-			// find the second distance which is larger than our test distance
-			break;
-		}
+	size_t lo   = cursor;
+	size_t step = 1;
+
+	while ( lo + step < end && distances[ lo + step ] <= d ) {
+		lo += step;
+		step *= 2;
+	}
+
+	return size_t( std::upper_bound( distances + lo, distances + std::min( lo + step, end ), d ) - distances );
+}
+
+// ----------------------------------------------------------------------
+// Tangent at vertex `i` of a polyline: tangents are stored for every vertex but
+// the first one - for the first vertex, we use the tangent of the first segment.
+static inline glm::vec2 polyline_tangent_at_vertex( PolylineView const& polyline, size_t i ) {
+	if ( polyline.tangents_count == 0 ) {
+		return glm::vec2( 0 );
 	}
+	return polyline.tangents[ std::min( std::max( i, size_t( 1 ) ) - 1, polyline.tangents_count - 1 ) ];
+}
+
+// ----------------------------------------------------------------------
+// Samples polyline at normalized position `t`: updates `vertex`, and, unless
+// nullptr, `tangent`, which gets interpolated between the tangents at both
+// ends of the segment which holds `t`. `cursor` must be 1, or the cursor from
+// a previous call on the same polyline - see polyline_find_segment_end.
+static inline void le_polyline_sample( PolylineView const& polyline, float t, size_t* cursor, glm::vec2* vertex, glm::vec2* tangent ) {
 
-	assert( b < n ); // b must not overshoot.
+	assert( polyline.vertices_count >= 2 ); // we must have at least two elements for this to work.
+
+	// -- Calculate unnormalised distance
+	float d = t * float( polyline.total_distance );
+
+	size_t const b = *cursor = polyline_find_segment_end( polyline, d, *cursor );
+	size_t const a = b - 1;
 
 	float dist_start = polyline.distances[ a ];
 	float dist_end   = polyline.distances[ b ];
@@ -2281,20 +2897,57 @@ static void le_polyline_get_at( Polyline const& polyline, float t, glm::vec2* re
 	glm::vec2 const& start_vertex = polyline.vertices[ a ];
 	glm::vec2 const& end_vertex   = polyline.vertices[ b ];
 
-	*result = start_vertex + scalar * ( end_vertex - start_vertex );
+	*vertex = start_vertex + scalar * ( end_vertex - start_vertex );
+
+	if ( tangent ) {
+		glm::vec2 const start_tangent = polyline_tangent_at_vertex( polyline, a );
+		glm::vec2 const end_tangent   = polyline_tangent_at_vertex( polyline, b );
+
+		*tangent = start_tangent + scalar * ( end_tangent - start_tangent );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Updates `result` to the vertex position on polyline
+// at normalized position `t`
+static void le_polyline_get_at( PolylineView const& polyline, float t, glm::vec2* result ) {
+	size_t cursor = 1;
+	le_polyline_sample( polyline, t, &cursor, result, nullptr );
 }
 
 // ----------------------------------------------------------------------
 // return calculated position on polyline
 static void le_path_get_polyline_at_pos_interpolated( le_path_o* self, size_t const& polyline_index, float t, glm::vec2* result ) {
 	assert( polyline_index < self->polylines.size() );
-	le_polyline_get_at( self->polylines[ polyline_index ], t, result );
+	le_polyline_get_at( le_path_get_polyline_view( self, polyline_index ), t, result );
 }
 
 // ----------------------------------------------------------------------
+// Samples polyline at `count` normalized positions `t`, writing positions into
+// `vertices`, and, unless nullptr, interpolated tangents into `tangents`.
+static void le_path_sample_polyline_at_positions( le_path_o* self, size_t const& polyline_index, float const* t, size_t count, glm::vec2* vertices, glm::vec2* tangents ) {
+	assert( polyline_index < self->polylines.size() );
 
-static void le_polyline_resample( Polyline& polyline, float interval ) {
-	Polyline poly_resampled;
+	auto const polyline = le_path_get_polyline_view( self, polyline_index );
+
+	size_t cursor = 1;
+
+	if ( tangents ) {
+		for ( size_t i = 0; i != count; ++i ) {
+			le_polyline_sample( polyline, t[ i ], &cursor, vertices + i, tangents + i );
+		}
+	} else {
+		for ( size_t i = 0; i != count; ++i ) {
+			le_polyline_sample( polyline, t[ i ], &cursor, vertices + i, nullptr );
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Resamples `polyline` into `poly_resampled`, which must be empty. Returns
+// false if polyline could not be resampled, in which case we leave
+// `poly_resampled` untouched.
+static bool le_polyline_resample( PolylineView const& polyline, float interval, Polyline& poly_resampled ) {
 
 	// -- How many times can we fit interval into length of polyline?
 
@@ -2306,7 +2959,7 @@ static void le_polyline_resample( Polyline& polyline, float interval ) {
 
 	if ( n_segments == 1 ) {
 		// we cannot resample polylines which have only one segment.
-		return;
+		return false;
 	}
 
 	// reserve n vertices
@@ -2317,20 +2970,21 @@ static void le_polyline_resample( Polyline& polyline, float interval ) {
 
 	// Find first point
 	glm::vec2 vertex;
-	le_polyline_get_at( polyline, 0.f, &vertex );
+	size_t    cursor = 1; // sample positions increase, so lookups may continue from the last segment
+	le_polyline_sample( polyline, 0.f, &cursor, &vertex, nullptr );
 	trace_move_to( poly_resampled, vertex );
 
 	// Note that we must add an extra vertex at the end so that we
 	// capture the correct number of segments.
 	for ( size_t i = 1; i <= n_segments; ++i ) {
-		le_polyline_get_at( polyline, i * delta, &vertex );
+		le_polyline_sample( polyline, i * delta, &cursor, &vertex, nullptr );
 		// We use trace_line_to, because this will get us more accurate distance
 		// calculations - trace_line_to updates the distances as a side-effect,
 		// effectively redrawing the polyline as if it was a series of `line_to`s.
 		trace_line_to( poly_resampled, vertex );
 	}
 
-	std::swap( polyline, poly_resampled );
+	return true;
 }
 
 // ----------------------------------------------------------------------
@@ -2350,19 +3004,27 @@ static void le_path_resample( le_path_o* self, float interval ) {
 
 	// Resample each polyline, turn by turn
 
-	for ( auto& p : self->polylines ) {
-		le_polyline_resample( p, interval );
+	Polyline& poly_resampled = self->polyline_builder;
+
+	for ( size_t i = 0; i != self->polylines.size(); ++i ) {
+		polyline_reset( poly_resampled );
+		if ( le_polyline_resample( le_path_get_polyline_view( self, i ), interval, poly_resampled ) ) {
+			le_path_commit_polyline( self, i, poly_resampled );
+			self->polylines[ i ].source_hash = 0; // polyline no longer matches its contour
+		}
 		// -- Enforce invariant that says for closed paths:
 		// First and last vertex must be identical.
 	}
+
+	le_path_compact_polyline_data( self );
 }
 
 // ----------------------------------------------------------------------
 
 static void le_path_move_to( le_path_o* self, glm::vec2 const* p ) {
 	// move_to means a new subpath, unless the last command was a
-	self->contours.emplace_back(); // add empty subpath
-	self->contours.back().commands.emplace_back( PathCommand::eMoveTo, *p );
+	self->contours.push_back( { uint32_t( self->commands.size() ), 0 } ); // add empty subpath
+	le_path_add_command( self, { PathCommand::eMoveTo, *p } );
 }
 
 // ----------------------------------------------------------------------
@@ -2373,7 +3035,7 @@ static void le_path_line_to( le_path_o* self, glm::vec2 const* p ) {
 		le_path_move_to( self, &v0 );
 	}
 	assert( !self->contours.empty() ); // subpath must exist
-	self->contours.back().commands.emplace_back( PathCommand::eLineTo, *p );
+	le_path_add_command( self, { PathCommand::eLineTo, *p } );
 }
 
 // ----------------------------------------------------------------------
@@ -2382,11 +3044,11 @@ static void le_path_line_to( le_path_o* self, glm::vec2 const* p ) {
 // from the command stream.
 static glm::vec2 const* le_path_get_previous_p( le_path_o* self ) {
 	assert( !self->contours.empty() );                 // Subpath must exist
-	assert( !self->contours.back().commands.empty() ); // previous command must exist
+	assert( self->contours.back().commands_count != 0 ); // previous command must exist
 
 	glm::vec2 const* p = nullptr;
 
-	auto const& c = self->contours.back().commands.back(); // fetch last command
+	auto const& c = self->commands.back(); // fetch last command
 
 	switch ( c.type ) {
 	case PathCommand::eMoveTo:        // fall-through
@@ -2412,7 +3074,7 @@ static glm::vec2 const* le_path_get_previous_p( le_path_o* self ) {
 
 static void le_path_line_horiz_to( le_path_o* self, float px ) {
 	assert( !self->contours.empty() );                 // Subpath must exist
-	assert( !self->contours.back().commands.empty() ); // previous command must exist
+	assert( self->contours.back().commands_count != 0 ); // previous command must exist
 
 	auto p = le_path_get_previous_p( self );
 
@@ -2427,7 +3089,7 @@ static void le_path_line_horiz_to( le_path_o* self, float px ) {
 
 static void le_path_line_vert_to( le_path_o* self, float py ) {
 	assert( !self->contours.empty() );                 // Subpath must exist
-	assert( !self->contours.back().commands.empty() ); // previous command must exist
+	assert( self->contours.back().commands_count != 0 ); // previous command must exist
 
 	auto p = le_path_get_previous_p( self );
 
@@ -2442,33 +3104,59 @@ static void le_path_line_vert_to( le_path_o* self, float py ) {
 
 static void le_path_quad_bezier_to( le_path_o* self, glm::vec2 const* p, glm::vec2 const* c1 ) {
 	assert( !self->contours.empty() ); // contour must exist
-	self->contours.back().commands.emplace_back( *p, PathCommand::Data::AsQuadBezier{ *c1 } );
+	le_path_add_command( self, { *p, PathCommand::Data::AsQuadBezier{ *c1 } } );
 }
 
 // ----------------------------------------------------------------------
 
 static void le_path_cubic_bezier_to( le_path_o* self, glm::vec2 const* p, glm::vec2 const* c1, glm::vec2 const* c2 ) {
 	assert( !self->contours.empty() ); // subpath must exist
-	self->contours.back().commands.emplace_back( *p, PathCommand::Data::AsCubicBezier{ *c1, *c2 } );
+	le_path_add_command( self, { *p, PathCommand::Data::AsCubicBezier{ *c1, *c2 } } );
 }
 
 // ----------------------------------------------------------------------
 
 static void le_path_arc_to( le_path_o* self, glm::vec2 const* p, glm::vec2 const* radii, float phi, bool large_arc, bool sweep ) {
 	assert( !self->contours.empty() ); // subpath must exist
-	self->contours.back().commands.emplace_back( *p, PathCommand::Data::AsArc{ *radii, phi, large_arc, sweep } );
+	le_path_add_command( self, { *p, PathCommand::Data::AsArc{ *radii, phi, large_arc, sweep } } );
 }
 
 // ----------------------------------------------------------------------
 
 static void le_path_close_path( le_path_o* self ) {
-	glm::vec2 first_point = {};
-	if ( !self->contours.back().commands.empty() ) {
-		if ( self->contours.back().commands.front().type == PathCommand::eMoveTo ) {
-			first_point = self->contours.back().commands.front().p;
+	glm::vec2  first_point = {};
+	auto const commands    = le_path_get_last_contour_commands( self );
+	if ( !commands.empty() ) {
+		if ( commands.front().type == PathCommand::eMoveTo ) {
+			first_point = commands.front().p;
 		}
 	}
-	self->contours.back().commands.emplace_back( PathCommand::eClosePath, first_point );
+	le_path_add_command( self, { PathCommand::eClosePath, first_point } );
+}
+
+// ----------------------------------------------------------------------
+
+// Make room for `num_floats` floats, and `num_vec2s` vec2s, all set to zero.
+// Any arrays which were taken from scratch before become invalid.
+static void solver_scratch_reset( SolverScratch& scratch, size_t num_floats, size_t num_vec2s ) {
+	scratch.floats.assign( num_floats, 0.f ); // keeps capacity
+	scratch.vec2s.assign( num_vec2s, glm::vec2( 0.f ) );
+	scratch.floats_used = 0;
+	scratch.vec2s_used  = 0;
+}
+
+static float* solver_scratch_floats( SolverScratch& scratch, size_t count ) {
+	assert( scratch.floats_used + count <= scratch.floats.size() );
+	float* result = scratch.floats.data() + scratch.floats_used;
+	scratch.floats_used += count;
+	return result;
+}
+
+static glm::vec2* solver_scratch_vec2s( SolverScratch& scratch, size_t count ) {
+	assert( scratch.vec2s_used + count <= scratch.vec2s.size() );
+	glm::vec2* result = scratch.vec2s.data() + scratch.vec2s_used;
+	scratch.vec2s_used += count;
+	return result;
 }
 
 // ----------------------------------------------------------------------
@@ -2489,7 +3177,7 @@ static inline float rho( float a, float b ) {
 // Apply hobby algorithm for a closed path onto path commands.
 // This effectively changes all commands to type cubic bezier, and
 // will set their control points to optimise for best curvature.
-static void path_commands_apply_hobby_closed( std::vector<PathCommand>& commands ) {
+static void path_commands_apply_hobby_closed( std::span<PathCommand> commands, SolverScratch& scratch ) {
 	// note that last command will be the close command - all other commands are legit.
 
 	// We expect a list of path commands with the following pattern:
@@ -2501,8 +3189,10 @@ static void path_commands_apply_hobby_closed( std::vector<PathCommand>& commands
 
 	size_t count = commands.size() - 2; // we remove the close flag from the count, and the last, doubled vertex
 
-	std::vector<float>     D( count );
-	std::vector<glm::vec2> delta( count ); // vector between points
+	solver_scratch_reset( scratch, count * 15, count );
+
+	float*     D     = solver_scratch_floats( scratch, count );
+	glm::vec2* delta = solver_scratch_vec2s( scratch, count ); // vector between points
 
 	for ( size_t i = 0; i != count; i++ ) {
 		size_t j   = ( i + 1 ) % count; // next point wrapped around
@@ -2510,7 +3200,7 @@ static void path_commands_apply_hobby_closed( std::vector<PathCommand>& commands
 		D[ i ]     = glm::length( delta[ i ] );
 	}
 
-	std::vector<float> gamma( count ); // angles for directions between points (relative to x-axis)
+	float* gamma = solver_scratch_floats( scratch, count ); // angles for directions between points (relative to x-axis)
 
 	for ( size_t i = 0; i != count; i++ ) {
 		size_t    k          = ( i + count - 1 ) % count; // index for previous point, wrapped around
@@ -2526,17 +3216,17 @@ static void path_commands_apply_hobby_closed( std::vector<PathCommand>& commands
 		gamma[ i ] = atan2( d_rot.y, d_rot.x ); // capture angles
 	}
 
-	std::vector<float> alpha( count );
-	std::vector<float> beta( count );
+	float* alpha = solver_scratch_floats( scratch, count );
+	float* beta  = solver_scratch_floats( scratch, count );
 
 	{
 		// Calculate alpha (and implicitly beta) via the sherman-morrisson-woodbury
 		// formula.
 
-		std::vector<float> a( count );
-		std::vector<float> b( count );
-		std::vector<float> c( count );
-		std::vector<float> d( count );
+		float* a = solver_scratch_floats( scratch, count );
+		float* b = solver_scratch_floats( scratch, count );
+		float* c = solver_scratch_floats( scratch, count );
+		float* d = solver_scratch_floats( scratch, count );
 
 		for ( size_t i = 0; i != count; i++ ) {
 			size_t j = ( i + 1 ) % count;         // previous point, wrapped
@@ -2547,8 +3237,8 @@ static void path_commands_apply_hobby_closed( std::vector<PathCommand>& commands
 			d[ i ]   = -( 2.f * gamma[ i ] * D[ i ] + gamma[ j ] * D[ k ] ) / ( D[ k ] * D[ i ] );
 		}
 
-		sherman_morrisson_woodbury( a.data(), b.data(), c.data(), d.data(),
-		                            alpha.size(), alpha.data() );
+		sherman_morrisson_woodbury( a, b, c, d,
+		                            count, alpha, solver_scratch_floats( scratch, count * 7 ) );
 
 		// beta = -1 * ( gamma + alpha )
 		for ( size_t i = 0; i != count; i++ ) {
@@ -2573,7 +3263,7 @@ static void path_commands_apply_hobby_closed( std::vector<PathCommand>& commands
 // Apply hobby algorithm for a closed path onto path commands.
 // This effectively changes all commands to type cubic bezier, and
 // will set their control points to optimise for best curvature.
-static void path_commands_apply_hobby_open( std::vector<PathCommand>& commands ) {
+static void path_commands_apply_hobby_open( std::span<PathCommand> commands, SolverScratch& scratch ) {
 	// note that last command will be the close command - all other commands are legit.
 
 	// We expect a list of path commands with the following pattern:
@@ -2585,15 +3275,17 @@ static void path_commands_apply_hobby_open( std::vector<PathCommand>& commands )
 
 	int count = commands.size() - 1; // we remove the close flag from the count, and the last, doubled vertex
 
-	std::vector<float>     D( count );
-	std::vector<glm::vec2> delta( count ); // vector between points
+	solver_scratch_reset( scratch, count * 10 + 8, count );
+
+	float*     D     = solver_scratch_floats( scratch, count );
+	glm::vec2* delta = solver_scratch_vec2s( scratch, count ); // vector between points
 
 	for ( int i = 0; i < count; i++ ) {
 		delta[ i ] = commands[ i + 1 ].p - commands[ i ].p;
 		D[ i ]     = glm::length( delta[ i ] );
 	}
 
-	std::vector<float> gamma( count + 1 ); // angles for directions between points (relative to x-axis)
+	float* gamma = solver_scratch_floats( scratch, count + 1 ); // angles for directions between points (relative to x-axis)
 
 	for ( int i = 1; i < count; i++ ) {
 		glm::vec2 delta_norm = delta[ i - 1 ] / D[ i - 1 ]; // normalise delta, this implicitly means x = sin(a), y = cos(a)
@@ -2608,17 +3300,17 @@ static void path_commands_apply_hobby_open( std::vector<PathCommand>& commands )
 		gamma[ i ] = atan2( d_rot.y, d_rot.x ); // capture angles
 	}
 
-	std::vector<float> alpha( count + 1 );
-	std::vector<float> beta( count );
+	float* alpha = solver_scratch_floats( scratch, count + 1 );
+	float* beta  = solver_scratch_floats( scratch, count );
 
 	{
 		// Calculate alpha (and implicitly beta)
 		// via the Thomas algorithm.
 
-		std::vector<float> a( count + 1 );
-		std::vector<float> b( count + 1 );
-		std::vector<float> c( count + 1 );
-		std::vector<float> d( count + 1 );
+		float* a = solver_scratch_floats( scratch, count + 1 );
+		float* b = solver_scratch_floats( scratch, count + 1 );
+		float* c = solver_scratch_floats( scratch, count + 1 );
+		float* d = solver_scratch_floats( scratch, count + 1 );
 
 		for ( int i = 1; i < count; i++ ) {
 			a[ i ] = 1 / D[ i - 1 ];
@@ -2638,8 +3330,8 @@ static void path_commands_apply_hobby_open( std::vector<PathCommand>& commands )
 		b[ count ] = 2 + omega;
 		d[ count ] = 0;
 
-		thomas( a.data(), b.data(), c.data(), d.data(),
-		        alpha.size(), alpha.data() );
+		thomas( a, b, c, d,
+		        size_t( count + 1 ), alpha, solver_scratch_floats( scratch, ( count + 1 ) * 2 ) );
 
 		// beta = -1 * ( gamma + alpha )
 		for ( int i = 0; i < count - 1; i++ ) {
@@ -2677,12 +3369,12 @@ static void le_path_apply_hobby_on_last_contour( le_path_o* self ) {
 
 	// ----------| invariant: there is a last contour
 
-	auto& commands = self->contours.back().commands;
+	auto commands = le_path_get_last_contour_commands( self );
 
 	if ( commands.back().type == PathCommand::Type::eClosePath ) {
-		path_commands_apply_hobby_closed( commands );
+		path_commands_apply_hobby_closed( commands, self->solver_scratch );
 	} else {
-		path_commands_apply_hobby_open( commands );
+		path_commands_apply_hobby_open( commands, self->solver_scratch );
 	}
 }
 
@@ -2724,15 +3416,14 @@ static bool le_path_get_vertices_for_polyline( le_path_o* self, size_t const& po
 	bool success = false;
 	assert( polyline_index < self->polylines.size() );
 
-	auto const& polyline = self->polylines[ polyline_index ];
+	auto const polyline = le_path_get_polyline_view( self, polyline_index );
 
-	if ( polyline.vertices.size() <= *numVertices ) {
-		memcpy( vertices, polyline.vertices.data(),
-		        sizeof( decltype( polyline.vertices )::value_type ) * polyline.vertices.size() );
+	if ( polyline.vertices_count <= *numVertices ) {
+		memcpy( vertices, polyline.vertices, sizeof( glm::vec2 ) * polyline.vertices_count );
 		success = true;
 	}
 
-	*numVertices = polyline.vertices.size();
+	*numVertices = polyline.vertices_count;
 	return success;
 }
 
@@ -2742,14 +3433,13 @@ static bool le_path_get_tangents_for_polyline( le_path_o* self, size_t const& po
 	bool success = false;
 	assert( polyline_index < self->polylines.size() );
 
-	auto const& polyline = self->polylines[ polyline_index ];
-	if ( polyline.tangents.size() <= *numTangents ) {
-		memcpy( tangents, polyline.tangents.data(),
-		        sizeof( decltype( polyline.tangents )::value_type ) * polyline.tangents.size() );
+	auto const polyline = le_path_get_polyline_view( self, polyline_index );
+	if ( polyline.tangents_count <= *numTangents ) {
+		memcpy( tangents, polyline.tangents, sizeof( glm::vec2 ) * polyline.tangents_count );
 		success = true;
 	}
 
-	*numTangents = polyline.tangents.size();
+	*numTangents = polyline.tangents_count;
 	return success;
 }
 
@@ -3185,7 +3875,7 @@ static void le_path_add_from_simplified_svg( le_path_o* self, char const* svg )
 
 	char const* c = svg;
 
-	glm::vec2 p                 = ( !self->contours.empty() && !self->contours.back().commands.empty() ) ? *le_path_get_previous_p( self ) : glm::vec2{};
+	glm::vec2 p                 = ( !self->contours.empty() && self->contours.back().commands_count != 0 ) ? *le_path_get_previous_p( self ) : glm::vec2{};
 	glm::vec2 c1                = {};
 	glm::vec2 c2                = {};
 	glm::vec2 radii             = {};
@@ -3332,9 +4022,11 @@ LE_MODULE_REGISTER_IMPL( le_path, api ) {
 	le_path_i.get_vertices_for_polyline        = le_path_get_vertices_for_polyline;
 	le_path_i.get_tangents_for_polyline        = le_path_get_tangents_for_polyline;
 	le_path_i.get_polyline_at_pos_interpolated = le_path_get_polyline_at_pos_interpolated;
+	le_path_i.sample_polyline_at_positions     = le_path_sample_polyline_at_positions;
 
 	le_path_i.generate_offset_outline_for_contour = le_path_generate_offset_outline_for_contour;
 	le_path_i.tessellate_thick_contour            = le_path_tessellate_thick_contour;
+	le_path_i.tessellate_thick_contours           = le_path_tessellate_thick_contours;
 
 	le_path_i.iterate_vertices_for_contour     = le_path_iterate_vertices_for_contour;
 	le_path_i.iterate_quad_beziers_for_contour = le_path_iterate_quad_beziers_for_contour;
@@ -3342,6 +4034,12 @@ LE_MODULE_REGISTER_IMPL( le_path, api ) {
 	le_path_i.trace    = le_path_trace_path;
 	le_path_i.flatten  = le_path_flatten_path;
 	le_path_i.resample = le_path_resample;
+
+	le_path_i.flatten_uniform                = le_path_flatten_path_uniform;
+	le_path_i.get_flatten_uniform_lane_count = le_path_get_flatten_uniform_lane_count;
+
+	le_path_i.trace_paths   = le_path_trace_paths;
+	le_path_i.flatten_paths = le_path_flatten_paths;
 	le_path_i.clone    = le_path_clone;
 	le_path_i.clear    = le_path_clear;
 }
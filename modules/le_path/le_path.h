@@ -60,11 +60,32 @@ struct le_path_api {
 
 		void ( *add_from_simplified_svg )( le_path_o* self, char const* svg );
 
-		// Generate and cache polylines for each contour per path
+		// Generate and cache polylines for each contour per path. Polylines are only generated
+		// again for contours which have changed since, or if resolution or tolerance has changed -
+		// this holds even across `clear`, if the path gets rebuilt with some of the same contours.
+		//
+		// Note that flatten subdivides curves adaptively, which keeps most curves within tolerance,
+		// but not all: cubic curves with a cusp, or a sharp turn, may deviate from their polyline
+		// by much more than tolerance near the cusp. flatten_uniform always stays within tolerance.
 		void ( *trace    )( le_path_o* self, size_t resolution );
 		void ( *flatten  )( le_path_o* self, float tolerance );
 		void ( *resample )( le_path_o* self, float interval );
 
+		// Like flatten, but splits each curve into equally spaced segments - just as many as
+		// needed to stay within tolerance. Segment counts and vertices are calculated for many
+		// curves at once, using SIMD. Faster than flatten, but may generate more vertices.
+		void ( *flatten_uniform )( le_path_o* self, float tolerance );
+
+		// Number of curves, or parameter steps, which flatten_uniform processes at once:
+		// 8 (AVX2), 4 (SSE2), or 1 - chosen when le_path is compiled.
+		uint32_t ( *get_flatten_uniform_lane_count )();
+
+		// Trace, or flatten, many paths at once - contours of all paths are processed in
+		// parallel, and results are bit-identical with calling trace, or flatten, on each
+		// path in turn. Batch methods use le_jobs, which must have been initialised.
+		void ( *trace_paths   )( le_path_o** paths, size_t num_paths, size_t resolution );
+		void ( *flatten_paths )( le_path_o** paths, size_t num_paths, float tolerance );
+
 		// Always updates `max_count_outline_[l|r] with the number of used vertices for l and r outline.
 		// Returns false if either given `max_count_outline_[l|r]` was less than the number of vertices needed
 		// Returns true if max_count_outline_[l|r] was sufficient to hold vertices for l and r outline: also
@@ -75,6 +96,14 @@ struct le_path_api {
 		/// Note: Upon return, `*num_vertices` will contain number of vertices needed to describe tessellated contour triangles.
 		bool ( *tessellate_thick_contour )( le_path_o* self, size_t contour_index, struct stroke_attribute_t const* stroke_attributes, glm::vec2* vertices, size_t* num_vertices );
 
+		/// Tessellates all contours of the path, in parallel - results are the same as calling
+		/// `tessellate_thick_contour` for each contour in turn, and appending all vertices.
+		/// Returns `false` if num_vertices was smaller than needed number of vertices, and always
+		/// updates `*num_vertices`, just like `tessellate_thick_contour`. If `contour_offsets` is
+		/// not nullptr, it must hold `get_num_contours() + 1` elements: it receives the index of
+		/// the first vertex for each contour, followed by the total number of vertices.
+		bool ( *tessellate_thick_contours )( le_path_o* self, struct stroke_attribute_t const* stroke_attributes, glm::vec2* vertices, size_t* num_vertices, size_t* contour_offsets );
+
 		size_t ( *get_num_contours  )( le_path_o* self );
 		size_t ( *get_num_polylines )( le_path_o* self );
 
@@ -89,6 +118,13 @@ struct le_path_api {
 
 		void ( *get_polyline_at_pos_interpolated )( le_path_o* self, size_t const& polyline_index, float normPos, glm::vec2* result );
 
+		// Samples polyline at `count` normalized positions `t`, and writes `count` vertices. Unless
+		// `tangents` is nullptr, also writes `count` tangents, interpolated from the polyline's tangents,
+		// which are not normalized. Each sample costs at most O(log n) for a polyline of n vertices,
+		// and O(1) on average if positions increase - sort positions where possible. Only reads from the
+		// path, so that ranges of positions may be sampled from several jobs at once.
+		void ( *sample_polyline_at_positions     )( le_path_o* self, size_t const& polyline_index, float const* t, size_t count, glm::vec2* vertices, glm::vec2* tangents );
+
 		void ( *iterate_vertices_for_contour     )( le_path_o* self, size_t const& contour_index, contour_vertex_cb callback, void* user_data );
 		void ( *iterate_quad_beziers_for_contour )( le_path_o* self, size_t const& contour_index, contour_quad_bezier_cb callback, void* user_data );
 	};
@@ -178,10 +214,23 @@ class Path : NoCopy, NoMove {
 		le_path::le_path_i.flatten( self, tolerance );
 	}
 
+	void flattenUniform( float tolerance = 0.25f ) {
+		le_path::le_path_i.flatten_uniform( self, tolerance );
+	}
+
 	void resample( float interval ) {
 		le_path::le_path_i.resample( self, interval );
 	}
 
+	// Batch methods: le_jobs must have been initialised.
+	static void tracePaths( le_path_o** paths, size_t numPaths, size_t resolution = 12 ) {
+		le_path::le_path_i.trace_paths( paths, numPaths, resolution );
+	}
+
+	static void flattenPaths( le_path_o** paths, size_t numPaths, float tolerance = 0.25f ) {
+		le_path::le_path_i.flatten_paths( paths, numPaths, tolerance );
+	}
+
 	size_t getNumPolylines() {
 		return le_path::le_path_i.get_num_polylines( self );
 	}
@@ -202,6 +251,18 @@ class Path : NoCopy, NoMove {
 		le_path::le_path_i.get_polyline_at_pos_interpolated( self, polylineIndex, normalizedPos, vertex );
 	}
 
+	void samplePolylineAtPositions( size_t const& polylineIndex, float const* normalizedPos, size_t count, glm::vec2* vertices, glm::vec2* tangents = nullptr ) {
+		le_path::le_path_i.sample_polyline_at_positions( self, polylineIndex, normalizedPos, count, vertices, tangents );
+	}
+
+	bool tessellateThickContour( size_t contourIndex, le_path_api::stroke_attribute_t const* strokeAttributes, glm::vec2* vertices, size_t* numVertices ) {
+		return le_path::le_path_i.tessellate_thick_contour( self, contourIndex, strokeAttributes, vertices, numVertices );
+	}
+
+	bool tessellateThickContours( le_path_api::stroke_attribute_t const* strokeAttributes, glm::vec2* vertices, size_t* numVertices, size_t* contourOffsets = nullptr ) {
+		return le_path::le_path_i.tessellate_thick_contours( self, strokeAttributes, vertices, numVertices, contourOffsets );
+	}
+
 	void clear() {
 		le_path::le_path_i.clear( self );
 	}
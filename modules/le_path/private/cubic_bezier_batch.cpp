@@ -0,0 +1,249 @@
+#include "cubic_bezier_batch.h"
+
+#include <math.h>
+
+/* Lanes: a minimal set of operations on as many floats as the target
+ * instruction set processes at once. Everything below is written in
+ * terms of these operations, so that each instruction set only needs
+ * to provide them once.
+ */
+
+#if defined( __AVX2__ )
+
+#	include <immintrin.h>
+
+#	define LANE_COUNT 8
+
+typedef __m256 lanes_t;
+
+static inline lanes_t lanes_load( float const* p ) {
+	return _mm256_loadu_ps( p );
+}
+static inline lanes_t lanes_set( float f ) {
+	return _mm256_set1_ps( f );
+}
+static inline lanes_t lanes_iota() {
+	return _mm256_setr_ps( 0, 1, 2, 3, 4, 5, 6, 7 );
+}
+static inline lanes_t lanes_add( lanes_t a, lanes_t b ) {
+	return _mm256_add_ps( a, b );
+}
+static inline lanes_t lanes_sub( lanes_t a, lanes_t b ) {
+	return _mm256_sub_ps( a, b );
+}
+static inline lanes_t lanes_mul( lanes_t a, lanes_t b ) {
+	return _mm256_mul_ps( a, b );
+}
+static inline lanes_t lanes_max( lanes_t a, lanes_t b ) {
+	return _mm256_max_ps( a, b ); // returns b if a is NaN
+}
+static inline lanes_t lanes_min( lanes_t a, lanes_t b ) {
+	return _mm256_min_ps( a, b );
+}
+static inline lanes_t lanes_sqrt( lanes_t a ) {
+	return _mm256_sqrt_ps( a );
+}
+static inline void lanes_store_ceil( uint32_t* dst, lanes_t a ) {
+	_mm256_storeu_si256( reinterpret_cast<__m256i*>( dst ), _mm256_cvtps_epi32( _mm256_ceil_ps( a ) ) );
+}
+// Store x0, y0, x1, y1, ...
+static inline void lanes_store_interleaved( float* dst, lanes_t x, lanes_t y ) {
+	__m256 lo = _mm256_unpacklo_ps( x, y ); // x0 y0 x1 y1 | x4 y4 x5 y5
+	__m256 hi = _mm256_unpackhi_ps( x, y ); // x2 y2 x3 y3 | x6 y6 x7 y7
+	_mm256_storeu_ps( dst, _mm256_permute2f128_ps( lo, hi, 0x20 ) );
+	_mm256_storeu_ps( dst + 8, _mm256_permute2f128_ps( lo, hi, 0x31 ) );
+}
+
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+
+#	include <emmintrin.h>
+
+#	define LANE_COUNT 4
+
+typedef __m128 lanes_t;
+
+static inline lanes_t lanes_load( float const* p ) {
+	return _mm_loadu_ps( p );
+}
+static inline lanes_t lanes_set( float f ) {
+	return _mm_set1_ps( f );
+}
+static inline lanes_t lanes_iota() {
+	return _mm_setr_ps( 0, 1, 2, 3 );
+}
+static inline lanes_t lanes_add( lanes_t a, lanes_t b ) {
+	return _mm_add_ps( a, b );
+}
+static inline lanes_t lanes_sub( lanes_t a, lanes_t b ) {
+	return _mm_sub_ps( a, b );
+}
+static inline lanes_t lanes_mul( lanes_t a, lanes_t b ) {
+	return _mm_mul_ps( a, b );
+}
+static inline lanes_t lanes_max( lanes_t a, lanes_t b ) {
+	return _mm_max_ps( a, b ); // returns b if a is NaN
+}
+static inline lanes_t lanes_min( lanes_t a, lanes_t b ) {
+	return _mm_min_ps( a, b );
+}
+static inline lanes_t lanes_sqrt( lanes_t a ) {
+	return _mm_sqrt_ps( a );
+}
+static inline void lanes_store_ceil( uint32_t* dst, lanes_t a ) {
+	// SSE2 has no ceil: we truncate, and add one wherever truncation rounded down.
+	__m128i i     = _mm_cvttps_epi32( a );
+	__m128  below = _mm_cmplt_ps( _mm_cvtepi32_ps( i ), a ); // all bits set where we must add one
+	_mm_storeu_si128( reinterpret_cast<__m128i*>( dst ), _mm_sub_epi32( i, _mm_castps_si128( below ) ) );
+}
+// Store x0, y0, x1, y1, ...
+static inline void lanes_store_interleaved( float* dst, lanes_t x, lanes_t y ) {
+	_mm_storeu_ps( dst, _mm_unpacklo_ps( x, y ) );
+	_mm_storeu_ps( dst + 4, _mm_unpackhi_ps( x, y ) );
+}
+
+#else
+
+#	define LANE_COUNT 1
+
+#endif
+
+// ----------------------------------------------------------------------
+
+uint32_t cubic_bezier_batch_lane_count() {
+	return LANE_COUNT;
+}
+
+// ----------------------------------------------------------------------
+// Wang's formula, for a cubic curve:
+//
+//     n = ceil( sqrt( 3 * 2 / 8 * M / tolerance ) )
+//
+// where M is the length of the largest second difference of control points.
+// `k` is 0.75 / tolerance.
+static inline uint32_t segment_count( cubic_bezier_batch_t const* c, size_t i, float k, float max_segments ) {
+
+	float const d0_x = c->p0_x[ i ] - 2 * c->c1_x[ i ] + c->c2_x[ i ];
+	float const d0_y = c->p0_y[ i ] - 2 * c->c1_y[ i ] + c->c2_y[ i ];
+	float const d1_x = c->c1_x[ i ] - 2 * c->c2_x[ i ] + c->p1_x[ i ];
+	float const d1_y = c->c1_y[ i ] - 2 * c->c2_y[ i ] + c->p1_y[ i ];
+
+	float const m_sq = fmaxf( d0_x * d0_x + d0_y * d0_y, d1_x * d1_x + d1_y * d1_y );
+	float       n    = sqrtf( k * sqrtf( m_sq ) );
+
+	n = n > 1.f ? n : 1.f; // also catches NaN
+	n = n < max_segments ? n : max_segments;
+
+	return uint32_t( ceilf( n ) );
+}
+
+// ----------------------------------------------------------------------
+
+void cubic_bezier_batch_segment_counts( cubic_bezier_batch_t const* c, size_t count, float tolerance, uint32_t max_segments, uint32_t* segment_counts ) {
+
+	float const k     = 0.75f / tolerance;
+	float const n_max = float( max_segments );
+	size_t      i     = 0;
+
+#if LANE_COUNT > 1
+	lanes_t const two    = lanes_set( 2.f );
+	lanes_t const one    = lanes_set( 1.f );
+	lanes_t const k_     = lanes_set( k );
+	lanes_t const n_max_ = lanes_set( n_max );
+
+	for ( ; i + LANE_COUNT <= count; i += LANE_COUNT ) {
+
+		lanes_t const c1_x = lanes_load( c->c1_x + i );
+		lanes_t const c1_y = lanes_load( c->c1_y + i );
+		lanes_t const c2_x = lanes_load( c->c2_x + i );
+		lanes_t const c2_y = lanes_load( c->c2_y + i );
+
+		lanes_t const d0_x = lanes_add( lanes_sub( lanes_load( c->p0_x + i ), lanes_mul( two, c1_x ) ), c2_x );
+		lanes_t const d0_y = lanes_add( lanes_sub( lanes_load( c->p0_y + i ), lanes_mul( two, c1_y ) ), c2_y );
+		lanes_t const d1_x = lanes_add( lanes_sub( c1_x, lanes_mul( two, c2_x ) ), lanes_load( c->p1_x + i ) );
+		lanes_t const d1_y = lanes_add( lanes_sub( c1_y, lanes_mul( two, c2_y ) ), lanes_load( c->p1_y + i ) );
+
+		lanes_t const m_sq = lanes_max( lanes_add( lanes_mul( d0_x, d0_x ), lanes_mul( d0_y, d0_y ) ),
+		                                lanes_add( lanes_mul( d1_x, d1_x ), lanes_mul( d1_y, d1_y ) ) );
+
+		lanes_t n = lanes_sqrt( lanes_mul( k_, lanes_sqrt( m_sq ) ) );
+
+		n = lanes_min( lanes_max( n, one ), n_max_ );
+
+		lanes_store_ceil( segment_counts + i, n );
+	}
+#endif
+
+	// Any remaining curves which don't fill all lanes.
+	for ( ; i != count; ++i ) {
+		segment_counts[ i ] = segment_count( c, i, k, n_max );
+	}
+}
+
+// ----------------------------------------------------------------------
+// We evaluate curves in power basis, B(t) = ((a * t + b) * t + c) * t + d,
+// which is cheaper than the Bernstein form, and the first derivative,
+// B'(t) = (3a * t + 2b) * t + c.
+
+void cubic_bezier_batch_evaluate_uniform( cubic_bezier_batch_t const* curves, size_t index, uint32_t n, float* points, float* tangents ) {
+
+	float const p0[ 2 ] = { curves->p0_x[ index ], curves->p0_y[ index ] };
+	float const c1[ 2 ] = { curves->c1_x[ index ], curves->c1_y[ index ] };
+	float const c2[ 2 ] = { curves->c2_x[ index ], curves->c2_y[ index ] };
+	float const p1[ 2 ] = { curves->p1_x[ index ], curves->p1_y[ index ] };
+
+	float a[ 2 ], b[ 2 ], c[ 2 ], d[ 2 ];
+
+	for ( int j = 0; j != 2; ++j ) {
+		a[ j ] = -p0[ j ] + 3 * c1[ j ] - 3 * c2[ j ] + p1[ j ];
+		b[ j ] = 3 * p0[ j ] - 6 * c1[ j ] + 3 * c2[ j ];
+		c[ j ] = -3 * p0[ j ] + 3 * c1[ j ];
+		d[ j ] = p0[ j ];
+	}
+
+	float const dt = 1.f / float( n );
+	uint32_t    i  = 1; // we start at t = dt, since the start point is the end point of whatever came before
+
+#if LANE_COUNT > 1
+	lanes_t const a_x = lanes_set( a[ 0 ] ), a_y = lanes_set( a[ 1 ] );
+	lanes_t const b_x = lanes_set( b[ 0 ] ), b_y = lanes_set( b[ 1 ] );
+	lanes_t const c_x = lanes_set( c[ 0 ] ), c_y = lanes_set( c[ 1 ] );
+	lanes_t const d_x = lanes_set( d[ 0 ] ), d_y = lanes_set( d[ 1 ] );
+
+	lanes_t const a3_x = lanes_set( 3 * a[ 0 ] ), a3_y = lanes_set( 3 * a[ 1 ] );
+	lanes_t const b2_x = lanes_set( 2 * b[ 0 ] ), b2_y = lanes_set( 2 * b[ 1 ] );
+
+	lanes_t const dt_   = lanes_set( dt );
+	lanes_t const iota_ = lanes_iota();
+
+	for ( ; i + LANE_COUNT - 1 <= n; i += LANE_COUNT ) {
+
+		lanes_t const t = lanes_mul( lanes_add( lanes_set( float( i ) ), iota_ ), dt_ );
+
+		lanes_t const x = lanes_add( lanes_mul( lanes_add( lanes_mul( lanes_add( lanes_mul( a_x, t ), b_x ), t ), c_x ), t ), d_x );
+		lanes_t const y = lanes_add( lanes_mul( lanes_add( lanes_mul( lanes_add( lanes_mul( a_y, t ), b_y ), t ), c_y ), t ), d_y );
+
+		lanes_store_interleaved( points + 2 * ( i - 1 ), x, y );
+
+		if ( tangents ) {
+			lanes_t const tx = lanes_add( lanes_mul( lanes_add( lanes_mul( a3_x, t ), b2_x ), t ), c_x );
+			lanes_t const ty = lanes_add( lanes_mul( lanes_add( lanes_mul( a3_y, t ), b2_y ), t ), c_y );
+			lanes_store_interleaved( tangents + 2 * ( i - 1 ), tx, ty );
+		}
+	}
+#endif
+
+	// Any remaining points which don't fill all lanes.
+	for ( ; i <= n; ++i ) {
+		float const t = float( i ) * dt;
+		for ( int j = 0; j != 2; ++j ) {
+			points[ 2 * ( i - 1 ) + j ] = ( ( a[ j ] * t + b[ j ] ) * t + c[ j ] ) * t + d[ j ];
+			if ( tangents ) {
+				tangents[ 2 * ( i - 1 ) + j ] = ( 3 * a[ j ] * t + 2 * b[ j ] ) * t + c[ j ];
+			}
+		}
+	}
+
+	// Rounding must not open a gap between this curve and whatever follows.
+	points[ 2 * ( n - 1 ) + 0 ] = p1[ 0 ];
+	points[ 2 * ( n - 1 ) + 1 ] = p1[ 1 ];
+}
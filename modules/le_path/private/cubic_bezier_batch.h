@@ -0,0 +1,41 @@
+#ifndef _CUBIC_BEZIER_BATCH_H_
+#define _CUBIC_BEZIER_BATCH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Batch evaluation of cubic bezier curves, using SIMD where available:
+ * AVX2 (8 lanes) if compiled with AVX2 enabled, SSE2 (4 lanes) on any
+ * x86-64, and a scalar fallback otherwise.
+ *
+ * Curves are flattened uniformly: each curve is split into `n` segments
+ * of equal parameter length, where `n` comes from Wang's formula - this
+ * guarantees that no point on the curve is further than `tolerance` away
+ * from the polyline, without any further subdivision.
+ */
+
+// Curves in structure-of-arrays layout - element i of each array belongs to curve i.
+struct cubic_bezier_batch_t {
+	float const* p0_x; // start point
+	float const* p0_y;
+	float const* c1_x; // control point 1
+	float const* c1_y;
+	float const* c2_x; // control point 2
+	float const* c2_y;
+	float const* p1_x; // end point
+	float const* p1_y;
+};
+
+// Number of lanes which the batch functions process at once - 8, 4, or 1.
+uint32_t cubic_bezier_batch_lane_count();
+
+// Calculate for each of `count` curves how many segments are needed so that the
+// flattened curve stays within `tolerance`. Counts are at least 1, and at most `max_segments`.
+void cubic_bezier_batch_segment_counts( cubic_bezier_batch_t const* curves, size_t count, float tolerance, uint32_t max_segments, uint32_t* segment_counts );
+
+// Evaluate curve `index` of `curves` at parameters t = 1/n, 2/n, .. n/n. Writes `n`
+// points, and `n` tangents (first derivatives), as interleaved x,y pairs. The last point
+// is always exactly the end point of the curve. `tangents` may be nullptr.
+void cubic_bezier_batch_evaluate_uniform( cubic_bezier_batch_t const* curves, size_t index, uint32_t n, float* points, float* tangents );
+
+#endif
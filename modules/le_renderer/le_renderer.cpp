@@ -446,7 +446,9 @@ static void renderer_setup( le_renderer_o* self, le_renderer_settings_t const* s
 		}
 
 #if ( LE_MT > 0 )
-		le_backend_vk::settings_i.set_concurrency_count( LE_MT );
+		// +1 because the main thread may execute jobs while it waits for
+		// a counter - it then uses worker id LE_MT.
+		le_backend_vk::settings_i.set_concurrency_count( LE_MT + 1 );
 #endif
 
 		// We can now initialize the backend so that it hopefully conforms to
@@ -828,7 +830,8 @@ static void renderer_update( le_renderer_o* self, le_rendergraph_o* graph_ ) {
 		    },
 		    self->backend };
 
-		le_jobs::run_jobs( &j, 1, &shader_counter );
+		// frame jobs are frame-critical: they must not queue up behind background jobs
+		le_jobs::run_jobs_with_priority( &j, 1, &shader_counter, le_jobs::Priority::eHigh );
 
 		struct frame_params_t {
 			le_renderer_o* renderer;
@@ -836,18 +839,15 @@ static void renderer_update( le_renderer_o* self, le_rendergraph_o* graph_ ) {
 		};
 
 		struct record_params_t {
-			le_renderer_o*      renderer;
-			size_t              frame_index;
-			le_rendergraph_o*   rendergraph;
-			size_t              current_frame_number;
-			le_jobs::counter_t* shader_counter;
+			le_renderer_o*    renderer;
+			size_t            frame_index;
+			le_rendergraph_o* rendergraph;
+			size_t            current_frame_number;
 		};
 
 		auto record_frame_fun = []( void* param_ ) {
 			auto p = static_cast<record_params_t*>( param_ );
 			// generate an intermediary, api-agnostic, representation of the frame
-
-			le_jobs::wait_for_counter_and_free( p->shader_counter, 0 );
 			renderer_record_frame( p->renderer, p->frame_index, p->rendergraph, p->current_frame_number );
 		};
 
@@ -867,14 +867,13 @@ static void renderer_update( le_renderer_o* self, le_rendergraph_o* graph_ ) {
 			renderer_clear_frame( p->renderer, p->frame_index );
 		};
 
-		le_jobs::job_t jobs[ 3 ];
+		le_jobs::job_t jobs[ 2 ];
 
 		record_params_t record_frame_params;
 		record_frame_params.renderer             = self;
 		record_frame_params.frame_index          = ( index + 0 ) % numFrames;
 		record_frame_params.rendergraph          = graph_;
 		record_frame_params.current_frame_number = self->currentFrameNumber;
-		record_frame_params.shader_counter       = shader_counter;
 
 		frame_params_t process_frame_params;
 		process_frame_params.renderer    = self;
@@ -886,17 +885,24 @@ static void renderer_update( le_renderer_o* self, le_rendergraph_o* graph_ ) {
 
 		jobs[ 0 ] = { process_frame_fun, &process_frame_params };
 		jobs[ 1 ] = { clear_frame_fun, &clear_frame_params };
-		jobs[ 2 ] = { record_frame_fun, &record_frame_params };
+
+		le_jobs::job_t record_job = { record_frame_fun, &record_frame_params };
 
 		le_jobs::counter_t* counter;
+		le_jobs::counter_t* record_counter;
 
 		assert( self->backend );
 
-		le_jobs::run_jobs( jobs, 3, &counter );
+		le_jobs::run_jobs_with_priority( jobs, 2, &counter, le_jobs::Priority::eHigh );
+
+		// record_frame must only run once shader modules have been updated - the job
+		// system issues it once shader_counter reaches zero, and frees shader_counter.
+		le_jobs::run_jobs_after( &shader_counter, 1, &record_job, 1, &record_counter, le_jobs::Priority::eHigh );
 
 		// we could theoretically do some more work on the main thread here...
 
 		le_jobs::wait_for_counter_and_free( counter, 0 );
+		le_jobs::wait_for_counter_and_free( record_counter, 0 );
 
 	} else {
 